@@ -0,0 +1,181 @@
+#include "arena.h"
+
+#include "array.h"
+#include "bigint.h"
+#include "gc.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    struct ObjectArena::Chunk {
+        Chunk *next;
+        size_t size;
+        QuotaId quota;
+    };
+
+    namespace {
+        constexpr size_t AlignUp(size_t size, size_t alignment) {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        // Копии создаются без арены: они должны пережить её
+        class ArenaSuspension {
+        public:
+            ArenaSuspension()
+                    : arena_(std::exchange(quota_thread_state.arena, nullptr)) {
+            }
+
+            ArenaSuspension(const ArenaSuspension &) = delete;
+            ArenaSuspension &operator=(const ArenaSuspension &) = delete;
+
+            ~ArenaSuspension() {
+                quota_thread_state.arena = arena_;
+            }
+        private:
+            ObjectArena *arena_;
+        };
+
+        class Promoter {
+        public:
+            ObjectHolder Promote(const ObjectHolder &value) {
+                if (!value) {
+                    return value;
+                }
+                if (const auto it = copies_.find(value.Get()); it != copies_.end()) {
+                    return it->second;
+                }
+                // Контейнер запоминается до копирования элементов, чтобы цикл ссылок замкнулся на копию
+                if (const auto *list = value.TryAs<List>()) {
+                    ObjectHolder copy = ObjectHolder::Make<List>();
+                    copies_.emplace(value.Get(), copy);
+                    auto &items = *copy.TryAs<List>();
+                    for (size_t i = 0; i < list->Size(); ++i) {
+                        items.Append(Promote(list->At(static_cast<int64_t>(i))));
+                    }
+                    return copy;
+                }
+                if (const auto *dict = value.TryAs<Dict>()) {
+                    ObjectHolder copy = ObjectHolder::Make<Dict>();
+                    copies_.emplace(value.Get(), copy);
+                    auto &entries = *copy.TryAs<Dict>();
+                    for (size_t i = 0; i < dict->Size(); ++i) {
+                        ObjectHolder key = Promote(dict->KeyAt(i));
+                        entries.Set(key, Promote(dict->ValueAt(i)), context_);
+                    }
+                    return copy;
+                }
+                ObjectHolder copy = CopyValue(value);
+                copies_.emplace(value.Get(), copy);
+                return copy;
+            }
+        private:
+            static ObjectHolder CopyValue(const ObjectHolder &value) {
+                if (const auto *number = value.TryAs<Number>()) {
+                    return ObjectHolder::Make<Number>(number->GetValue());
+                }
+                if (const auto *number = value.TryAs<Float>()) {
+                    return ObjectHolder::Make<Float>(number->GetValue());
+                }
+                if (const auto *boolean = value.TryAs<Bool>()) {
+                    return ObjectHolder::Make<Bool>(boolean->GetValue());
+                }
+                if (const auto *number = value.TryAs<BigInt>()) {
+                    return ObjectHolder::Own(BigInt(*number));
+                }
+                if (const auto *str = value.TryAs<String>()) {
+                    return ObjectHolder::Make<String>(std::string(str->GetValue()));
+                }
+                if (const auto *array = value.TryAs<Array>()) {
+                    return array->IsFloat() ? ObjectHolder::Make<Array>(array->Floats())
+                                            : ObjectHolder::Make<Array>(array->Ints());
+                }
+                throw std::runtime_error(
+                        "Only numbers, strings, arrays, lists and dicts can be promoted from an arena"s);
+            }
+
+            std::unordered_map<const Object *, ObjectHolder> copies_;
+            DummyContext context_;
+        };
+    }
+
+    ObjectArena::~ObjectArena() {
+        if (chunks_ != nullptr) {
+            CollectGarbage();
+        }
+        while (chunks_ != nullptr) {
+            Chunk *chunk = std::exchange(chunks_, chunks_->next);
+            ReleaseQuota(chunk->quota, chunk->size);
+            ::operator delete(chunk);
+        }
+    }
+
+    void *ObjectArena::Allocate(size_t size) {
+        size = AlignUp(size, ALIGNMENT);
+        if (static_cast<size_t>(end_ - current_) < size) {
+            AddChunk(size);
+        }
+        void *block = current_;
+        current_ += size;
+        allocated_ += size;
+        return block;
+    }
+
+    size_t ObjectArena::GetAllocatedBytes() const {
+        return allocated_;
+    }
+
+    size_t ObjectArena::GetReservedBytes() const {
+        return reserved_;
+    }
+
+    void ObjectArena::AddChunk(size_t size) {
+        constexpr size_t HEADER_SIZE = AlignUp(sizeof(Chunk), ALIGNMENT);
+        // Остаток прежнего блока пропадает, поэтому блоки растут, а объект крупнее блока получает свой
+        const size_t chunk_size = std::max(next_chunk_size_, HEADER_SIZE + size);
+        next_chunk_size_ = std::min(next_chunk_size_ * 2, MAX_CHUNK_SIZE);
+
+        const QuotaId quota = CurrentQuota();
+        ChargeQuota(quota, chunk_size);
+        void *memory = nullptr;
+        try {
+            memory = ::operator new(chunk_size);
+        } catch (...) {
+            ReleaseQuota(quota, chunk_size);
+            throw;
+        }
+        chunks_ = new(memory) Chunk{chunks_, chunk_size, quota};
+        current_ = static_cast<char *>(memory) + HEADER_SIZE;
+        end_ = static_cast<char *>(memory) + chunk_size;
+        reserved_ += chunk_size;
+    }
+
+    ArenaScope::ArenaScope(ObjectArena &arena)
+            : previous_(std::exchange(quota_thread_state.arena, &arena)) {
+    }
+
+    ArenaScope::~ArenaScope() {
+        quota_thread_state.arena = previous_;
+    }
+
+    void *QuotaCharged::AllocateInArena(size_t size) {
+        QuotaThreadState &state = quota_thread_state;
+        void *block = state.arena->Allocate(size);
+        state.pending_begin = static_cast<const char *>(block);
+        state.pending_size = size;
+        state.pending_quota = ARENA_QUOTA;
+        return block;
+    }
+
+    ObjectHolder PromoteFromArena(const ObjectHolder &value) {
+        const ArenaSuspension suspension;
+        return Promoter().Promote(value);
+    }
+
+}
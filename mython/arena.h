@@ -0,0 +1,62 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstddef>
+
+namespace runtime {
+
+    // Арена для одного выполнения программы, объекты которого не нужны после его завершения.
+    // Пока арена активна в потоке (ArenaScope), объекты и узлы AST берут память из её блоков сдвигом указателя.
+    // Удаление такого объекта выполняет деструктор, но память не возвращает: все блоки освобождаются разом
+    // при удалении арены. Числам и логическим значениям деструктор не нужен, и ObjectHolder его не вызывает.
+    // Буферы строк, списков, словарей и полей объектов по-прежнему лежат в куче и освобождаются деструкторами.
+    //
+    // Арена должна пережить все свои объекты. Значение, которое нужно после её удаления, копируется из неё
+    // функцией PromoteFromArena. Циклы ссылок, оставшиеся от программы, удаляет сборщик (gc.h), которого арена
+    // запускает перед освобождением блоков. С квоты (quota.h), текущей при выделении блока, списывается весь блок
+    class ObjectArena {
+    public:
+        ObjectArena() = default;
+        ObjectArena(const ObjectArena &) = delete;
+        ObjectArena &operator=(const ObjectArena &) = delete;
+        ~ObjectArena();
+
+        [[nodiscard]] void *Allocate(size_t size);
+        // Сколько байт выдано объектам и сколько занимают блоки арены
+        [[nodiscard]] size_t GetAllocatedBytes() const;
+        [[nodiscard]] size_t GetReservedBytes() const;
+    private:
+        struct Chunk;
+
+        static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+        static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+        static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+        void AddChunk(size_t size);
+
+        Chunk *chunks_ = nullptr;
+        char *current_ = nullptr;
+        char *end_ = nullptr;
+        size_t next_chunk_size_ = MIN_CHUNK_SIZE;
+        size_t allocated_ = 0;
+        size_t reserved_ = 0;
+    };
+
+    // Делает арену текущей в потоке до своего удаления. Области вкладываются: удаление восстанавливает прежнюю
+    class ArenaScope {
+    public:
+        explicit ArenaScope(ObjectArena &arena);
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+        ~ArenaScope();
+    private:
+        ObjectArena *previous_;
+    };
+
+    // Копирует значение в обычную кучу, даже если вызвана внутри ArenaScope: числа, строки, массивы, а также
+    // списки и словари вместе с элементами. Общие элементы остаются общими, циклы сохраняются.
+    // Объекты классов, сами классы, генераторы и объекты хоста скопировать нельзя: бросается runtime_error
+    [[nodiscard]] ObjectHolder PromoteFromArena(const ObjectHolder &value);
+
+}
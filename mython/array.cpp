@@ -0,0 +1,381 @@
+#include "array.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    namespace {
+        struct ArrayKernels {
+            void (*int_arithmetic)(ArrayOperation, const int64_t *, bool, const int64_t *, bool, int64_t *, size_t);
+            void (*float_arithmetic)(ArrayOperation, const double *, bool, const double *, bool, double *, size_t);
+            void (*int_compare)(ArrayOperation, const int64_t *, bool, const int64_t *, bool, int64_t *, size_t);
+            void (*float_compare)(ArrayOperation, const double *, bool, const double *, bool, int64_t *, size_t);
+            int64_t (*int_sum)(const int64_t *, size_t);
+            double (*float_sum)(const double *, size_t);
+            int64_t (*int_dot)(const int64_t *, const int64_t *, size_t);
+            double (*float_dot)(const double *, const double *, size_t);
+            int64_t (*int_min)(const int64_t *, size_t);
+            int64_t (*int_max)(const int64_t *, size_t);
+            double (*float_min)(const double *, size_t);
+            double (*float_max)(const double *, size_t);
+        };
+
+        namespace scalar {
+#define VECTOR_BYTES 8
+#include "array_kernels.inc"
+#undef VECTOR_BYTES
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MYTHON_ARRAY_X86
+#pragma GCC push_options
+#pragma GCC target("sse2")
+        namespace sse2 {
+#define VECTOR_BYTES 16
+#include "array_kernels.inc"
+#undef VECTOR_BYTES
+        }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+        namespace avx2 {
+#define VECTOR_BYTES 32
+#include "array_kernels.inc"
+#undef VECTOR_BYTES
+        }
+#pragma GCC pop_options
+#endif
+
+        SimdLevel SupportedSimdLevel() {
+#ifdef MYTHON_ARRAY_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return SimdLevel::Avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return SimdLevel::Sse2;
+            }
+#endif
+            return SimdLevel::Scalar;
+        }
+
+        const ArrayKernels &KernelsFor(SimdLevel level) {
+            switch (level) {
+#ifdef MYTHON_ARRAY_X86
+                case SimdLevel::Avx2: return avx2::KERNELS;
+                case SimdLevel::Sse2: return sse2::KERNELS;
+#endif
+                default: return scalar::KERNELS;
+            }
+        }
+
+        SimdLevel &CurrentLevel() {
+            static SimdLevel level = SupportedSimdLevel();
+            return level;
+        }
+
+        const ArrayKernels *&CurrentKernels() {
+            static const ArrayKernels *kernels = &KernelsFor(CurrentLevel());
+            return kernels;
+        }
+
+        // Проверка по typeid дешевле dynamic_cast: операции над числами проходят через неё на каждом шаге
+        bool IsArray(const ObjectHolder &object) {
+            return object && typeid(*object) == typeid(Array);
+        }
+
+        ObjectHolder MakeNumber(int64_t value) {
+            return ObjectHolder::Own(Number(value));
+        }
+
+        // Операнд операции над массивами: массив или число, которое применяется к каждому элементу.
+        // Целый массив при необходимости приводится к double во временный буфер converted
+        struct Operand {
+            const int64_t *ints = nullptr;
+            const double *floats = nullptr;
+            bool is_float = false;
+            bool is_scalar = false;
+            size_t size = 0;
+            int64_t int_scalar = 0;
+            double float_scalar = 0;
+            std::vector<double> converted;
+
+            const int64_t *Ints() const {
+                return is_scalar ? &int_scalar : ints;
+            }
+
+            const double *AsFloats() {
+                if (is_scalar) {
+                    return &float_scalar;
+                }
+                if (!is_float) {
+                    converted.assign(ints, ints + size);
+                    return converted.data();
+                }
+                return floats;
+            }
+        };
+
+        Operand MakeOperand(const Array &array) {
+            Operand operand;
+            operand.is_float = array.IsFloat();
+            operand.size = array.Size();
+            if (operand.is_float) {
+                operand.floats = array.Floats().data();
+            } else {
+                operand.ints = array.Ints().data();
+            }
+            return operand;
+        }
+
+        Operand MakeOperand(const ObjectHolder &object) {
+            if (auto array = object.TryAs<Array>()) {
+                return MakeOperand(*array);
+            }
+            const std::optional<Numeric> number = AsNumeric(object);
+            if (!number) {
+                throw std::runtime_error("array operations accept only arrays and numbers"s);
+            }
+            Operand operand;
+            operand.is_scalar = true;
+            operand.is_float = number->is_float;
+            operand.int_scalar = number->int_value;
+            operand.float_scalar = number->AsDouble();
+            return operand;
+        }
+
+        template <typename T>
+        void CheckDivisors(const T *divisors, size_t size, const T *dividends, bool dividends_scalar) {
+            for (size_t i = 0; i < size; ++i) {
+                if (divisors[i] == 0) {
+                    throw std::runtime_error("Division was failed");
+                }
+                if constexpr (std::is_same_v<T, int64_t>) {
+                    const int64_t dividend = dividends[dividends_scalar ? 0 : i];
+                    if (divisors[i] == -1 && dividend == std::numeric_limits<int64_t>::min()) {
+                        throw std::runtime_error("integer overflow in array division"s);
+                    }
+                }
+            }
+        }
+    }
+
+    SimdLevel GetSimdLevel() {
+        return CurrentLevel();
+    }
+
+    SimdLevel SetSimdLevel(SimdLevel level) {
+        CurrentLevel() = std::min(level, SupportedSimdLevel());
+        CurrentKernels() = &KernelsFor(CurrentLevel());
+        return CurrentLevel();
+    }
+
+    namespace {
+        size_t StorageSize(const std::variant<std::vector<int64_t>, std::vector<double>> &values) {
+            return std::visit([](const auto &elements) {
+                return elements.capacity() * sizeof(elements[0]);
+            }, values);
+        }
+    }
+
+    Array::Array(std::vector<int64_t> values)
+            : values_(std::move(values)), charge_(StorageSize(values_)) {}
+
+    Array::Array(std::vector<double> values)
+            : values_(std::move(values)), charge_(StorageSize(values_)) {}
+
+    Array Array::FromList(const List &list) {
+        bool has_float = false;
+        for (size_t i = 0; i < list.Size(); ++i) {
+            const ObjectHolder &item = list.At(static_cast<int64_t>(i));
+            if (item.TryAs<Float>()) {
+                has_float = true;
+            } else if (!item.TryAs<Number>()) {
+                throw std::runtime_error("array elements must be numbers"s);
+            }
+        }
+        if (has_float) {
+            std::vector<double> values(list.Size());
+            for (size_t i = 0; i < values.size(); ++i) {
+                values[i] = AsNumeric(list.At(static_cast<int64_t>(i)))->AsDouble();
+            }
+            return Array(std::move(values));
+        }
+        std::vector<int64_t> values(list.Size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = list.At(static_cast<int64_t>(i)).TryAs<Number>()->GetValue();
+        }
+        return Array(std::move(values));
+    }
+
+    void Array::Print(std::ostream &os, Context &context) {
+        os << "array(["sv;
+        for (size_t i = 0; i < Size(); ++i) {
+            if (i > 0) {
+                os << ", "sv;
+            }
+            if (IsFloat()) {
+                Float(Floats()[i]).Print(os, context);
+            } else {
+                os << Ints()[i];
+            }
+        }
+        os << "])"sv;
+    }
+
+    ObjectHolder Array::Call(const std::string &method, ArgumentSpan args, [[maybe_unused]] Context &context) {
+        if (args.empty()) {
+            if (method == "sum"sv) {
+                return Sum();
+            } else if (method == "min"sv) {
+                return Min();
+            } else if (method == "max"sv) {
+                return Max();
+            }
+        } else if (args.size() == 1 && method == "dot"sv) {
+            auto other = args[0].TryAs<Array>();
+            if (other == nullptr) {
+                throw std::runtime_error("dot() argument must be an array"s);
+            }
+            return Dot(*other);
+        }
+        throw std::runtime_error("no method to call"s);
+    }
+
+    bool Array::IsFloat() const {
+        return std::holds_alternative<std::vector<double>>(values_);
+    }
+
+    size_t Array::Size() const {
+        return IsFloat() ? Floats().size() : Ints().size();
+    }
+
+    const std::vector<int64_t> &Array::Ints() const {
+        return std::get<std::vector<int64_t>>(values_);
+    }
+
+    const std::vector<double> &Array::Floats() const {
+        return std::get<std::vector<double>>(values_);
+    }
+
+    size_t Array::CheckIndex(int64_t index) const {
+        const auto size = static_cast<int64_t>(Size());
+        const int64_t position = index < 0 ? size + index : index;
+        if (position < 0 || position >= size) {
+            throw std::runtime_error("array index out of range"s);
+        }
+        return static_cast<size_t>(position);
+    }
+
+    ObjectHolder Array::At(int64_t index) const {
+        const size_t position = CheckIndex(index);
+        if (IsFloat()) {
+            return ObjectHolder::Own(Float(Floats()[position]));
+        }
+        return MakeNumber(Ints()[position]);
+    }
+
+    void Array::Set(int64_t index, const ObjectHolder &value) {
+        const size_t position = CheckIndex(index);
+        const std::optional<Numeric> number = AsNumeric(value);
+        if (!number) {
+            throw std::runtime_error("array elements must be numbers"s);
+        }
+        if (IsFloat()) {
+            std::get<std::vector<double>>(values_)[position] = number->AsDouble();
+        } else if (!number->is_float) {
+            std::get<std::vector<int64_t>>(values_)[position] = number->int_value;
+        } else {
+            throw std::runtime_error("cannot store a float in an integer array"s);
+        }
+    }
+
+    ObjectHolder Array::Sum() const {
+        if (IsFloat()) {
+            return ObjectHolder::Own(Float(CurrentKernels()->float_sum(Floats().data(), Size())));
+        }
+        return MakeNumber(CurrentKernels()->int_sum(Ints().data(), Size()));
+    }
+
+    ObjectHolder Array::Min() const {
+        if (Size() == 0) {
+            throw std::runtime_error("min() of an empty array"s);
+        }
+        if (IsFloat()) {
+            return ObjectHolder::Own(Float(CurrentKernels()->float_min(Floats().data(), Size())));
+        }
+        return MakeNumber(CurrentKernels()->int_min(Ints().data(), Size()));
+    }
+
+    ObjectHolder Array::Max() const {
+        if (Size() == 0) {
+            throw std::runtime_error("max() of an empty array"s);
+        }
+        if (IsFloat()) {
+            return ObjectHolder::Own(Float(CurrentKernels()->float_max(Floats().data(), Size())));
+        }
+        return MakeNumber(CurrentKernels()->int_max(Ints().data(), Size()));
+    }
+
+    ObjectHolder Array::Dot(const Array &other) const {
+        if (Size() != other.Size()) {
+            throw std::runtime_error("dot() arrays have different sizes"s);
+        }
+        if (!IsFloat() && !other.IsFloat()) {
+            return MakeNumber(CurrentKernels()->int_dot(Ints().data(), other.Ints().data(), Size()));
+        }
+        Operand lhs = MakeOperand(*this);
+        Operand rhs = MakeOperand(other);
+        return ObjectHolder::Own(Float(CurrentKernels()->float_dot(lhs.AsFloats(), rhs.AsFloats(), Size())));
+    }
+
+    std::optional<ObjectHolder> ApplyArrayOperation(ArrayOperation operation, const ObjectHolder &lhs,
+                                                    const ObjectHolder &rhs) {
+        if (!IsArray(lhs) && !IsArray(rhs)) {
+            return std::nullopt;
+        }
+        Operand left = MakeOperand(lhs);
+        Operand right = MakeOperand(rhs);
+        if (!left.is_scalar && !right.is_scalar && left.size != right.size) {
+            throw std::runtime_error("arrays have different sizes"s);
+        }
+        const size_t size = left.is_scalar ? right.size : left.size;
+        const ArrayKernels &kernels = *CurrentKernels();
+        const bool is_comparison = operation >= ArrayOperation::Less;
+
+        if (!left.is_float && !right.is_float) {
+            if (operation == ArrayOperation::Div) {
+                CheckDivisors(right.Ints(), right.is_scalar ? 1 : size, left.Ints(), left.is_scalar);
+            }
+            std::vector<int64_t> result(size);
+            (is_comparison ? kernels.int_compare : kernels.int_arithmetic)(
+                    operation, left.Ints(), left.is_scalar, right.Ints(), right.is_scalar, result.data(), size);
+            return ObjectHolder::Own(Array(std::move(result)));
+        }
+
+        const double *left_values = left.AsFloats();
+        const double *right_values = right.AsFloats();
+        if (is_comparison) {
+            std::vector<int64_t> mask(size);
+            kernels.float_compare(operation, left_values, left.is_scalar, right_values, right.is_scalar,
+                                  mask.data(), size);
+            return ObjectHolder::Own(Array(std::move(mask)));
+        }
+        if (operation == ArrayOperation::Div) {
+            CheckDivisors(right_values, right.is_scalar ? 1 : size, left_values, left.is_scalar);
+        }
+        std::vector<double> result(size);
+        kernels.float_arithmetic(operation, left_values, left.is_scalar, right_values, right.is_scalar,
+                                 result.data(), size);
+        return ObjectHolder::Own(Array(std::move(result)));
+    }
+
+}
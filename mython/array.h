@@ -0,0 +1,66 @@
+#pragma once
+
+#include "builtins.h"
+#include "runtime.h"
+
+#include <cstdint>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace runtime {
+
+    // Поэлементные операции над массивами. Порядок важен: все сравнения идут после арифметики
+    enum class ArrayOperation {
+        Add, Sub, Mult, Div, Less, Greater, Equal, NotEqual, LessOrEqual, GreaterOrEqual
+    };
+
+    // Набор инструкций, которым выполняются операции над массивами
+    enum class SimdLevel {
+        Scalar, Sse2, Avx2
+    };
+
+    // Уровень выбирается при первом обращении: наибольший из поддерживаемых процессором
+    SimdLevel GetSimdLevel();
+    // Устанавливает уровень не выше поддерживаемого процессором и возвращает установленный уровень
+    SimdLevel SetSimdLevel(SimdLevel level);
+
+// Однородный массив целых (int64) или вещественных чисел. Элементы хранятся подряд без упаковки в объекты,
+// поэтому операция над массивами выполняется одним проходом векторных инструкций, а не по объекту на элемент
+    class Array : public Object {
+    public:
+        explicit Array(std::vector<int64_t> values);
+        explicit Array(std::vector<double> values);
+        // Массив из элементов списка: целый, если все элементы — целые числа, и вещественный, если есть Float
+        [[nodiscard]] static Array FromList(const List &list);
+
+        void Print(std::ostream &os, Context &context) override;
+        // Вызывает метод массива: sum(), min(), max() или dot(other)
+        ObjectHolder Call(const std::string &method, ArgumentSpan args, Context &context);
+
+        [[nodiscard]] bool IsFloat() const;
+        [[nodiscard]] size_t Size() const;
+        [[nodiscard]] const std::vector<int64_t> &Ints() const;
+        [[nodiscard]] const std::vector<double> &Floats() const;
+        // Элемент по индексу; отрицательный индекс отсчитывается от конца
+        [[nodiscard]] ObjectHolder At(int64_t index) const;
+        void Set(int64_t index, const ObjectHolder &value);
+
+        [[nodiscard]] ObjectHolder Sum() const;
+        [[nodiscard]] ObjectHolder Min() const;
+        [[nodiscard]] ObjectHolder Max() const;
+        [[nodiscard]] ObjectHolder Dot(const Array &other) const;
+    private:
+        [[nodiscard]] size_t CheckIndex(int64_t index) const;
+
+        std::variant<std::vector<int64_t>, std::vector<double>> values_;
+        // Элементы списываются с квоты памяти вместе с объектом массива (quota.h)
+        HeapCharge charge_;
+    };
+
+    // Операция над двумя массивами одного размера или над массивом и числом, которое применяется к каждому
+    // элементу. Сравнения возвращают маску — целый массив из 0 и 1. Если ни один операнд не массив, возвращает nullopt
+    std::optional<ObjectHolder> ApplyArrayOperation(ArrayOperation operation, const ObjectHolder &lhs,
+                                                    const ObjectHolder &rhs);
+
+}
@@ -0,0 +1,177 @@
+#include "array.h"
+
+#include <test_runner.h>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+
+const SimdLevel LEVELS[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2};
+
+ObjectHolder IntArray(vector<int64_t> values) {
+    return ObjectHolder::Own(Array(move(values)));
+}
+
+ObjectHolder FloatArray(vector<double> values) {
+    return ObjectHolder::Own(Array(move(values)));
+}
+
+const vector<int64_t>& Ints(const ObjectHolder& object) {
+    return object.TryAs<Array>()->Ints();
+}
+
+const vector<double>& Floats(const ObjectHolder& object) {
+    return object.TryAs<Array>()->Floats();
+}
+
+// Прогоняет проверку на каждом наборе инструкций, который поддерживает процессор
+template <typename Check>
+void ForEachSimdLevel(Check check) {
+    const SimdLevel original = GetSimdLevel();
+    for (SimdLevel level : LEVELS) {
+        if (SetSimdLevel(level) == level) {
+            check();
+        }
+    }
+    SetSimdLevel(original);
+}
+
+void TestElementwiseArithmetic() {
+    ForEachSimdLevel([] {
+        // Размеры не кратны ширине вектора, чтобы проверить обработку хвоста
+        for (size_t size : {0, 1, 3, 4, 7, 37}) {
+            vector<int64_t> lhs(size), rhs(size);
+            vector<double> lhs_float(size);
+            for (size_t i = 0; i < size; ++i) {
+                lhs[i] = static_cast<int64_t>(i * 3) - 10;
+                rhs[i] = static_cast<int64_t>(i % 5) + 1;
+                lhs_float[i] = lhs[i] * 0.5;
+            }
+            const ObjectHolder a = IntArray(lhs);
+            const ObjectHolder b = IntArray(rhs);
+            const ObjectHolder f = FloatArray(lhs_float);
+
+            const ObjectHolder sum = *ApplyArrayOperation(ArrayOperation::Add, a, b);
+            const ObjectHolder difference = *ApplyArrayOperation(ArrayOperation::Sub, a, b);
+            const ObjectHolder product = *ApplyArrayOperation(ArrayOperation::Mult, a, b);
+            const ObjectHolder quotient = *ApplyArrayOperation(ArrayOperation::Div, a, b);
+            const ObjectHolder mixed = *ApplyArrayOperation(ArrayOperation::Mult, f, b);
+            ASSERT(!sum.TryAs<Array>()->IsFloat());
+            ASSERT(quotient.TryAs<Array>()->Size() == size);
+            ASSERT(mixed.TryAs<Array>()->IsFloat());
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_EQUAL(Ints(sum)[i], lhs[i] + rhs[i]);
+                ASSERT_EQUAL(Ints(difference)[i], lhs[i] - rhs[i]);
+                ASSERT_EQUAL(Ints(product)[i], lhs[i] * rhs[i]);
+                ASSERT_EQUAL(Ints(quotient)[i], lhs[i] / rhs[i]);
+                ASSERT_EQUAL(Floats(mixed)[i], lhs_float[i] * rhs[i]);
+            }
+        }
+    });
+}
+
+void TestBroadcastAndMasks() {
+    ForEachSimdLevel([] {
+        const ObjectHolder a = IntArray({5, -2, 7, 0, 3, 9, 1});
+        const ObjectHolder ten = ObjectHolder::Own(Number{10});
+        const ObjectHolder half = ObjectHolder::Own(Float{0.5});
+
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Sub, ten, a)) == vector<int64_t>({5, 12, 3, 10, 7, 1, 9}));
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Sub, a, ten)) ==
+               vector<int64_t>({-5, -12, -3, -10, -7, -1, -9}));
+        ASSERT(Floats(*ApplyArrayOperation(ArrayOperation::Mult, half, a)) ==
+               vector<double>({2.5, -1, 3.5, 0, 1.5, 4.5, 0.5}));
+        ASSERT(Floats(*ApplyArrayOperation(ArrayOperation::Div, a, half)) ==
+               vector<double>({10, -4, 14, 0, 6, 18, 2}));
+
+        const ObjectHolder three = ObjectHolder::Own(Number{3});
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Less, a, three)) == vector<int64_t>({0, 1, 0, 1, 0, 0, 1}));
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::GreaterOrEqual, a, three)) ==
+               vector<int64_t>({1, 0, 1, 0, 1, 1, 0}));
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Equal, three, a)) == vector<int64_t>({0, 0, 0, 0, 1, 0, 0}));
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::NotEqual, a, a)) == vector<int64_t>(7, 0));
+        const ObjectHolder f = FloatArray({0.5, 3.0, -1.5, 2.9, 3.1, 10, 3});
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::LessOrEqual, f, three)) ==
+               vector<int64_t>({1, 1, 1, 1, 0, 0, 1}));
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Greater, f, a)) == vector<int64_t>({0, 1, 0, 1, 1, 1, 1}));
+        // Пустой массив со скаляром даёт пустой результат, не читая несуществующих элементов
+        ASSERT(Ints(*ApplyArrayOperation(ArrayOperation::Less, IntArray({}), three)).empty());
+        ASSERT(Floats(*ApplyArrayOperation(ArrayOperation::Mult, half, FloatArray({}))).empty());
+    });
+}
+
+void TestReductions() {
+    ForEachSimdLevel([] {
+        vector<int64_t> values(41);
+        vector<double> floats(41);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<int64_t>((i * 7) % 19) - 9;
+            floats[i] = values[i] * 0.25;
+        }
+        Array ints(values);
+        Array reals(floats);
+
+        ASSERT_EQUAL(ints.Sum().TryAs<Number>()->GetValue(), -6);
+        ASSERT_EQUAL(ints.Min().TryAs<Number>()->GetValue(), -9);
+        ASSERT_EQUAL(ints.Max().TryAs<Number>()->GetValue(), 9);
+        ASSERT_EQUAL(reals.Sum().TryAs<Float>()->GetValue(), -1.5);
+        ASSERT_EQUAL(reals.Min().TryAs<Float>()->GetValue(), -2.25);
+        ASSERT_EQUAL(reals.Max().TryAs<Float>()->GetValue(), 2.25);
+
+        int64_t expected_dot = 0;
+        for (int64_t value : values) {
+            expected_dot += value * value;
+        }
+        ASSERT_EQUAL(ints.Dot(ints).TryAs<Number>()->GetValue(), expected_dot);
+        ASSERT_EQUAL(ints.Dot(reals).TryAs<Float>()->GetValue(), expected_dot * 0.25);
+        ASSERT_EQUAL(Array(vector<int64_t>{}).Sum().TryAs<Number>()->GetValue(), 0);
+    });
+}
+
+void TestArrayErrors() {
+    const ObjectHolder a = IntArray({1, 2, 3});
+    const ObjectHolder zero = ObjectHolder::Own(Number{0});
+
+    ASSERT(!ApplyArrayOperation(ArrayOperation::Add, zero, zero));
+    ASSERT_THROWS(ApplyArrayOperation(ArrayOperation::Add, a, IntArray({1, 2})), runtime_error);
+    ASSERT_THROWS(ApplyArrayOperation(ArrayOperation::Div, a, zero), runtime_error);
+    ASSERT_THROWS(ApplyArrayOperation(ArrayOperation::Div, a, IntArray({1, 0, 1})), runtime_error);
+    ASSERT_THROWS(ApplyArrayOperation(ArrayOperation::Div, FloatArray({1, 2, 3}), zero), runtime_error);
+    ASSERT_THROWS(ApplyArrayOperation(ArrayOperation::Add, a, ObjectHolder::Own(String{"x"s})), runtime_error);
+    ASSERT_THROWS(static_cast<void>(Array(vector<int64_t>{}).Min()), runtime_error);
+}
+
+void TestArrayElements() {
+    DummyContext context;
+    Array a = Array::FromList(List({ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{2})}));
+    ASSERT(!a.IsFloat());
+    ASSERT_EQUAL(a.At(-1).TryAs<Number>()->GetValue(), 2);
+    ASSERT_EQUAL(Array(vector<int64_t>{1LL << 40}).Sum().TryAs<Number>()->GetValue(), 1LL << 40);
+    a.Set(0, ObjectHolder::Own(Number{7}));
+    ASSERT_THROWS(a.Set(0, ObjectHolder::Own(Float{1.5})), runtime_error);
+    ASSERT_THROWS(static_cast<void>(a.At(2)), runtime_error);
+    a.Print(context.output, context);
+
+    Array b = Array::FromList(List({ObjectHolder::Own(Number{1}), ObjectHolder::Own(Float{2.5})}));
+    ASSERT(b.IsFloat());
+    b.Set(1, ObjectHolder::Own(Number{3}));
+    context.output << ' ';
+    b.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "array([7, 2]) array([1.0, 3.0])"s);
+
+    ASSERT_THROWS(static_cast<void>(Array::FromList(List({ObjectHolder::Own(String{"1"s})}))), runtime_error);
+}
+
+}  // namespace
+
+void RunArrayTests(TestRunner& tr) {
+    RUN_TEST(tr, runtime::TestElementwiseArithmetic);
+    RUN_TEST(tr, runtime::TestBroadcastAndMasks);
+    RUN_TEST(tr, runtime::TestReductions);
+    RUN_TEST(tr, runtime::TestArrayErrors);
+    RUN_TEST(tr, runtime::TestArrayElements);
+}
+
+}  // namespace runtime
@@ -0,0 +1,243 @@
+#include "arena.h"
+#include "gc.h"
+#include "lexer.h"
+#include "parse.h"
+#include "runtime.h"
+#include "statement.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+    // Нагрузка каждого сценария: REPEATS раз посчитать сумму чисел от 0 до DEPTH - 1.
+    // Глубина рекурсии ограничена DEPTH, чтобы рекурсивный вариант не упирался в размер стека
+    const int DEPTH = 1000;
+    const int REPEATS = 200;
+
+    struct Benchmark {
+        std::string_view name;
+        std::string program;
+        // Выполнять ли программу с включённым сборщиком циклов
+        bool gc = false;
+        // Выделять ли объекты программы в арене (arena.h)
+        bool arena = false;
+    };
+
+    std::string MakeRecursiveSum() {
+        return R"(
+class Summator:
+  def sum(i, n):
+    if i < n:
+      return i + self.sum(i + 1, n)
+    return 0
+
+class Repeater:
+  def __init__():
+    self.summator = Summator()
+
+  def run(k, n):
+    if k > 0:
+      return self.summator.sum(0, n) + self.run(k - 1, n)
+    return 0
+
+r = Repeater()
+print r.run()"s + std::to_string(REPEATS) + ", "s + std::to_string(DEPTH) + ")\n"s;
+    }
+
+    // Та же сумма с накопителем в аргументе: рекурсивный вызов стоит в return, поэтому каждый уровень
+    // выполняется в кадре первого вызова, и сравнение с MakeRecursiveSum показывает цену роста стека
+    std::string MakeTailRecursiveSum() {
+        return R"(
+class Summator:
+  def sum(i, n, acc):
+    if i < n:
+      return self.sum(i + 1, n, acc + i)
+    return acc
+
+s = Summator()
+total = 0
+for k in range()"s + std::to_string(REPEATS) + R"():
+  total = total + s.sum(0, )"s + std::to_string(DEPTH) + R"(, 0)
+print total
+)"s;
+    }
+
+    std::string MakeForRangeSum() {
+        return "total = 0\n"
+               "for k in range("s + std::to_string(REPEATS) + "):\n"
+               "  for i in range("s + std::to_string(DEPTH) + "):\n"
+               "    total = total + i\n"
+               "print total\n"s;
+    }
+
+    std::string MakeWhileSum() {
+        return "total = 0\n"
+               "k = 0\n"
+               "while k < "s + std::to_string(REPEATS) + ":\n"
+               "  i = 0\n"
+               "  while i < "s + std::to_string(DEPTH) + ":\n"
+               "    total = total + i\n"
+               "    i = i + 1\n"
+               "  k = k + 1\n"
+               "print total\n"s;
+    }
+
+    // Та же сумма, что и в MakeRecursiveSum, но числа выдаёт генератор: каждое значение стоит одного
+    // возобновления метода вместо одного вызова, поэтому сценарии можно сравнивать между собой
+    std::string MakeGeneratorSum() {
+        return R"(
+class Counter:
+  def upto(n):
+    i = 0
+    while i < n:
+      yield i
+      i = i + 1
+
+c = Counter()
+total = 0
+for k in range()"s + std::to_string(REPEATS) + R"():
+  for i in c.upto()"s + std::to_string(DEPTH) + R"():
+    total = total + i
+print total
+)"s;
+    }
+
+    // Строка из 100 тысяч фрагментов, собранная последовательными сложениями
+    std::string MakeStringConcat() {
+        return "s = ''\n"
+               "for i in range(100000):\n"
+               "  s = s + 'fragment' + str(i)\n"
+               "print len(s)\n"s;
+    }
+
+    // Поэлементные операции над массивом из миллиона вещественных чисел: каждое сложение и умножение —
+    // один проход векторных инструкций без создания объекта на элемент
+    std::string MakeArrayArithmetic() {
+        return "a = array(1000000, 1.5)\n"
+               "b = array(1000000, 2.0)\n"
+               "total = 0\n"
+               "for k in range(20):\n"
+               "  c = a * b + a - b / 2.0\n"
+               "  mask = c > 2.0\n"
+               "  total = total + c.sum() + mask.sum()\n"
+               "print total\n"s;
+    }
+
+    // Та же сумма через объекты: каждый шаг создаёт новый Point с двумя полями, а предыдущий сразу
+    // освобождается, поэтому время зависит от цены создания и удаления объекта
+    std::string MakeObjectChurn() {
+        return R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+class Mover:
+  def shift(p, dx):
+    return Point(p.x + dx, p.y + 1)
+
+m = Mover()
+p = Point(0, 0)
+for k in range()"s + std::to_string(REPEATS) + R"():
+  for i in range()"s + std::to_string(DEPTH) + R"():
+    p = m.shift(p, i)
+print p.x
+)"s;
+    }
+
+    // Пары объектов, ссылающихся друг на друга: подсчёт ссылок не освобождает ни одну пару.
+    // Программа выводит число живых объектов кучи, число сборок и самую долгую паузу в микросекундах
+    std::string MakeReferenceCycles() {
+        return R"(
+class Node:
+  def __init__():
+    self.peer = None
+
+total = 0
+for k in range()"s + std::to_string(REPEATS) + R"():
+  for i in range()"s + std::to_string(DEPTH / 2) + R"():
+    a = Node()
+    b = Node()
+    a.peer = b
+    b.peer = a
+    total = total + 1
+stats = gc_stats()
+print total, stats['objects'], stats['collections'], stats['pause_max_us']
+)"s;
+    }
+
+    // Факториал 3000 — около тысячи 32-битных разрядов — и его квадрат: короткие сомножители умножаются
+    // столбиком, квадрат — методом Карацубы, а вывод длины проверяет перевод в десятичную запись
+    std::string MakeBigIntFactorial() {
+        return "f = 1\n"
+               "for i in range(1, 3001):\n"
+               "  f = f * i\n"
+               "total = 0\n"
+               "for k in range(20):\n"
+               "  total = total + len(str(f * f / f))\n"
+               "print total\n"s;
+    }
+
+    // Возвращает время разбора и выполнения программы в миллисекундах и сохраняет её вывод.
+    // Время включает удаление объектов программы, а с ареной — и её освобождение
+    double Measure(const std::string& program, std::string& output, bool use_arena) {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::ostringstream out;
+        {
+            runtime::ObjectArena arena;
+            std::optional<runtime::ArenaScope> arena_scope;
+            if (use_arena) {
+                arena_scope.emplace(arena);
+            }
+
+            std::istringstream input(program);
+            parse::Lexer lexer(input);
+            auto statements = ParseProgram(lexer);
+
+            runtime::SimpleContext context{out};
+            runtime::Closure closure;
+            statements->Execute(closure, context);
+        }
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        output = out.str();
+        return elapsed.count();
+    }
+
+}  // namespace
+
+void RunBenchmarks(std::ostream& out) {
+    const Benchmark benchmarks[] = {
+            {"recursion"sv, MakeRecursiveSum()},
+            {"tail-call"sv, MakeTailRecursiveSum()},
+            {"for-range"sv, MakeForRangeSum()},
+            {"while"sv, MakeWhileSum()},
+            {"generator"sv, MakeGeneratorSum()},
+            {"objects"sv, MakeObjectChurn()},
+            {"objects-arena"sv, MakeObjectChurn(), false, true},
+            {"cycles-gc"sv, MakeReferenceCycles(), true},
+            {"cycles"sv, MakeReferenceCycles()},
+            {"concat"sv, MakeStringConcat()},
+            {"array"sv, MakeArrayArithmetic()},
+            {"bigint"sv, MakeBigIntFactorial()},
+    };
+
+    for (const Benchmark& benchmark : benchmarks) {
+        std::string output;
+        runtime::SetGcEnabled(benchmark.gc);
+        const double elapsed = Measure(benchmark.program, output, benchmark.arena);
+        runtime::SetGcEnabled(false);
+        out << std::left << std::setw(14) << benchmark.name
+            << std::right << std::fixed << std::setprecision(2) << std::setw(10) << elapsed << " ms   "
+            << output;
+    }
+}
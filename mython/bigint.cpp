@@ -0,0 +1,480 @@
+#include "bigint.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    namespace {
+        // Промежуточные результаты тоже списываются с квоты
+        using Digits = QuotaVector<uint32_t>;
+
+        constexpr uint64_t BASE = uint64_t{1} << 32;
+        // Наибольшая степень десяти, которая помещается в разряд: десятичная запись переводится порциями по 9 цифр
+        constexpr uint32_t DECIMAL_CHUNK = 1'000'000'000;
+        constexpr size_t DECIMAL_CHUNK_DIGITS = 9;
+
+        void Trim(Digits &digits) {
+            while (!digits.empty() && digits.back() == 0) {
+                digits.pop_back();
+            }
+        }
+
+        int CompareMagnitudes(const Digits &lhs, const Digits &rhs) {
+            if (lhs.size() != rhs.size()) {
+                return lhs.size() < rhs.size() ? -1 : 1;
+            }
+            for (size_t i = lhs.size(); i-- > 0;) {
+                if (lhs[i] != rhs[i]) {
+                    return lhs[i] < rhs[i] ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+
+        Digits AddMagnitudes(const Digits &lhs, const Digits &rhs) {
+            const Digits &longer = lhs.size() >= rhs.size() ? lhs : rhs;
+            const Digits &shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+            Digits result(longer.size() + 1);
+            uint64_t carry = 0;
+            for (size_t i = 0; i < longer.size(); ++i) {
+                carry += uint64_t{longer[i]} + (i < shorter.size() ? shorter[i] : 0);
+                result[i] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            result.back() = static_cast<uint32_t>(carry);
+            Trim(result);
+            return result;
+        }
+
+        // Разность модулей; lhs не меньше rhs
+        Digits SubtractMagnitudes(const Digits &lhs, const Digits &rhs) {
+            Digits result(lhs.size());
+            int64_t borrow = 0;
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                const int64_t difference = int64_t{lhs[i]} - (i < rhs.size() ? rhs[i] : 0) - borrow;
+                borrow = difference < 0 ? 1 : 0;
+                result[i] = static_cast<uint32_t>(difference);
+            }
+            Trim(result);
+            return result;
+        }
+
+        // Прибавляет addend, сдвинутое на shift разрядов; result достаточно длинный для суммы
+        void AddShifted(Digits &result, const Digits &addend, size_t shift) {
+            uint64_t carry = 0;
+            size_t i = 0;
+            for (; i < addend.size(); ++i) {
+                carry += uint64_t{result[i + shift]} + addend[i];
+                result[i + shift] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            for (; carry != 0; ++i) {
+                carry += result[i + shift];
+                result[i + shift] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+        }
+
+        Digits MultiplySchoolbook(const Digits &lhs, const Digits &rhs) {
+            Digits result(lhs.size() + rhs.size());
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                uint64_t carry = 0;
+                for (size_t j = 0; j < rhs.size(); ++j) {
+                    carry += uint64_t{lhs[i]} * rhs[j] + result[i + j];
+                    result[i + j] = static_cast<uint32_t>(carry);
+                    carry >>= 32;
+                }
+                result[i + rhs.size()] = static_cast<uint32_t>(carry);
+            }
+            Trim(result);
+            return result;
+        }
+
+        // Метод Карацубы: три умножения половинной длины вместо четырёх, O(n^1.585) вместо O(n^2).
+        // Короткие сомножители умножаются столбиком: на них рекурсия дороже самого умножения
+        Digits MultiplyMagnitudes(const Digits &lhs, const Digits &rhs) {
+            if (lhs.empty() || rhs.empty()) {
+                return {};
+            }
+            if (std::min(lhs.size(), rhs.size()) < BigInt::KARATSUBA_THRESHOLD) {
+                return MultiplySchoolbook(lhs, rhs);
+            }
+            const size_t half = std::max(lhs.size(), rhs.size()) / 2;
+            auto low = [half](const Digits &digits) {
+                Digits result(digits.begin(), digits.begin() + static_cast<std::ptrdiff_t>(std::min(half, digits.size())));
+                Trim(result);
+                return result;
+            };
+            auto high = [half](const Digits &digits) {
+                return digits.size() > half ? Digits(digits.begin() + static_cast<std::ptrdiff_t>(half), digits.end())
+                                            : Digits{};
+            };
+            const Digits lhs_low = low(lhs);
+            const Digits lhs_high = high(lhs);
+            const Digits rhs_low = low(rhs);
+            const Digits rhs_high = high(rhs);
+
+            const Digits z0 = MultiplyMagnitudes(lhs_low, rhs_low);
+            const Digits z2 = MultiplyMagnitudes(lhs_high, rhs_high);
+            const Digits sum_product = MultiplyMagnitudes(AddMagnitudes(lhs_low, lhs_high),
+                                                          AddMagnitudes(rhs_low, rhs_high));
+            const Digits z1 = SubtractMagnitudes(SubtractMagnitudes(sum_product, z0), z2);
+
+            Digits result(lhs.size() + rhs.size() + 1);
+            AddShifted(result, z0, 0);
+            AddShifted(result, z1, half);
+            AddShifted(result, z2, 2 * half);
+            Trim(result);
+            return result;
+        }
+
+        // Делит число на один разряд на месте и возвращает остаток
+        uint32_t DivideBySmall(Digits &digits, uint32_t divisor) {
+            uint64_t remainder = 0;
+            for (size_t i = digits.size(); i-- > 0;) {
+                const uint64_t current = (remainder << 32) | digits[i];
+                digits[i] = static_cast<uint32_t>(current / divisor);
+                remainder = current % divisor;
+            }
+            Trim(digits);
+            return static_cast<uint32_t>(remainder);
+        }
+
+        void MultiplyAddSmall(Digits &digits, uint32_t multiplier, uint32_t addend) {
+            uint64_t carry = addend;
+            for (uint32_t &digit : digits) {
+                carry += uint64_t{digit} * multiplier;
+                digit = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            if (carry != 0) {
+                digits.push_back(static_cast<uint32_t>(carry));
+            }
+        }
+
+        // Частное модулей без остатка, алгоритм D Кнута: цифра частного оценивается по старшим разрядам
+        // нормализованных чисел и уточняется не более чем двумя вычитаниями
+        Digits DivideMagnitudes(const Digits &dividend, const Digits &divisor) {
+            if (CompareMagnitudes(dividend, divisor) < 0) {
+                return {};
+            }
+            if (divisor.size() == 1) {
+                Digits quotient = dividend;
+                DivideBySmall(quotient, divisor.front());
+                return quotient;
+            }
+
+            const size_t n = divisor.size();
+            const size_t m = dividend.size() - n;
+            // Сдвиг, после которого старший разряд делителя не меньше BASE / 2
+            const int shift = __builtin_clz(divisor.back());
+            auto shifted = [shift](const Digits &digits, size_t size) {
+                Digits result(size);
+                for (size_t i = 0; i < digits.size(); ++i) {
+                    const uint64_t value = uint64_t{digits[i]} << shift;
+                    result[i] |= static_cast<uint32_t>(value);
+                    if (i + 1 < size) {
+                        result[i + 1] = static_cast<uint32_t>(value >> 32);
+                    }
+                }
+                return result;
+            };
+            const Digits v = shifted(divisor, n);
+            Digits u = shifted(dividend, dividend.size() + 1);
+
+            Digits quotient(m + 1);
+            for (size_t j = m + 1; j-- > 0;) {
+                const uint64_t numerator = (uint64_t{u[j + n]} << 32) | u[j + n - 1];
+                uint64_t q = numerator / v[n - 1];
+                uint64_t r = numerator % v[n - 1];
+                while (q >= BASE || q * v[n - 2] > ((r << 32) | u[j + n - 2])) {
+                    --q;
+                    r += v[n - 1];
+                    if (r >= BASE) {
+                        break;
+                    }
+                }
+
+                int64_t borrow = 0;
+                uint64_t carry = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    const uint64_t product = q * v[i] + carry;
+                    carry = product >> 32;
+                    const int64_t difference = int64_t{u[i + j]} - borrow - static_cast<int64_t>(product & 0xFFFFFFFFu);
+                    u[i + j] = static_cast<uint32_t>(difference);
+                    borrow = difference < 0 ? 1 : 0;
+                }
+                const int64_t difference = int64_t{u[j + n]} - borrow - static_cast<int64_t>(carry);
+                u[j + n] = static_cast<uint32_t>(difference);
+
+                // Оценка оказалась на единицу больше: делитель прибавляется обратно
+                if (difference < 0) {
+                    --q;
+                    uint64_t sum_carry = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        sum_carry += uint64_t{u[i + j]} + v[i];
+                        u[i + j] = static_cast<uint32_t>(sum_carry);
+                        sum_carry >>= 32;
+                    }
+                    u[j + n] += static_cast<uint32_t>(sum_carry);
+                }
+                quotient[j] = static_cast<uint32_t>(q);
+            }
+            Trim(quotient);
+            return quotient;
+        }
+
+        // Целый операнд в виде BigInt: сам объект или копия значения Number во временном storage
+        const BigInt *AsBigInt(const ObjectHolder &object, std::optional<BigInt> &storage) {
+            if (auto big = object.TryAs<BigInt>()) {
+                return big;
+            }
+            if (auto number = object.TryAs<Number>()) {
+                return &storage.emplace(number->GetValue());
+            }
+            return nullptr;
+        }
+
+        // Значение операнда, если это число любого типа
+        std::optional<double> AsDouble(const ObjectHolder &object) {
+            if (auto big = object.TryAs<BigInt>()) {
+                return big->ToDouble();
+            }
+            if (const std::optional<Numeric> number = AsNumeric(object)) {
+                return number->AsDouble();
+            }
+            return std::nullopt;
+        }
+    }
+
+    BigInt::BigInt(int64_t value)
+            : negative_(value < 0) {
+        uint64_t magnitude = negative_ ? uint64_t{0} - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        while (magnitude != 0) {
+            magnitude_.push_back(static_cast<uint32_t>(magnitude));
+            magnitude >>= 32;
+        }
+    }
+
+    BigInt::BigInt(Digits magnitude, bool negative)
+            : magnitude_(std::move(magnitude)), negative_(negative && !magnitude_.empty()) {}
+
+    std::optional<BigInt> BigInt::FromString(std::string_view text) {
+        bool negative = false;
+        if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+            negative = text.front() == '-';
+            text.remove_prefix(1);
+        }
+        if (text.empty()) {
+            return std::nullopt;
+        }
+        Digits digits;
+        // Первая порция короче остальных, чтобы все следующие содержали ровно 9 цифр
+        size_t chunk = text.size() % DECIMAL_CHUNK_DIGITS;
+        if (chunk == 0) {
+            chunk = DECIMAL_CHUNK_DIGITS;
+        }
+        while (!text.empty()) {
+            uint32_t value = 0;
+            uint32_t multiplier = 1;
+            for (char c : text.substr(0, chunk)) {
+                if (c < '0' || c > '9') {
+                    return std::nullopt;
+                }
+                value = value * 10 + static_cast<uint32_t>(c - '0');
+                multiplier *= 10;
+            }
+            MultiplyAddSmall(digits, multiplier, value);
+            text.remove_prefix(chunk);
+            chunk = DECIMAL_CHUNK_DIGITS;
+        }
+        Trim(digits);
+        return BigInt(std::move(digits), negative);
+    }
+
+    ObjectHolder BigInt::Normalize(BigInt value) {
+        if (const std::optional<int64_t> small = value.ToInt64()) {
+            return ObjectHolder::Own(Number(*small));
+        }
+        return ObjectHolder::Own(std::move(value));
+    }
+
+    void BigInt::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+        os << ToString();
+    }
+
+    std::string BigInt::ToString() const {
+        if (magnitude_.empty()) {
+            return "0"s;
+        }
+        Digits digits = magnitude_;
+        std::vector<uint32_t> chunks;
+        while (!digits.empty()) {
+            chunks.push_back(DivideBySmall(digits, DECIMAL_CHUNK));
+        }
+        std::string result = negative_ ? "-"s : ""s;
+        result += std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            const std::string chunk = std::to_string(chunks[i]);
+            result.append(DECIMAL_CHUNK_DIGITS - chunk.size(), '0');
+            result += chunk;
+        }
+        return result;
+    }
+
+    double BigInt::ToDouble() const {
+        double result = 0;
+        for (size_t i = magnitude_.size(); i-- > 0;) {
+            result = result * static_cast<double>(BASE) + magnitude_[i];
+        }
+        return negative_ ? -result : result;
+    }
+
+    std::optional<int64_t> BigInt::ToInt64() const {
+        if (magnitude_.size() > 2) {
+            return std::nullopt;
+        }
+        uint64_t magnitude = 0;
+        for (size_t i = magnitude_.size(); i-- > 0;) {
+            magnitude = (magnitude << 32) | magnitude_[i];
+        }
+        const auto max = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        if (!negative_ && magnitude <= max) {
+            return static_cast<int64_t>(magnitude);
+        }
+        if (negative_ && magnitude <= max + 1) {
+            return static_cast<int64_t>(uint64_t{0} - magnitude);
+        }
+        return std::nullopt;
+    }
+
+    bool BigInt::IsNegative() const {
+        return negative_;
+    }
+
+    bool BigInt::IsZero() const {
+        return magnitude_.empty();
+    }
+
+    size_t BigInt::GetDigitCount() const {
+        return magnitude_.size();
+    }
+
+    size_t BigInt::Hash() const {
+        size_t hash = negative_ ? 1 : 0;
+        for (uint32_t digit : magnitude_) {
+            hash = hash * 1'000'003 ^ std::hash<uint32_t>{}(digit);
+        }
+        return hash;
+    }
+
+    BigInt BigInt::operator-() const {
+        return BigInt(magnitude_, !negative_);
+    }
+
+    BigInt operator+(const BigInt &lhs, const BigInt &rhs) {
+        if (lhs.negative_ == rhs.negative_) {
+            return BigInt(AddMagnitudes(lhs.magnitude_, rhs.magnitude_), lhs.negative_);
+        }
+        const int order = CompareMagnitudes(lhs.magnitude_, rhs.magnitude_);
+        if (order == 0) {
+            return BigInt();
+        }
+        if (order > 0) {
+            return BigInt(SubtractMagnitudes(lhs.magnitude_, rhs.magnitude_), lhs.negative_);
+        }
+        return BigInt(SubtractMagnitudes(rhs.magnitude_, lhs.magnitude_), rhs.negative_);
+    }
+
+    BigInt operator-(const BigInt &lhs, const BigInt &rhs) {
+        return lhs + -rhs;
+    }
+
+    BigInt operator*(const BigInt &lhs, const BigInt &rhs) {
+        return BigInt(MultiplyMagnitudes(lhs.magnitude_, rhs.magnitude_), lhs.negative_ != rhs.negative_);
+    }
+
+    BigInt operator/(const BigInt &lhs, const BigInt &rhs) {
+        if (rhs.IsZero()) {
+            throw std::runtime_error("Division was failed"s);
+        }
+        return BigInt(DivideMagnitudes(lhs.magnitude_, rhs.magnitude_), lhs.negative_ != rhs.negative_);
+    }
+
+    int BigInt::Compare(const BigInt &lhs, const BigInt &rhs) {
+        if (lhs.negative_ != rhs.negative_) {
+            return lhs.negative_ ? -1 : 1;
+        }
+        const int order = CompareMagnitudes(lhs.magnitude_, rhs.magnitude_);
+        return lhs.negative_ ? -order : order;
+    }
+
+    std::optional<ObjectHolder> ApplyBigIntOperation(IntegerOperation operation, const ObjectHolder &lhs,
+                                                     const ObjectHolder &rhs) {
+        std::optional<BigInt> lhs_storage;
+        std::optional<BigInt> rhs_storage;
+        const BigInt *lhs_big = AsBigInt(lhs, lhs_storage);
+        const BigInt *rhs_big = AsBigInt(rhs, rhs_storage);
+        if (lhs_big != nullptr && rhs_big != nullptr) {
+            switch (operation) {
+                case IntegerOperation::Add:
+                    return BigInt::Normalize(*lhs_big + *rhs_big);
+                case IntegerOperation::Sub:
+                    return BigInt::Normalize(*lhs_big - *rhs_big);
+                case IntegerOperation::Mult:
+                    return BigInt::Normalize(*lhs_big * *rhs_big);
+                case IntegerOperation::Div:
+                    return BigInt::Normalize(*lhs_big / *rhs_big);
+            }
+        }
+
+        // BigInt и Float: вычисление в double, как у Number и Float
+        if (!lhs.TryAs<BigInt>() && !rhs.TryAs<BigInt>()) {
+            return std::nullopt;
+        }
+        const std::optional<double> lhs_value = AsDouble(lhs);
+        const std::optional<double> rhs_value = AsDouble(rhs);
+        if (!lhs_value || !rhs_value) {
+            return std::nullopt;
+        }
+        switch (operation) {
+            case IntegerOperation::Add:
+                return ObjectHolder::Own(Float(*lhs_value + *rhs_value));
+            case IntegerOperation::Sub:
+                return ObjectHolder::Own(Float(*lhs_value - *rhs_value));
+            case IntegerOperation::Mult:
+                return ObjectHolder::Own(Float(*lhs_value * *rhs_value));
+            case IntegerOperation::Div:
+                if (*rhs_value == 0) {
+                    throw std::runtime_error("Division was failed"s);
+                }
+                return ObjectHolder::Own(Float(*lhs_value / *rhs_value));
+        }
+        return std::nullopt;
+    }
+
+    std::optional<int> CompareBigInt(const ObjectHolder &lhs, const ObjectHolder &rhs) {
+        if (!lhs.TryAs<BigInt>() && !rhs.TryAs<BigInt>()) {
+            return std::nullopt;
+        }
+        std::optional<BigInt> lhs_storage;
+        std::optional<BigInt> rhs_storage;
+        const BigInt *lhs_big = AsBigInt(lhs, lhs_storage);
+        const BigInt *rhs_big = AsBigInt(rhs, rhs_storage);
+        if (lhs_big != nullptr && rhs_big != nullptr) {
+            return BigInt::Compare(*lhs_big, *rhs_big);
+        }
+        const std::optional<double> lhs_value = AsDouble(lhs);
+        const std::optional<double> rhs_value = AsDouble(rhs);
+        if (!lhs_value || !rhs_value) {
+            return std::nullopt;
+        }
+        return *lhs_value < *rhs_value ? -1 : (*lhs_value > *rhs_value ? 1 : 0);
+    }
+
+}
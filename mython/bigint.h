@@ -0,0 +1,72 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace runtime {
+
+    // Целочисленные операции, которые при переполнении int64_t продолжаются над BigInt
+    enum class IntegerOperation {
+        Add, Sub, Mult, Div
+    };
+
+// Целое число произвольной длины. Программа не отличает его от Number: арифметика над Number при переполнении
+// int64_t переходит к BigInt, а результат, который снова помещается в int64_t, возвращается как Number.
+// Поэтому значение BigInt всегда лежит вне диапазона int64_t, и равных Number и BigInt не бывает
+    class BigInt : public Object {
+    public:
+        // Число, начиная с которого сомножители умножаются методом Карацубы, в 32-битных разрядах
+        static constexpr size_t KARATSUBA_THRESHOLD = 32;
+
+        BigInt() = default;
+        explicit BigInt(int64_t value);
+
+        // Число из десятичной записи с необязательным знаком; nullopt, если запись некорректна
+        [[nodiscard]] static std::optional<BigInt> FromString(std::string_view text);
+        // Number, если значение помещается в int64_t, иначе BigInt
+        [[nodiscard]] static ObjectHolder Normalize(BigInt value);
+
+        void Print(std::ostream &os, Context &context) override;
+        [[nodiscard]] std::string ToString() const;
+        [[nodiscard]] double ToDouble() const;
+        [[nodiscard]] std::optional<int64_t> ToInt64() const;
+        [[nodiscard]] bool IsNegative() const;
+        [[nodiscard]] bool IsZero() const;
+        // Число 32-битных разрядов модуля
+        [[nodiscard]] size_t GetDigitCount() const;
+        [[nodiscard]] size_t Hash() const;
+
+        [[nodiscard]] BigInt operator-() const;
+        friend BigInt operator+(const BigInt &lhs, const BigInt &rhs);
+        friend BigInt operator-(const BigInt &lhs, const BigInt &rhs);
+        friend BigInt operator*(const BigInt &lhs, const BigInt &rhs);
+        // Деление с отбрасыванием дробной части, как у Number. При делении на ноль выбрасывает runtime_error
+        friend BigInt operator/(const BigInt &lhs, const BigInt &rhs);
+        // Отрицательное число, ноль или положительное число, если lhs меньше, равно или больше rhs
+        [[nodiscard]] static int Compare(const BigInt &lhs, const BigInt &rhs);
+    private:
+        // Разряды списываются с квоты (quota.h), как буферы List и Dict: длинная арифметика не выйдет за лимит
+        using Digits = QuotaVector<uint32_t>;
+
+        BigInt(Digits magnitude, bool negative);
+
+        // Модуль числа в системе счисления 2^32: младшие разряды первыми, без ведущих нулей
+        Digits magnitude_;
+        bool negative_ = false;
+    };
+
+    // Операция над числами, если хотя бы одно из них — BigInt, или над двумя Number, операция над которыми
+    // переполнила int64_t. С Float результат вещественный. Если операнды не числа, возвращает nullopt
+    std::optional<ObjectHolder> ApplyBigIntOperation(IntegerOperation operation, const ObjectHolder &lhs,
+                                                     const ObjectHolder &rhs);
+
+    // Сравнивает числа, если хотя бы одно из них — BigInt: результат как у BigInt::Compare.
+    // Для остальных пар операндов возвращает nullopt
+    std::optional<int> CompareBigInt(const ObjectHolder &lhs, const ObjectHolder &rhs);
+
+}
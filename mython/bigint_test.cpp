@@ -0,0 +1,130 @@
+#include "bigint.h"
+
+#include <test_runner.h>
+
+#include <limits>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+
+BigInt Parse(const string& text) {
+    const optional<BigInt> result = BigInt::FromString(text);
+    ASSERT(result.has_value());
+    return *result;
+}
+
+// Число из count повторений цифры digit: удобный источник длинных сомножителей
+BigInt Repeat(char digit, size_t count) {
+    return Parse(string(count, digit));
+}
+
+BigInt Factorial(int n) {
+    BigInt result(1);
+    for (int i = 2; i <= n; ++i) {
+        result = result * BigInt(i);
+    }
+    return result;
+}
+
+void TestBigIntParseAndPrint() {
+    ASSERT_EQUAL(BigInt().ToString(), "0"s);
+    ASSERT_EQUAL(BigInt(numeric_limits<int64_t>::min()).ToString(), "-9223372036854775808"s);
+    ASSERT_EQUAL(Parse("-0"s).ToString(), "0"s);
+    ASSERT(!Parse("-0"s).IsNegative());
+    ASSERT_EQUAL(Parse("000123"s).ToString(), "123"s);
+    ASSERT_EQUAL(Parse("+18446744073709551616"s).ToString(), "18446744073709551616"s);
+
+    const string long_number = "-1000000000000000000000000000000000000000000000000000000000000000000000000000000000001"s;
+    ASSERT_EQUAL(Parse(long_number).ToString(), long_number);
+
+    ASSERT(!BigInt::FromString(""s));
+    ASSERT(!BigInt::FromString("-"s));
+    ASSERT(!BigInt::FromString("12a"s));
+}
+
+void TestBigIntArithmetic() {
+    ASSERT_EQUAL(Factorial(30).ToString(), "265252859812191058636308480000000"s);
+    ASSERT_EQUAL(Factorial(50).ToString(),
+                 "30414093201713378043612608166064768844377641568960512000000000000"s);
+    ASSERT_EQUAL((Factorial(50) / Factorial(48)).ToString(), "2450"s);
+
+    const BigInt two_64 = Parse("18446744073709551616"s);
+    ASSERT_EQUAL((two_64 - BigInt(1)).ToString(), "18446744073709551615"s);
+    ASSERT_EQUAL((BigInt(1) - two_64).ToString(), "-18446744073709551615"s);
+    ASSERT_EQUAL((two_64 + -two_64).ToString(), "0"s);
+    ASSERT_EQUAL((-two_64 * BigInt(-3)).ToString(), "55340232221128654848"s);
+
+    // Деление отбрасывает дробную часть в сторону нуля, как у Number
+    ASSERT_EQUAL((-two_64 / BigInt(10)).ToString(), "-1844674407370955161"s);
+    ASSERT_EQUAL((BigInt(7) / two_64).ToString(), "0"s);
+    ASSERT_THROWS(static_cast<void>(two_64 / BigInt()), runtime_error);
+
+    ASSERT(BigInt::Compare(-two_64, BigInt(-1)) < 0);
+    ASSERT(BigInt::Compare(two_64, BigInt(numeric_limits<int64_t>::max())) > 0);
+    ASSERT_EQUAL(BigInt::Compare(Parse("123456789012345678901234567890"s), Parse("123456789012345678901234567890"s)), 0);
+    ASSERT_EQUAL(Parse("123456789012345678901234567890"s).Hash(), Parse("123456789012345678901234567890"s).Hash());
+    ASSERT_EQUAL(two_64.ToDouble(), 18446744073709551616.0);
+}
+
+void TestBigIntLargeMultiplication() {
+    // (10^k - 1)^2 = 99..9800..01: сомножители длиннее порога, поэтому работает метод Карацубы
+    const size_t k = 1000;
+    const BigInt nines = Repeat('9', k);
+    ASSERT_EQUAL((nines * nines).ToString(), string(k - 1, '9') + "8"s + string(k - 1, '0') + "1"s);
+
+    // Сомножители разной длины и деление обратно: частное должно совпасть с другим сомножителем
+    const BigInt a = Parse(string(700, '7') + "123456789"s);
+    const BigInt b = Parse("-"s + string(1500, '3') + "987654321"s);
+    const BigInt product = a * b;
+    ASSERT_EQUAL(BigInt::Compare(product / a, b), 0);
+    ASSERT_EQUAL(BigInt::Compare(product / b, a), 0);
+    ASSERT_EQUAL(BigInt::Compare((a + b) * (a + b), a * a + BigInt(2) * product + b * b), 0);
+
+    // Остаток dividend - q * a лежит в [0, a)
+    const BigInt dividend = -product + Parse(string(600, '5'));
+    const BigInt quotient = dividend / a;
+    const BigInt remainder = dividend - quotient * a;
+    ASSERT(!remainder.IsNegative());
+    ASSERT(BigInt::Compare(remainder, a) < 0);
+}
+
+void TestBigIntPromotion() {
+    const ObjectHolder max = ObjectHolder::Own(Number{numeric_limits<int64_t>::max()});
+    const ObjectHolder one = ObjectHolder::Own(Number{1});
+
+    const optional<ObjectHolder> sum = ApplyBigIntOperation(IntegerOperation::Add, max, one);
+    ASSERT(sum && sum->TryAs<BigInt>());
+    ASSERT_EQUAL(sum->TryAs<BigInt>()->ToString(), "9223372036854775808"s);
+
+    // Результат, который снова помещается в int64_t, возвращается как Number
+    const optional<ObjectHolder> back = ApplyBigIntOperation(IntegerOperation::Sub, *sum, one);
+    ASSERT(back && back->TryAs<Number>());
+    ASSERT_EQUAL(back->TryAs<Number>()->GetValue(), numeric_limits<int64_t>::max());
+
+    const optional<ObjectHolder> real = ApplyBigIntOperation(IntegerOperation::Mult, *sum, ObjectHolder::Own(Float{0.5}));
+    ASSERT(real && real->TryAs<Float>());
+    ASSERT_EQUAL(real->TryAs<Float>()->GetValue(), 4611686018427387904.0);
+
+    ASSERT(!ApplyBigIntOperation(IntegerOperation::Add, *sum, ObjectHolder::Own(String{"x"s})));
+    ASSERT_THROWS(ApplyBigIntOperation(IntegerOperation::Div, *sum, ObjectHolder::Own(Number{0})), runtime_error);
+
+    ASSERT_EQUAL(CompareBigInt(*sum, max).value_or(0), 1);
+    ASSERT_EQUAL(CompareBigInt(ObjectHolder::Own(Float{1e19}), *sum).value_or(0), 1);
+    ASSERT(!CompareBigInt(max, one));
+
+    ASSERT(BigInt::Normalize(BigInt(numeric_limits<int64_t>::min())).TryAs<Number>());
+}
+
+}  // namespace
+
+void RunBigIntTests(TestRunner& tr) {
+    RUN_TEST(tr, runtime::TestBigIntParseAndPrint);
+    RUN_TEST(tr, runtime::TestBigIntArithmetic);
+    RUN_TEST(tr, runtime::TestBigIntLargeMultiplication);
+    RUN_TEST(tr, runtime::TestBigIntPromotion);
+}
+
+}  // namespace runtime
@@ -0,0 +1,413 @@
+#include "builtins.h"
+
+#include "array.h"
+#include "bigint.h"
+#include "gc.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    namespace {
+        const std::string NONE_LITERAL = "None"s;
+
+        // Аргументы-размеры и коды символов ограничены int, хотя Number хранит int64_t
+        int ExpectInt(const ObjectHolder &object, const std::string &function) {
+            if (auto number = object.TryAs<Number>()) {
+                const int64_t value = number->GetValue();
+                if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+                    throw std::runtime_error(function + "() argument is out of range"s);
+                }
+                return static_cast<int>(value);
+            }
+            if (object.TryAs<BigInt>()) {
+                throw std::runtime_error(function + "() argument is out of range"s);
+            }
+            throw std::runtime_error(function + "() argument must be an integer"s);
+        }
+
+        ObjectHolder Range(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            const int start = args.size() > 1 ? ExpectInt(args[0], "range"s) : 0;
+            const int stop = ExpectInt(args[args.size() > 1 ? 1 : 0], "range"s);
+            const int step = args.size() > 2 ? ExpectInt(args[2], "range"s) : 1;
+            if (step == 0) {
+                throw std::runtime_error("range() step must not be zero"s);
+            }
+            std::vector<ObjectHolder> items;
+            if (step > 0 ? start < stop : start > stop) {
+                const long long distance = std::abs(static_cast<long long>(stop) - start);
+                items.reserve(static_cast<size_t>((distance + std::abs(step) - 1) / std::abs(step)));
+            }
+            for (long long i = start; step > 0 ? i < stop : i > stop; i += step) {
+                items.push_back(ObjectHolder::Own(Number(i)));
+            }
+            return ObjectHolder::Own(List(std::move(items)));
+        }
+
+        ObjectHolder Abs(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            if (auto big = args[0].TryAs<BigInt>()) {
+                return big->IsNegative() ? ObjectHolder::Own(-*big) : args[0];
+            }
+            const std::optional<Numeric> number = AsNumeric(args[0]);
+            if (!number) {
+                throw std::runtime_error("abs() argument must be a number"s);
+            }
+            if (number->is_float) {
+                return ObjectHolder::Own(Float(std::fabs(number->float_value)));
+            }
+            // Модуль INT64_MIN не помещается в int64_t
+            if (number->int_value == std::numeric_limits<int64_t>::min()) {
+                return ObjectHolder::Own(-BigInt(number->int_value));
+            }
+            return ObjectHolder::Own(Number(std::abs(number->int_value)));
+        }
+
+        // min и max принимают либо несколько значений, либо один список
+        template <typename Better>
+        ObjectHolder SelectExtremum(ArgumentSpan args, Context &context, const std::string &function, Better better) {
+            ArgumentSpan candidates = args;
+            if (args.size() == 1) {
+                const List *list = args[0].TryAs<List>();
+                if (list == nullptr) {
+                    throw std::runtime_error(function + "() with one argument expects a list"s);
+                }
+                candidates = ArgumentSpan(list->Size() > 0 ? &list->At(0) : nullptr, list->Size());
+            }
+            if (candidates.empty()) {
+                throw std::runtime_error(function + "() argument is an empty list"s);
+            }
+            ObjectHolder result = candidates[0];
+            for (size_t i = 1; i < candidates.size(); ++i) {
+                if (better(candidates[i], result, context)) {
+                    result = candidates[i];
+                }
+            }
+            return result;
+        }
+
+        ObjectHolder ToInt(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            const ObjectHolder &value = args[0];
+            if (value.TryAs<Number>() || value.TryAs<BigInt>()) {
+                return value;
+            }
+            if (auto real = value.TryAs<Float>()) {
+                // Правая граница исключена: 2^63 уже не помещается в int64_t
+                const double truncated = std::trunc(real->GetValue());
+                if (!(truncated >= -0x1p63 && truncated < 0x1p63)) {
+                    throw std::runtime_error("int() argument is out of range"s);
+                }
+                return ObjectHolder::Own(Number(static_cast<int64_t>(truncated)));
+            }
+            if (auto boolean = value.TryAs<Bool>()) {
+                return ObjectHolder::Own(Number(boolean->GetValue() ? 1 : 0));
+            }
+            if (auto str = value.TryAs<String>()) {
+                std::string_view text = str->GetValue();
+                text.remove_prefix(std::min(text.find_first_not_of(' '), text.size()));
+                text.remove_suffix(text.size() - (text.find_last_not_of(' ') + 1));
+                if (!text.empty() && text.front() == '+') {
+                    text.remove_prefix(1);
+                }
+                int64_t result = 0;
+                const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+                if (!text.empty() && error == std::errc() && end == text.data() + text.size()) {
+                    return ObjectHolder::Own(Number(result));
+                }
+                // Запись, которая не поместилась в int64_t, читается как BigInt
+                if (error == std::errc::result_out_of_range && end == text.data() + text.size()) {
+                    return BigInt::Normalize(*BigInt::FromString(text));
+                }
+                throw std::runtime_error("invalid literal for int(): '"s + std::string(str->GetValue()) + "'"s);
+            }
+            throw std::runtime_error("int() argument must be a number, a string or a bool"s);
+        }
+
+        ObjectHolder Ord(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            auto str = args[0].TryAs<String>();
+            if (str == nullptr || str->Size() != 1) {
+                throw std::runtime_error("ord() expects a string of length 1"s);
+            }
+            return ObjectHolder::Own(Number(static_cast<unsigned char>(str->GetValue().front())));
+        }
+
+        ObjectHolder Chr(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            const int code = ExpectInt(args[0], "chr"s);
+            if (code < 0 || code > std::numeric_limits<unsigned char>::max()) {
+                throw std::runtime_error("chr() argument must be in range 0..255"s);
+            }
+            return ObjectHolder::Own(String(std::string(1, static_cast<char>(code))));
+        }
+
+        ObjectHolder IsInstance(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            if (auto native_cls = args[1].TryAs<NativeClass>()) {
+                auto native = args[0].TryAs<NativeObject>();
+                return ObjectHolder::Own(Bool(native != nullptr && &native->GetClass() == native_cls));
+            }
+            auto cls = args[1].TryAs<Class>();
+            if (cls == nullptr) {
+                throw std::runtime_error("isinstance() second argument must be a class"s);
+            }
+            auto instance = args[0].TryAs<ClassInstance>();
+            return ObjectHolder::Own(Bool(instance != nullptr && instance->GetClass().IsSubclassOf(*cls)));
+        }
+
+        // array(list) — массив из элементов списка, array(size, value) — массив из size копий числа value
+        ObjectHolder MakeArray(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            if (args.size() == 1) {
+                auto list = args[0].TryAs<List>();
+                if (list == nullptr) {
+                    throw std::runtime_error("array() with one argument expects a list"s);
+                }
+                return ObjectHolder::Own(Array::FromList(*list));
+            }
+            const int size = ExpectInt(args[0], "array"s);
+            if (size < 0) {
+                throw std::runtime_error("array() size must not be negative"s);
+            }
+            const std::optional<Numeric> value = AsNumeric(args[1]);
+            if (!value) {
+                throw std::runtime_error("array() fill value must be a number"s);
+            }
+            // Квота проверяется до выделения памяти: массив может оказаться больше всей остальной программы
+            static_cast<void>(HeapCharge(size * sizeof(int64_t)));
+            if (value->is_float) {
+                return ObjectHolder::Own(Array(std::vector<double>(size, value->float_value)));
+            }
+            return ObjectHolder::Own(Array(std::vector<int64_t>(size, value->int_value)));
+        }
+
+        // next(generator) — следующее значение генератора; у завершённого генератора — default или None
+        ObjectHolder Next(ArgumentSpan args, Context &context) {
+            auto generator = args[0].TryAs<Generator>();
+            if (generator == nullptr) {
+                throw std::runtime_error("next() argument must be a generator"s);
+            }
+            if (std::optional<ObjectHolder> value = generator->Next(context)) {
+                return *value;
+            }
+            return args.size() > 1 ? args[1] : ObjectHolder::None();
+        }
+
+        // list(iterable) — новый список из элементов списка, массива, генератора или ключей словаря
+        ObjectHolder ToList(ArgumentSpan args, Context &context) {
+            std::vector<ObjectHolder> items;
+            if (auto generator = args[0].TryAs<Generator>()) {
+                while (std::optional<ObjectHolder> value = generator->Next(context)) {
+                    items.push_back(std::move(*value));
+                }
+            } else if (auto list = args[0].TryAs<List>()) {
+                for (size_t i = 0; i < list->Size(); ++i) {
+                    items.push_back(list->At(static_cast<int64_t>(i)));
+                }
+            } else if (auto dict = args[0].TryAs<Dict>()) {
+                for (size_t i = 0; i < dict->Size(); ++i) {
+                    items.push_back(dict->KeyAt(i));
+                }
+            } else if (auto array = args[0].TryAs<Array>()) {
+                for (size_t i = 0; i < array->Size(); ++i) {
+                    items.push_back(array->At(static_cast<int64_t>(i)));
+                }
+            } else {
+                throw std::runtime_error("list() argument must be iterable"s);
+            }
+            return ObjectHolder::Own(List(std::move(items)));
+        }
+
+        // Кэш метода, объявленного с @memo: первый аргумент — класс, второй — имя метода
+        MemoCache &FindMemo(ArgumentSpan args, const std::string &function) {
+            auto cls = args[0].TryAs<Class>();
+            auto name = args[1].TryAs<String>();
+            if (cls == nullptr || name == nullptr) {
+                throw std::runtime_error(function + "() expects a class and a method name"s);
+            }
+            const Method *method = cls->GetMethod(std::string(name->GetValue()));
+            if (method == nullptr || method->memo == nullptr) {
+                throw std::runtime_error(function + "(): method "s + std::string(name->GetValue())
+                                         + " is not declared with @memo"s);
+            }
+            return *method->memo;
+        }
+
+        // Словарь счётчиков для memo_stats и gc_stats
+        ObjectHolder MakeCounters(std::initializer_list<std::pair<std::string, size_t>> counters, Context &context) {
+            ObjectHolder result = ObjectHolder::Own(Dict{});
+            for (const auto &[name, value] : counters) {
+                const auto clamped = std::min<size_t>(value, std::numeric_limits<int64_t>::max());
+                result.TryAs<Dict>()->Set(ObjectHolder::Own(String{name}),
+                                          ObjectHolder::Own(Number{static_cast<int64_t>(clamped)}), context);
+            }
+            return result;
+        }
+
+        // memo_stats(cls, name) — словарь со счётчиками кэша метода: hits, misses, evictions, bypasses,
+        // а также числом сохранённых результатов size и ёмкостью capacity
+        ObjectHolder MemoStats(ArgumentSpan args, Context &context) {
+            const MemoCache &memo = FindMemo(args, "memo_stats"s);
+            const MemoCache::Stats &stats = memo.GetStats();
+            return MakeCounters({
+                    {"hits"s, stats.hits},
+                    {"misses"s, stats.misses},
+                    {"evictions"s, stats.evictions},
+                    {"bypasses"s, stats.bypasses},
+                    {"size"s, memo.Size()},
+                    {"capacity"s, memo.Capacity()},
+            }, context);
+        }
+
+        // memo_clear(cls, name) — удаляет сохранённые результаты метода; счётчики сохраняются
+        ObjectHolder MemoClear(ArgumentSpan args, [[maybe_unused]] Context &context) {
+            FindMemo(args, "memo_clear"s).Clear();
+            return ObjectHolder::None();
+        }
+
+        // gc_collect() — собирает циклы ссылок, даже если сборщик выключен, и возвращает число освобождённых объектов
+        ObjectHolder GcCollect([[maybe_unused]] ArgumentSpan args, [[maybe_unused]] Context &context) {
+            return ObjectHolder::Own(Number(static_cast<int64_t>(CollectGarbage())));
+        }
+
+        // gc_stats() — словарь со счётчиками сборщика: collections, collected, objects (живые объекты кучи),
+        // pause_total_us и pause_max_us
+        ObjectHolder GcStatistics([[maybe_unused]] ArgumentSpan args, Context &context) {
+            const GcStats stats = GetGcStats();
+            using std::chrono::duration_cast;
+            using std::chrono::microseconds;
+            return MakeCounters({
+                    {"collections"s, stats.collections},
+                    {"collected"s, stats.collected},
+                    {"objects"s, stats.live_objects},
+                    {"pause_total_us"s, static_cast<size_t>(duration_cast<microseconds>(stats.total_pause).count())},
+                    {"pause_max_us"s, static_cast<size_t>(duration_cast<microseconds>(stats.max_pause).count())},
+            }, context);
+        }
+
+        BuiltinRegistry MakeStandardBuiltins() {
+            BuiltinRegistry registry;
+            registry.Register("str"s, 1, 1, [](ArgumentSpan args, Context &context) {
+                return Str(args[0], context);
+            });
+            registry.Register("len"s, 1, 1, [](ArgumentSpan args, [[maybe_unused]] Context &context) {
+                return Len(args[0]);
+            });
+            registry.Register("range"s, 1, 3, Range);
+            registry.Register("abs"s, 1, 1, Abs);
+            registry.Register("min"s, 1, std::numeric_limits<size_t>::max(), [](ArgumentSpan args, Context &context) {
+                return SelectExtremum(args, context, "min"s, Less);
+            });
+            registry.Register("max"s, 1, std::numeric_limits<size_t>::max(), [](ArgumentSpan args, Context &context) {
+                return SelectExtremum(args, context, "max"s, Greater);
+            });
+            registry.Register("int"s, 1, 1, ToInt);
+            registry.Register("ord"s, 1, 1, Ord);
+            registry.Register("chr"s, 1, 1, Chr);
+            registry.Register("isinstance"s, 2, 2, IsInstance);
+            registry.Register("array"s, 1, 2, MakeArray);
+            registry.Register("next"s, 1, 2, Next);
+            registry.Register("list"s, 1, 1, ToList);
+            registry.Register("memo_stats"s, 2, 2, MemoStats);
+            registry.Register("memo_clear"s, 2, 2, MemoClear);
+            registry.Register("gc_collect"s, 0, 0, GcCollect);
+            registry.Register("gc_stats"s, 0, 0, GcStatistics);
+            return registry;
+        }
+    }
+
+    void BuiltinRegistry::Register(std::string name, size_t min_args, size_t max_args, NativeFunction function) {
+        Builtin builtin{name, min_args, max_args, std::move(function)};
+        builtins_.insert_or_assign(std::move(name), std::move(builtin));
+    }
+
+    const Builtin *BuiltinRegistry::Find(const std::string &name) const {
+        auto it = builtins_.find(name);
+        return it != builtins_.end() ? &it->second : nullptr;
+    }
+
+    BuiltinRegistry &Builtins() {
+        static BuiltinRegistry registry = MakeStandardBuiltins();
+        return registry;
+    }
+
+    NativeClass::NativeClass(std::string name)
+            : name_(std::move(name)) {}
+
+    NativeClass &NativeClass::AddMethod(std::string name, size_t min_args, size_t max_args, NativeMethod method) {
+        NativeMethodEntry entry{name, min_args, max_args, std::move(method)};
+        methods_.insert_or_assign(std::move(name), std::move(entry));
+        return *this;
+    }
+
+    const NativeMethodEntry *NativeClass::GetMethod(const std::string &name) const {
+        auto it = methods_.find(name);
+        return it != methods_.end() ? &it->second : nullptr;
+    }
+
+    const std::string &NativeClass::GetName() const {
+        return name_;
+    }
+
+    void NativeClass::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+        os << "Class "s << name_;
+    }
+
+    NativeObject::NativeObject(const NativeClass &cls)
+            : cls_(cls) {}
+
+    ObjectHolder NativeObject::Call(const std::string &method, ArgumentSpan args, Context &context) {
+        const NativeMethodEntry *entry = cls_.GetMethod(method);
+        if (entry == nullptr || args.size() < entry->min_args || args.size() > entry->max_args) {
+            throw std::runtime_error("no method to call"s);
+        }
+        return entry->method(*this, args, context);
+    }
+
+    const NativeClass &NativeObject::GetClass() const {
+        return cls_;
+    }
+
+    void NativeObject::Print(std::ostream &os, Context &context) {
+        const NativeMethodEntry *str_method = cls_.GetMethod("__str__"s);
+        if (str_method != nullptr && str_method->min_args == 0) {
+            ObjectHolder result = str_method->method(*this, ArgumentSpan(nullptr, 0), context);
+            if (result) {
+                result->Print(os, context);
+                return;
+            }
+        }
+        os << this;
+    }
+
+    ObjectHolder Str(const ObjectHolder &object, Context &context) {
+        if (!object) return ObjectHolder::Own(String(NONE_LITERAL));
+        // Строки неизменяемы, поэтому str от строки возвращает её саму, а число форматируется без потока
+        if (object.TryAs<String>()) return object;
+        if (auto number_ptr = object.TryAs<Number>()) {
+            return ObjectHolder::Own(String(std::to_string(number_ptr->GetValue())));
+        }
+        std::ostringstream output;
+        object->Print(output, context);
+        return ObjectHolder::Own(String(output.str()));
+    }
+
+    ObjectHolder Len(const ObjectHolder &object) {
+        if (auto list_ptr = object.TryAs<List>()) {
+            return ObjectHolder::Own(Number(static_cast<int64_t>(list_ptr->Size())));
+        }
+        if (auto dict_ptr = object.TryAs<Dict>()) {
+            return ObjectHolder::Own(Number(static_cast<int64_t>(dict_ptr->Size())));
+        }
+        if (auto str_ptr = object.TryAs<String>()) {
+            return ObjectHolder::Own(Number(static_cast<int64_t>(str_ptr->Size())));
+        }
+        if (auto array_ptr = object.TryAs<Array>()) {
+            return ObjectHolder::Own(Number(static_cast<int64_t>(array_ptr->Size())));
+        }
+        throw std::runtime_error("object has no len()"s);
+    }
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace runtime {
+
+    // Представление аргументов встроенной функции без владения (аналог std::span из C++20).
+    // Аргументы лежат в массиве на стеке вызывающего узла, поэтому вызов не создаёт std::vector
+    class ArgumentSpan {
+    public:
+        ArgumentSpan(const ObjectHolder *data, size_t size)
+                : data_(data), size_(size) {
+        }
+
+        [[nodiscard]] size_t size() const {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size_ == 0;
+        }
+
+        const ObjectHolder &operator[](size_t index) const {
+            return data_[index];
+        }
+
+        [[nodiscard]] const ObjectHolder *begin() const {
+            return data_;
+        }
+
+        [[nodiscard]] const ObjectHolder *end() const {
+            return data_ + size_;
+        }
+    private:
+        const ObjectHolder *data_;
+        size_t size_;
+    };
+
+    using NativeFunction = std::function<ObjectHolder(ArgumentSpan, Context &)>;
+
+    struct Builtin {
+        std::string name;
+        size_t min_args;
+        size_t max_args;
+        NativeFunction function;
+    };
+
+    // Реестр встроенных функций. Парсер ищет в нём имя вызываемой функции и привязывает узел вызова
+    // прямо к найденной записи, поэтому во время выполнения поиска по имени нет.
+    // Число аргументов проверяется при разборе по диапазону [min_args, max_args]
+    class BuiltinRegistry {
+    public:
+        // Регистрирует функцию или заменяет уже зарегистрированную с тем же именем.
+        // Регистрировать функции нужно до начала разбора программы
+        void Register(std::string name, size_t min_args, size_t max_args, NativeFunction function);
+        [[nodiscard]] const Builtin *Find(const std::string &name) const;
+    private:
+        std::unordered_map<std::string, Builtin> builtins_;
+    };
+
+    class NativeObject;
+
+    // Метод класса, реализованного на C++; self — объект, у которого вызван метод
+    using NativeMethod = std::function<ObjectHolder(NativeObject &self, ArgumentSpan, Context &)>;
+
+    struct NativeMethodEntry {
+        std::string name;
+        size_t min_args;
+        size_t max_args;
+        NativeMethod method;
+    };
+
+    // Класс, методы которого реализованы на C++. Программа вызывает их так же, как методы своих классов:
+    // obj.method(args). Число аргументов проверяется при вызове, потому что тип объекта известен только тогда
+    class NativeClass : public Object {
+    public:
+        explicit NativeClass(std::string name);
+
+        // Добавляет метод или заменяет уже добавленный с тем же именем
+        NativeClass &AddMethod(std::string name, size_t min_args, size_t max_args, NativeMethod method);
+        [[nodiscard]] const NativeMethodEntry *GetMethod(const std::string &name) const;
+        [[nodiscard]] const std::string &GetName() const;
+        void Print(std::ostream &os, Context &context) override;
+    private:
+        std::string name_;
+        std::unordered_map<std::string, NativeMethodEntry> methods_;
+    };
+
+    class NativeObject : public Object {
+    public:
+        explicit NativeObject(const NativeClass &cls);
+
+        ObjectHolder Call(const std::string &method, ArgumentSpan args, Context &context);
+        [[nodiscard]] const NativeClass &GetClass() const;
+        // Выводит результат метода __str__, если он есть, иначе адрес объекта
+        void Print(std::ostream &os, Context &context) override;
+
+        // Значение, которое хранит объект HostObject<T>. Для объекта другого типа выбрасывает runtime_error
+        template <typename T>
+        T &As();
+    private:
+        const NativeClass &cls_;
+    };
+
+    // Объект хоста внутри программы. Значение хранится в самом объекте, и методы класса работают с ним
+    // напрямую, без преобразования в объекты Mython
+    template <typename T>
+    class HostObject : public NativeObject {
+    public:
+        HostObject(const NativeClass &cls, T value)
+                : NativeObject(cls), value_(std::move(value)) {
+        }
+
+        T &Value() {
+            return value_;
+        }
+    private:
+        T value_;
+    };
+
+    template <typename T>
+    T &NativeObject::As() {
+        if (auto host = dynamic_cast<HostObject<T> *>(this)) {
+            return host->Value();
+        }
+        throw std::runtime_error("object of class " + cls_.GetName() + " holds a value of another type");
+    }
+
+    // Реестр со стандартными встроенными функциями: str, len, range, abs, min, max, int, ord, chr, isinstance, array, next, list,
+    // memo_stats, memo_clear, gc_collect, gc_stats
+    BuiltinRegistry &Builtins();
+
+    // Реализации встроенных функций str и len. Str также выполняет узел ast::Stringify
+    ObjectHolder Str(const ObjectHolder &object, Context &context);
+    ObjectHolder Len(const ObjectHolder &object);
+
+}
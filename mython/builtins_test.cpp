@@ -0,0 +1,134 @@
+#include "builtins.h"
+
+#include <test_runner.h>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+
+ObjectHolder Call(const string& name, vector<ObjectHolder> args, Context& context) {
+    const Builtin* builtin = Builtins().Find(name);
+    ASSERT(builtin != nullptr);
+    ASSERT(args.size() >= builtin->min_args && args.size() <= builtin->max_args);
+    return builtin->function(ArgumentSpan(args.data(), args.size()), context);
+}
+
+string Printed(const ObjectHolder& object, Context& context) {
+    ostringstream out;
+    object->Print(out, context);
+    return out.str();
+}
+
+void TestArgumentSpan() {
+    vector<ObjectHolder> values{ObjectHolder::Own(Number{1}), ObjectHolder::None(), ObjectHolder::Own(Number{3})};
+    ArgumentSpan span(values.data(), values.size());
+
+    ASSERT_EQUAL(span.size(), 3U);
+    ASSERT(!span.empty());
+    ASSERT_EQUAL(span[2].Get(), values[2].Get());
+    size_t count = 0;
+    for (const ObjectHolder& value : span) {
+        ASSERT_EQUAL(value.Get(), values[count++].Get());
+    }
+    ASSERT_EQUAL(count, 3U);
+    ASSERT(ArgumentSpan(nullptr, 0).empty());
+}
+
+void TestRegistry() {
+    BuiltinRegistry registry;
+    ASSERT(registry.Find("twice"s) == nullptr);
+
+    int calls = 0;
+    registry.Register("twice"s, 1, 1, [&calls](ArgumentSpan args, [[maybe_unused]] Context& context) {
+        ++calls;
+        return ObjectHolder::Own(Number{args[0].TryAs<Number>()->GetValue() * 2});
+    });
+    const Builtin* twice = registry.Find("twice"s);
+    ASSERT(twice != nullptr);
+    ASSERT_EQUAL(twice->name, "twice"s);
+
+    DummyContext context;
+    ObjectHolder argument = ObjectHolder::Own(Number{21});
+    ASSERT_EQUAL(twice->function(ArgumentSpan(&argument, 1), context).TryAs<Number>()->GetValue(), 42);
+    ASSERT_EQUAL(calls, 1);
+
+    // Повторная регистрация заменяет функцию, а указатель на запись остаётся действительным
+    registry.Register("twice"s, 1, 2, [](ArgumentSpan, Context&) {
+        return ObjectHolder::None();
+    });
+    ASSERT_EQUAL(registry.Find("twice"s), twice);
+    ASSERT_EQUAL(twice->max_args, 2U);
+    ASSERT(!twice->function(ArgumentSpan(&argument, 1), context));
+}
+
+void TestStandardBuiltins() {
+    DummyContext context;
+    auto number = [](int value) {
+        return ObjectHolder::Own(Number{value});
+    };
+    auto str = [](string value) {
+        return ObjectHolder::Own(String{move(value)});
+    };
+
+    ASSERT_EQUAL(Printed(Call("range"s, {number(3)}, context), context), "[0, 1, 2]"s);
+    ASSERT_EQUAL(Printed(Call("range"s, {number(10), number(0), number(-3)}, context), context), "[10, 7, 4, 1]"s);
+    ASSERT_EQUAL(Printed(Call("range"s, {number(5), number(2)}, context), context), "[]"s);
+    ASSERT_THROWS(Call("range"s, {number(1), number(2), number(0)}, context), runtime_error);
+
+    ASSERT_EQUAL(Printed(Call("abs"s, {number(-7)}, context), context), "7"s);
+    ASSERT_EQUAL(Printed(Call("abs"s, {ObjectHolder::Own(Float{-2.5})}, context), context), "2.5"s);
+    ASSERT_THROWS(Call("abs"s, {str("x"s)}, context), runtime_error);
+
+    ASSERT_EQUAL(Printed(Call("min"s, {number(4), number(-1), number(9)}, context), context), "-1"s);
+    ASSERT_EQUAL(Printed(Call("max"s, {number(4), ObjectHolder::Own(Float{9.5}), number(9)}, context), context),
+                 "9.5"s);
+    ASSERT_EQUAL(Printed(Call("max"s, {ObjectHolder::Own(List{{str("b"s), str("c"s), str("a"s)}})}, context), context),
+                 "c"s);
+    ASSERT_THROWS(Call("min"s, {ObjectHolder::Own(List{})}, context), runtime_error);
+    ASSERT_THROWS(Call("min"s, {number(1)}, context), runtime_error);
+
+    ASSERT_EQUAL(Printed(Call("int"s, {ObjectHolder::Own(Float{-3.9})}, context), context), "-3"s);
+    ASSERT_EQUAL(Printed(Call("int"s, {str(" +42 "s)}, context), context), "42"s);
+    ASSERT_EQUAL(Printed(Call("int"s, {str("-5"s)}, context), context), "-5"s);
+    ASSERT_EQUAL(Printed(Call("int"s, {ObjectHolder::Own(Bool{true})}, context), context), "1"s);
+    ASSERT_THROWS(Call("int"s, {str("4x"s)}, context), runtime_error);
+    ASSERT_THROWS(Call("int"s, {str(""s)}, context), runtime_error);
+    ASSERT_THROWS(Call("int"s, {ObjectHolder::Own(Float{1e20})}, context), runtime_error);
+
+    ASSERT_EQUAL(Printed(Call("ord"s, {str("A"s)}, context), context), "65"s);
+    ASSERT_EQUAL(Printed(Call("chr"s, {number(97)}, context), context), "a"s);
+    ASSERT_THROWS(Call("ord"s, {str("AB"s)}, context), runtime_error);
+    ASSERT_THROWS(Call("chr"s, {number(256)}, context), runtime_error);
+
+    ASSERT_EQUAL(Printed(Call("len"s, {str("four"s)}, context), context), "4"s);
+    ASSERT_EQUAL(Printed(Call("str"s, {ObjectHolder::None()}, context), context), "None"s);
+
+    ASSERT(context.output.str().empty());
+}
+
+void TestIsInstance() {
+    DummyContext context;
+    ObjectHolder base = ObjectHolder::Own(Class{"Base"s, {}, nullptr});
+    ObjectHolder derived = ObjectHolder::Own(Class{"Derived"s, {}, base.TryAs<Class>()});
+    ObjectHolder other = ObjectHolder::Own(Class{"Other"s, {}, nullptr});
+    ObjectHolder instance = ObjectHolder::Own(ClassInstance{*derived.TryAs<Class>()});
+
+    ASSERT(IsTrue(Call("isinstance"s, {instance, derived}, context)));
+    ASSERT(IsTrue(Call("isinstance"s, {instance, base}, context)));
+    ASSERT(!IsTrue(Call("isinstance"s, {instance, other}, context)));
+    ASSERT(!IsTrue(Call("isinstance"s, {ObjectHolder::Own(Number{1}), base}, context)));
+    ASSERT_THROWS(Call("isinstance"s, {instance, instance}, context), runtime_error);
+}
+
+}  // namespace
+
+void RunBuiltinsTests(TestRunner& tr) {
+    RUN_TEST(tr, runtime::TestArgumentSpan);
+    RUN_TEST(tr, runtime::TestRegistry);
+    RUN_TEST(tr, runtime::TestStandardBuiltins);
+    RUN_TEST(tr, runtime::TestIsInstance);
+}
+
+}  // namespace runtime
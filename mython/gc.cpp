@@ -0,0 +1,249 @@
+#include "gc.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace runtime {
+
+    namespace {
+        struct HeapState {
+            Traced *head = nullptr;
+            size_t size = 0;
+            size_t created_since_collection = 0;
+            size_t threshold = GC_MIN_THRESHOLD;
+            bool enabled = false;
+            GcStats stats;
+        };
+
+        // С обычным счётчиком ссылок объекты не покидают поток, в котором созданы, и у каждого потока своя куча без
+        // блокировок. С атомарным объект может удалиться в другом потоке, поэтому куча одна и защищена мьютексом
+        HeapState &Heap() {
+            if constexpr (ObjectReferenceCount::THREAD_SAFE) {
+                static HeapState heap;
+                return heap;
+            } else {
+                thread_local HeapState heap;
+                return heap;
+            }
+        }
+
+        std::mutex heap_mutex;
+
+        std::unique_lock<std::mutex> LockHeap() {
+            if constexpr (ObjectReferenceCount::THREAD_SAFE) {
+                return std::unique_lock(heap_mutex);
+            } else {
+                return {};
+            }
+        }
+    }
+
+    // Двусвязный список живых объектов Traced: объект встаёт в него при создании и уходит при удалении за O(1)
+    class TracedList {
+    public:
+        static void Link(Traced &object) {
+            const auto lock = LockHeap();
+            HeapState &heap = Heap();
+            object.prev_ = nullptr;
+            object.next_ = heap.head;
+            if (heap.head != nullptr) {
+                heap.head->prev_ = &object;
+            }
+            heap.head = &object;
+            ++heap.size;
+            ++heap.created_since_collection;
+        }
+
+        static void Unlink(Traced &object) {
+            const auto lock = LockHeap();
+            HeapState &heap = Heap();
+            if (object.prev_ != nullptr) {
+                object.prev_->next_ = object.next_;
+            } else {
+                heap.head = object.next_;
+            }
+            if (object.next_ != nullptr) {
+                object.next_->prev_ = object.prev_;
+            }
+            --heap.size;
+        }
+
+        static std::vector<Traced *> Snapshot() {
+            std::vector<Traced *> objects;
+            objects.reserve(Heap().size);
+            for (Traced *object = Heap().head; object != nullptr; object = object->next_) {
+                objects.push_back(object);
+            }
+            return objects;
+        }
+    };
+
+    Traced::Traced() {
+        TracedList::Link(*this);
+    }
+
+    Traced::Traced(const Traced &other)
+            : Object(other) {
+        TracedList::Link(*this);
+    }
+
+    Traced &Traced::operator=(const Traced &other) {
+        Object::operator=(other);
+        return *this;
+    }
+
+    Traced::~Traced() {
+        TracedList::Unlink(*this);
+    }
+
+    namespace {
+        // Номера объектов из снимка кучи; ссылки на прочие объекты (числа, строки, классы) пропускаются
+        class HeapIndex {
+        public:
+            explicit HeapIndex(const std::vector<Traced *> &objects) {
+                index_.reserve(objects.size());
+                for (size_t i = 0; i < objects.size(); ++i) {
+                    index_.emplace(objects[i], i);
+                }
+            }
+
+            [[nodiscard]] std::optional<size_t> Find(const ObjectHolder &reference) const {
+                if (!reference) {
+                    return std::nullopt;
+                }
+                const auto *traced = dynamic_cast<const Traced *>(reference.Get());
+                if (traced == nullptr) {
+                    return std::nullopt;
+                }
+                const auto it = index_.find(traced);
+                return it == index_.end() ? std::nullopt : std::optional(it->second);
+            }
+        private:
+            std::unordered_map<const Traced *, size_t> index_;
+        };
+
+        // Вычитает из счётчиков владеющие ссылки между объектами кучи
+        class InternalReferences : public ReferenceVisitor {
+        public:
+            InternalReferences(const HeapIndex &index, std::vector<long> &external)
+                    : index_(index), external_(external) {
+            }
+
+            void Visit(const ObjectHolder &reference) override {
+                if (!reference.IsOwning()) {
+                    return;
+                }
+                if (const std::optional<size_t> target = index_.Find(reference)) {
+                    --external_[*target];
+                }
+            }
+        private:
+            const HeapIndex &index_;
+            std::vector<long> &external_;
+        };
+
+        // Отмечает объекты, достижимые от корней. Невладеющие ссылки тоже считаются: лишний живой объект
+        // безопаснее, чем очищенный объект, на который ещё ссылаются
+        class Marker : public ReferenceVisitor {
+        public:
+            Marker(const HeapIndex &index, std::vector<bool> &reachable, std::vector<size_t> &pending)
+                    : index_(index), reachable_(reachable), pending_(pending) {
+            }
+
+            void Visit(const ObjectHolder &reference) override {
+                if (const std::optional<size_t> target = index_.Find(reference); target && !reachable_[*target]) {
+                    reachable_[*target] = true;
+                    pending_.push_back(*target);
+                }
+            }
+        private:
+            const HeapIndex &index_;
+            std::vector<bool> &reachable_;
+            std::vector<size_t> &pending_;
+        };
+    }
+
+    void SetGcEnabled(bool enabled) {
+        Heap().enabled = enabled;
+    }
+
+    bool IsGcEnabled() {
+        return Heap().enabled;
+    }
+
+    void MaybeCollectGarbage() {
+        const HeapState &heap = Heap();
+        if (heap.enabled && heap.created_since_collection >= heap.threshold) {
+            CollectGarbage();
+        }
+    }
+
+    size_t CollectGarbage() {
+        const auto start = std::chrono::steady_clock::now();
+
+        const std::vector<Traced *> objects = TracedList::Snapshot();
+        const HeapIndex index(objects);
+
+        // Владеющие ссылки на объект минус ссылки из кучи: остаток — ссылки снаружи
+        std::vector<long> external(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i) {
+            external[i] = objects[i]->GetReferenceCount();
+            if (external[i] == 0) {
+                external[i] = std::numeric_limits<long>::max();
+            }
+        }
+        InternalReferences internal_references(index, external);
+        for (const Traced *object : objects) {
+            object->VisitReferences(internal_references);
+        }
+
+        std::vector<bool> reachable(objects.size());
+        std::vector<size_t> pending;
+        for (size_t i = 0; i < objects.size(); ++i) {
+            if (external[i] > 0) {
+                reachable[i] = true;
+                pending.push_back(i);
+            }
+        }
+        Marker marker(index, reachable, pending);
+        while (!pending.empty()) {
+            const size_t current = pending.back();
+            pending.pop_back();
+            objects[current]->VisitReferences(marker);
+        }
+
+        // Мусор удерживается, пока у всех объектов не будут удалены ссылки: иначе очистка одного объекта
+        // удалила бы другой, который ещё предстоит очистить
+        std::vector<ObjectHolder> garbage;
+        for (size_t i = 0; i < objects.size(); ++i) {
+            if (!reachable[i]) {
+                garbage.push_back(ObjectHolder::Acquire(*objects[i]));
+            }
+        }
+        for (const ObjectHolder &object : garbage) {
+            static_cast<Traced &>(*object).ClearReferences();
+        }
+        const size_t collected = garbage.size();
+        garbage.clear();
+
+        HeapState &heap = Heap();
+        heap.created_since_collection = 0;
+        heap.threshold = std::max(GC_MIN_THRESHOLD, heap.size);
+        const auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+        ++heap.stats.collections;
+        heap.stats.collected += collected;
+        heap.stats.total_pause += pause;
+        heap.stats.max_pause = std::max(heap.stats.max_pause, pause);
+        return collected;
+    }
+
+    GcStats GetGcStats() {
+        GcStats stats = Heap().stats;
+        stats.live_objects = Heap().size;
+        return stats;
+    }
+
+}
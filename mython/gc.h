@@ -0,0 +1,48 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <chrono>
+#include <cstddef>
+
+namespace runtime {
+
+    struct GcStats {
+        size_t collections = 0;
+        // Сколько объектов освобождено сборщиком за всё время
+        size_t collected = 0;
+        // Сколько объектов Traced живо сейчас: размер кучи, которую обходит сборщик
+        size_t live_objects = 0;
+        std::chrono::nanoseconds total_pause{0};
+        std::chrono::nanoseconds max_pause{0};
+    };
+
+    // Сборщик циклов ссылок. Объекты по-прежнему освобождаются подсчётом ссылок, а сборщик находит
+    // среди объектов Traced группы, которые ссылаются только друг на друга, и разрывает их ссылки.
+    //
+    // Сборка точная и не требует перечислять корни явно. Для каждого объекта из числа владеющих ссылок
+    // вычитаются ссылки от других объектов Traced; если что-то остаётся, на объект ссылается кто-то снаружи
+    // кучи: замыкание на стеке вызовов, глобальные переменные, контекст или код на C++. Такие объекты —
+    // корни; всё, что достижимо от них, живо, а остальное — мусор. Объекты без владеющих ссылок
+    // (например, на стеке C++) всегда считаются корнями.
+    //
+    // Сборщик выключен по умолчанию. Включённый, он запускается перед созданием объекта класса, когда с прошлой
+    // сборки появилось больше объектов Traced, чем порог: наибольшее из GC_MIN_THRESHOLD и числа переживших
+    // прошлую сборку. Поэтому суммарное время сборок растёт линейно с числом созданных объектов.
+    //
+    // У каждого потока своя куча и своя статистика. В сборке с MYTHON_ATOMIC_REFCOUNT (refcount.h) куча общая,
+    // и сборку можно запускать, только пока другие потоки не выполняют программ
+    constexpr size_t GC_MIN_THRESHOLD = 10000;
+
+    void SetGcEnabled(bool enabled);
+    [[nodiscard]] bool IsGcEnabled();
+
+    // Запускает сборку, если сборщик включён и порог превышен. Вызывать только там, где код на C++
+    // не держит голых указателей на содержимое объектов Traced
+    void MaybeCollectGarbage();
+    // Выполняет сборку независимо от порога и от того, включён ли сборщик. Возвращает число освобождённых объектов
+    size_t CollectGarbage();
+
+    [[nodiscard]] GcStats GetGcStats();
+
+}
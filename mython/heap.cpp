@@ -0,0 +1,80 @@
+#include "heap.h"
+
+#include <new>
+
+namespace runtime {
+
+    namespace {
+        // Размеры блоков кратны GRANULARITY, и у каждого размера свой список свободных блоков
+        constexpr size_t GRANULARITY = 16;
+        constexpr size_t SIZE_CLASS_COUNT = MAX_POOLED_BLOCK_SIZE / GRANULARITY;
+        // Сколько свободных блоков одного размера поток держит у себя; лишние возвращаются в malloc
+        constexpr size_t MAX_CACHED_BLOCKS = 4096;
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        // Списки лежат в тривиальных thread_local-переменных, у которых нет деструктора: ими можно пользоваться,
+        // пока завершается поток и деструкторы других thread_local-объектов ещё освобождают память
+        thread_local FreeBlock *free_lists[SIZE_CLASS_COUNT];
+        thread_local size_t free_counts[SIZE_CLASS_COUNT];
+        thread_local bool cache_released = false;
+
+        // При завершении потока возвращает его свободные блоки в malloc. После этого блоки освобождаются сразу
+        struct CacheRelease {
+            ~CacheRelease() {
+                cache_released = true;
+                for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i) {
+                    while (free_lists[i] != nullptr) {
+                        FreeBlock *block = free_lists[i];
+                        free_lists[i] = block->next;
+                        ::operator delete(block);
+                    }
+                    free_counts[i] = 0;
+                }
+            }
+        };
+
+        void RegisterCacheRelease() {
+            thread_local CacheRelease release;
+            static_cast<void>(release);
+        }
+
+        size_t SizeClass(size_t size) {
+            return (size + GRANULARITY - 1) / GRANULARITY - 1;
+        }
+    }
+
+    void *AllocateBlock(size_t size) {
+        if (size == 0 || size > MAX_POOLED_BLOCK_SIZE) {
+            return ::operator new(size);
+        }
+        const size_t size_class = SizeClass(size);
+        if (FreeBlock *block = free_lists[size_class]) {
+            free_lists[size_class] = block->next;
+            --free_counts[size_class];
+            return block;
+        }
+        // Блок выделяется с полным размером своего класса, чтобы потом подойти любому объекту этого класса
+        return ::operator new((size_class + 1) * GRANULARITY);
+    }
+
+    void DeallocateBlock(void *block, size_t size) {
+        if (size == 0 || size > MAX_POOLED_BLOCK_SIZE) {
+            ::operator delete(block);
+            return;
+        }
+        const size_t size_class = SizeClass(size);
+        if (cache_released || free_counts[size_class] == MAX_CACHED_BLOCKS) {
+            ::operator delete(block);
+            return;
+        }
+        if (free_counts[size_class] == 0) {
+            RegisterCacheRelease();
+        }
+        free_lists[size_class] = new (block) FreeBlock{free_lists[size_class]};
+        ++free_counts[size_class];
+    }
+
+}
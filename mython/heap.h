@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace runtime {
+
+    // Память под часто создаваемые объекты. Освобождённый блок не возвращается в malloc, а остаётся в списке
+    // блоков своего размера в текущем потоке и достаётся следующему объекту того же размера.
+    // Блоки больше MAX_POOLED_BLOCK_SIZE выделяются и освобождаются обычным operator new
+    constexpr size_t MAX_POOLED_BLOCK_SIZE = 256;
+
+    [[nodiscard]] void *AllocateBlock(size_t size);
+    // size должен совпадать с размером, переданным в AllocateBlock
+    void DeallocateBlock(void *block, size_t size);
+
+}
@@ -0,0 +1,121 @@
+#include "interpreter.h"
+
+#include "lexer.h"
+#include "parse.h"
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace {
+    // Чтение с терминала нельзя прервать, поэтому лексер, остановленный посреди такого ввода,
+    // ждал бы, пока пользователь введёт строку. Перенаправленный стандартный ввод — обычный поток
+    bool IsTerminal(const std::istream &program) {
+        if (program.rdbuf() != std::cin.rdbuf()) {
+            return false;
+        }
+#ifdef _WIN32
+        return _isatty(_fileno(stdin)) != 0;
+#else
+        return isatty(STDIN_FILENO) != 0;
+#endif
+    }
+}
+
+Interpreter::Interpreter(std::ostream &output)
+        : context_(output), builtins_(runtime::Builtins()) {
+}
+
+void Interpreter::RegisterFunction(std::string name, size_t min_args, size_t max_args,
+                                   runtime::NativeFunction function) {
+    builtins_.Register(std::move(name), min_args, max_args, std::move(function));
+}
+
+runtime::NativeClass &Interpreter::RegisterClass(std::string name) {
+    auto [it, inserted] = classes_.insert({name, runtime::ObjectHolder()});
+    if (!inserted) {
+        throw std::runtime_error("Class "s + name + " already exists"s);
+    }
+    it->second = runtime::ObjectHolder::Own(runtime::NativeClass(name));
+    globals_[name] = it->second;
+    return *it->second.TryAs<runtime::NativeClass>();
+}
+
+runtime::NativeClass &Interpreter::RegisterClass(std::string name, size_t min_args, size_t max_args,
+                                                 runtime::NativeFunction constructor) {
+    runtime::NativeClass &cls = RegisterClass(name);
+    builtins_.Register(std::move(name), min_args, max_args, std::move(constructor));
+    return cls;
+}
+
+void Interpreter::SetGlobal(const std::string &name, runtime::ObjectHolder value) {
+    globals_[name] = std::move(value);
+}
+
+runtime::ObjectHolder Interpreter::GetGlobal(const std::string &name) const {
+    auto it = globals_.find(name);
+    return it != globals_.end() ? it->second : runtime::ObjectHolder();
+}
+
+// На многоядерной машине лексер работает в отдельном потоке параллельно с разбором и выполнением,
+// кроме ввода с терминала (см. parse::LexerMode)
+void Interpreter::Run(std::istream &program) {
+    const runtime::HeapQuotaScope quota_scope(quota_);
+    const bool background = std::thread::hardware_concurrency() > 1 && !IsTerminal(program);
+    parse::Lexer lexer(program, background ? parse::LexerMode::Background : parse::LexerMode::Inline);
+    ParseProgram(lexer, builtins_, [this](std::unique_ptr<runtime::Executable> statement) {
+        statement->Execute(globals_, context_);
+    }, declared_classes_);
+}
+
+runtime::ObjectHolder Interpreter::CallMethod(const runtime::ObjectHolder &object, const std::string &method,
+                                              std::vector<runtime::ObjectHolder> args) {
+    const runtime::HeapQuotaScope quota_scope(quota_);
+    if (auto native = object.TryAs<runtime::NativeObject>()) {
+        return native->Call(method, runtime::ArgumentSpan(args.data(), args.size()), context_);
+    }
+    if (auto instance = object.TryAs<runtime::ClassInstance>()) {
+        runtime::ObjectHolder result = instance->Call(method, args, context_);
+        if (auto generator = result.TryAs<runtime::Generator>()) {
+            generator->KeepAlive(object);
+        }
+        return result;
+    }
+    if (auto list = object.TryAs<runtime::List>()) {
+        return list->Call(method, args, context_);
+    }
+    throw std::runtime_error("object has no method "s + method);
+}
+
+runtime::Context &Interpreter::GetContext() {
+    return context_;
+}
+
+void Interpreter::SetHeapLimit(size_t bytes) {
+    quota_.SetLimit(bytes);
+}
+
+size_t Interpreter::GetHeapUsage() const {
+    return quota_.GetUsage();
+}
+
+size_t Interpreter::GetPeakHeapUsage() const {
+    return quota_.GetPeakUsage();
+}
+
+runtime::HeapSnapshot Interpreter::TakeHeapSnapshot(size_t max_retainers) const {
+    return runtime::TakeHeapSnapshot(globals_, max_retainers);
+}
+
+void Interpreter::WriteHeapSnapshot(std::ostream &output) const {
+    runtime::WriteHeapSnapshot(TakeHeapSnapshot(), output);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "builtins.h"
+#include "runtime.h"
+#include "snapshot.h"
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Интерпретатор для встраивания в программу на C++. Хост регистрирует свои функции и классы с методами на C++,
+// передаёт программе данные через глобальные переменные и читает результаты оттуда же.
+// Глобальные переменные сохраняются между вызовами Run, поэтому программу можно выполнять по частям.
+// Классы, объявленные в программе, можно создавать только в том вызове Run, в котором они объявлены
+class Interpreter {
+public:
+    explicit Interpreter(std::ostream &output);
+
+    // Регистрирует функцию, доступную программам этого интерпретатора. Стандартные функции можно переопределить
+    void RegisterFunction(std::string name, size_t min_args, size_t max_args, runtime::NativeFunction function);
+
+    // Регистрирует класс, экземпляры которого создаёт только хост. Класс доступен программе как глобальная
+    // переменная с тем же именем, например для isinstance. Ссылка на класс действительна всё время жизни интерпретатора
+    runtime::NativeClass &RegisterClass(std::string name);
+    // Регистрирует класс, экземпляры которого программа создаёт вызовом Name(args); constructor создаёт объект
+    runtime::NativeClass &RegisterClass(std::string name, size_t min_args, size_t max_args,
+                                        runtime::NativeFunction constructor);
+
+    // Оборачивает значение хоста в объект класса cls без преобразования в объекты Mython
+    template <typename T>
+    [[nodiscard]] static runtime::ObjectHolder Wrap(const runtime::NativeClass &cls, T value) {
+        return runtime::ObjectHolder::Own(runtime::HostObject<T>(cls, std::move(value)));
+    }
+
+    void SetGlobal(const std::string &name, runtime::ObjectHolder value);
+    // Возвращает значение глобальной переменной или пустой ObjectHolder, если переменной нет
+    [[nodiscard]] runtime::ObjectHolder GetGlobal(const std::string &name) const;
+
+    // Разбирает и выполняет программу по одной инструкции верхнего уровня
+    void Run(std::istream &program);
+    // Вызывает метод объекта программы или хоста
+    runtime::ObjectHolder CallMethod(const runtime::ObjectHolder &object, const std::string &method,
+                                     std::vector<runtime::ObjectHolder> args);
+
+    [[nodiscard]] runtime::Context &GetContext();
+
+    // Ограничивает память, которую занимают объекты, строки, контейнеры и узлы AST, созданные в Run и CallMethod.
+    // Когда программа выходит за лимит, Run или CallMethod бросает runtime::HeapQuotaExceeded, а интерпретатор
+    // остаётся рабочим: после увеличения лимита его можно снова вызывать. По умолчанию лимита нет
+    void SetHeapLimit(size_t bytes);
+    // Сколько памяти занято сейчас и сколько было занято в худший момент. Можно вызывать из любого потока
+    [[nodiscard]] size_t GetHeapUsage() const;
+    [[nodiscard]] size_t GetPeakHeapUsage() const;
+
+    // Снимок объектов, достижимых из глобальных переменных: память по классам и самые крупные удерживающие пути
+    // (см. runtime::TakeHeapSnapshot). Не меняет состояния интерпретатора; WriteHeapSnapshot записывает его в JSON
+    [[nodiscard]] runtime::HeapSnapshot TakeHeapSnapshot(
+            size_t max_retainers = runtime::DEFAULT_SNAPSHOT_RETAINERS) const;
+    void WriteHeapSnapshot(std::ostream &output) const;
+private:
+    // Объявлена первой, чтобы пережить все объекты интерпретатора, память которых с неё списана
+    runtime::HeapQuota quota_;
+    runtime::SimpleContext context_;
+    runtime::BuiltinRegistry builtins_;
+    // Классы, объявленные во всех вызовах Run. Объекты и методы классов ссылаются на свой класс и базовые классы,
+    // поэтому классы живут, пока жив интерпретатор, даже если глобальная переменная с именем класса перезаписана
+    std::vector<runtime::ObjectHolder> declared_classes_;
+    runtime::Closure globals_;
+    std::unordered_map<std::string, runtime::ObjectHolder> classes_;
+};
@@ -0,0 +1,384 @@
+#include "arena.h"
+#include "array.h"
+#include "gc.h"
+#include "interpreter.h"
+#include "parse.h"
+
+#include <test_runner.h>
+
+using namespace std;
+
+namespace {
+
+struct Account {
+    string owner;
+    int balance = 0;
+};
+
+// Класс Account хоста: программа создаёт счета вызовом Account('name') и работает с ними через методы
+runtime::NativeClass& RegisterAccount(Interpreter& interpreter) {
+    runtime::NativeClass& cls = interpreter.RegisterClass("Account"s, 1, 1,
+                                                          [&interpreter](runtime::ArgumentSpan args, runtime::Context&) {
+        const auto* owner = args[0].TryAs<runtime::String>();
+        if (owner == nullptr) {
+            throw runtime_error("Account() expects an owner name"s);
+        }
+        const runtime::NativeClass& account_class =
+                *interpreter.GetGlobal("Account"s).TryAs<runtime::NativeClass>();
+        return Interpreter::Wrap(account_class, Account{string(owner->GetValue()), 0});
+    });
+    cls.AddMethod("deposit"s, 1, 1, [](runtime::NativeObject& self, runtime::ArgumentSpan args, runtime::Context&) {
+        self.As<Account>().balance += args[0].TryAs<runtime::Number>()->GetValue();
+        return runtime::ObjectHolder::None();
+    });
+    cls.AddMethod("balance"s, 0, 0, [](runtime::NativeObject& self, runtime::ArgumentSpan, runtime::Context&) {
+        return runtime::ObjectHolder::Own(runtime::Number{self.As<Account>().balance});
+    });
+    cls.AddMethod("__str__"s, 0, 0, [](runtime::NativeObject& self, runtime::ArgumentSpan, runtime::Context&) {
+        const Account& account = self.As<Account>();
+        return runtime::ObjectHolder::Own(runtime::String{account.owner + ": "s + to_string(account.balance)});
+    });
+    return cls;
+}
+
+void TestNativeClass() {
+    ostringstream output;
+    Interpreter interpreter(output);
+    const runtime::NativeClass& account_class = RegisterAccount(interpreter);
+
+    interpreter.SetGlobal("existing"s, Interpreter::Wrap(account_class, Account{"host"s, 100}));
+
+    istringstream program(R"(
+class Bank:
+  def __init__(account):
+    self.account = account
+
+  def pay(amount):
+    self.account.deposit(amount)
+    return self.account.balance()
+
+a = Account('alice')
+a.deposit(10)
+bank = Bank(a)
+print a, bank.pay(5), isinstance(a, Account), isinstance(1, Account)
+existing.deposit(-30)
+b = Bank(existing)
+print str(existing), b.pay(1)
+)");
+    interpreter.Run(program);
+
+    ASSERT_EQUAL(output.str(), "alice: 10 15 True False\nhost: 70 71\n"s);
+    // Программа меняла тот же объект, что передал хост, а не его копию
+    runtime::ObjectHolder existing = interpreter.GetGlobal("existing"s);
+    ASSERT_EQUAL(existing.TryAs<runtime::NativeObject>()->As<Account>().balance, 71);
+    ASSERT_EQUAL(interpreter.GetGlobal("a"s).TryAs<runtime::NativeObject>()->As<Account>().owner, "alice"s);
+    ASSERT_THROWS(existing.TryAs<runtime::NativeObject>()->As<int>(), runtime_error);
+
+    istringstream wrong_arity("existing.deposit(1, 2)\n");
+    ASSERT_THROWS(interpreter.Run(wrong_arity), runtime_error);
+    istringstream unknown_method("existing.withdraw(1)\n");
+    ASSERT_THROWS(interpreter.Run(unknown_method), runtime_error);
+    ASSERT_THROWS(interpreter.RegisterClass("Account"s), runtime_error);
+}
+
+void TestHostDataIsNotCopied() {
+    ostringstream output;
+    Interpreter interpreter(output);
+
+    const auto text = make_shared<const string>("short"s);
+    const auto long_text = make_shared<const string>(string(1000, 'x'));
+    interpreter.SetGlobal("text"s, runtime::ObjectHolder::Own(runtime::String{text}));
+    interpreter.SetGlobal("long_text"s, runtime::ObjectHolder::Own(runtime::String{long_text}));
+    runtime::Number limit{7};
+    interpreter.SetGlobal("limit"s, runtime::ObjectHolder::Share(limit));
+
+    istringstream program(R"(
+same = text
+copy = long_text
+print len(text), len(long_text), limit + 1
+)");
+    interpreter.Run(program);
+
+    ASSERT_EQUAL(output.str(), "5 1000 8\n"s);
+    // Строки хоста разделяют его буфер и в программе, и на выходе из неё
+    ASSERT_EQUAL(interpreter.GetGlobal("same"s).TryAs<runtime::String>()->GetValue().data(), text->data());
+    ASSERT_EQUAL(interpreter.GetGlobal("copy"s).TryAs<runtime::String>()->GetValue().data(), long_text->data());
+    ASSERT_EQUAL(interpreter.GetGlobal("limit"s).Get(), &limit);
+}
+
+void TestFunctionsAndGlobals() {
+    ostringstream output;
+    Interpreter interpreter(output);
+    int calls = 0;
+    interpreter.RegisterFunction("scale"s, 1, 2, [&calls](runtime::ArgumentSpan args, runtime::Context&) {
+        ++calls;
+        const int factor = args.size() > 1 ? args[1].TryAs<runtime::Number>()->GetValue() : 2;
+        return runtime::ObjectHolder::Own(runtime::Number{args[0].TryAs<runtime::Number>()->GetValue() * factor});
+    });
+    // Функции интерпретатора не попадают в общий реестр
+    ASSERT(runtime::Builtins().Find("scale"s) == nullptr);
+
+    istringstream first(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+    return self.value
+
+x = scale(3)
+c = Counter()
+)");
+    interpreter.Run(first);
+    istringstream second("c.add(x)\nprint scale(x, 10), c.value, abs(-1)\n");
+    interpreter.Run(second);
+
+    ASSERT_EQUAL(output.str(), "60 6 1\n"s);
+    ASSERT_EQUAL(calls, 2);
+
+    runtime::ObjectHolder counter = interpreter.GetGlobal("c"s);
+    runtime::ObjectHolder result = interpreter.CallMethod(counter, "add"s, {runtime::ObjectHolder::Own(runtime::Number{4})});
+    ASSERT_EQUAL(result.TryAs<runtime::Number>()->GetValue(), 10);
+    ASSERT(!interpreter.GetGlobal("missing"s));
+    ASSERT_THROWS(interpreter.CallMethod(interpreter.GetGlobal("x"s), "add"s, {}), runtime_error);
+
+    istringstream arity("print scale()\n");
+    ASSERT_THROWS(interpreter.Run(arity), ParseError);
+}
+
+void TestClassesOutliveRun() {
+    ostringstream output;
+    Interpreter interpreter(output);
+
+    istringstream first(R"(
+class Base:
+  def f():
+    return 'base'
+
+class Point(Base):
+  def make():
+    return Base()
+
+a = Point()
+)");
+    interpreter.Run(first);
+    // Имена классов перезаписаны, но объект a и тело метода make по-прежнему ссылаются на классы
+    istringstream second("Point = 1\nBase = 2\nb = a.make()\nprint a.f(), b.f(), Point\n");
+    interpreter.Run(second);
+    ASSERT_EQUAL(output.str(), "base base 1\n"s);
+}
+
+void TestHeapQuota() {
+    ostringstream output;
+    runtime::ObjectHolder kept;
+    {
+        Interpreter interpreter(output);
+        const size_t limit = 200000;
+        interpreter.SetHeapLimit(limit);
+
+        istringstream small("x = []\nfor i in range(100):\n  x.append(str(i) + 'abcdefghijklmnopqrstuvwxyz')\n"s);
+        interpreter.Run(small);
+        const size_t with_list = interpreter.GetHeapUsage();
+        ASSERT(with_list > 100 * sizeof(runtime::String));
+        ASSERT(with_list <= limit);
+
+        // Список без новых объектов растёт только своим буфером, но и он списывается с квоты
+        istringstream runaway("y = 1\nwhile True:\n  x.append(y)\n"s);
+        ASSERT_THROWS(interpreter.Run(runaway), runtime::HeapQuotaExceeded);
+        ASSERT(interpreter.GetPeakHeapUsage() <= limit);
+        ASSERT(interpreter.GetPeakHeapUsage() > with_list);
+
+        istringstream too_large("a = array(1000000, 0)\n"s);
+        ASSERT_THROWS(interpreter.Run(too_large), runtime::HeapQuotaExceeded);
+
+        // Разряды длинных чисел тоже входят в лимит: 3^(2^24) занимает несколько мегабайт
+        istringstream huge_number("z = 3\nfor i in range(24):\n  z = z * z\n"s);
+        ASSERT_THROWS(interpreter.Run(huge_number), runtime::HeapQuotaExceeded);
+        ASSERT(interpreter.GetPeakHeapUsage() <= limit);
+
+        // После ошибки интерпретатор работает дальше, а освобождённая память возвращается в квоту
+        istringstream reset("x = None\ns = 'abcdefghijklmnopqrstuvwxyz' + str(1)\nprint len(s)\n"s);
+        interpreter.Run(reset);
+        ASSERT(interpreter.GetHeapUsage() < with_list);
+        ASSERT_EQUAL(output.str(), "27\n"s);
+
+        kept = interpreter.GetGlobal("s"s);
+    }
+    // Строка пережила интерпретатор и возвращает память в уже удалённую квоту
+    ASSERT_EQUAL(kept.TryAs<runtime::String>()->GetValue(), "abcdefghijklmnopqrstuvwxyz1"sv);
+    kept = runtime::ObjectHolder::None();
+
+    runtime::HeapQuota quota;
+    {
+        const runtime::HeapQuotaScope scope(quota);
+        runtime::ObjectHolder number = runtime::ObjectHolder::Own(runtime::Number{1});
+        ASSERT_EQUAL(quota.GetUsage(), sizeof(runtime::Number));
+        runtime::Number on_stack{2};
+        ASSERT_EQUAL(quota.GetUsage(), sizeof(runtime::Number));
+    }
+    ASSERT_EQUAL(quota.GetUsage(), 0u);
+    ASSERT_EQUAL(quota.GetPeakUsage(), sizeof(runtime::Number));
+}
+
+void TestStreamingLiteralPool() {
+    ostringstream output;
+    Interpreter interpreter(output);
+    string program;
+    for (int i = 0; i < 10000; ++i) {
+        program += "x = 'a distinct literal that does not fit inline, number "s + to_string(i) + "'\n"s;
+    }
+    istringstream input(program);
+    interpreter.Run(input);
+    // Литералы выполненных инструкций не копятся в пуле парсера, поэтому память не растёт с длиной ввода
+    ASSERT(interpreter.GetPeakHeapUsage() < 64 * 1024);
+    ASSERT_EQUAL(interpreter.GetGlobal("x"s).TryAs<runtime::String>()->GetValue(),
+                 "a distinct literal that does not fit inline, number 9999"sv);
+}
+
+void TestHeapSnapshot() {
+    ostringstream output;
+    Interpreter interpreter(output);
+
+    istringstream program(R"(
+class Node:
+  def __init__(value, next):
+    self.value = value
+    self.next = next
+
+class Registry:
+  def __init__():
+    self.items = {}
+
+chain = None
+for i in range(100):
+  chain = Node(i, chain)
+
+registry = Registry()
+log = []
+for i in range(50):
+  log.append('message number ' + str(i) + ' that does not fit into the object')
+registry.items['log'] = log
+log = None
+print 'done'
+)");
+    interpreter.Run(program);
+    const runtime::ObjectHolder chain = interpreter.GetGlobal("chain"s);
+    const uint32_t references = chain->GetReferenceCount();
+
+    const runtime::HeapSnapshot snapshot = interpreter.TakeHeapSnapshot(100);
+    ASSERT_EQUAL(snapshot.largest_retainers.size(), 100u);
+
+    const auto node_stats = find_if(snapshot.classes.begin(), snapshot.classes.end(), [](const auto& stats) {
+        return stats.name == "Node"s;
+    });
+    ASSERT(node_stats != snapshot.classes.end());
+    ASSERT_EQUAL(node_stats->instances, 100u);
+    // У последнего узла next равен None
+    ASSERT_EQUAL(node_stats->references, 199u);
+    ASSERT_EQUAL(node_stats->max_references, 2u);
+    // Цепочку удерживает её первый узел, и вложенные узлы не считаются повторно
+    const runtime::RetainerPath& head = snapshot.largest_retainers.front();
+    ASSERT_EQUAL(head.path, "chain"s);
+    ASSERT_EQUAL(head.class_name, "Node"s);
+    ASSERT_EQUAL(node_stats->retained_size, head.retained_size);
+    ASSERT_EQUAL(node_stats->shallow_size, 100 * head.shallow_size);
+    ASSERT_EQUAL(snapshot.largest_retainers[1].path, "chain.next"s);
+
+    // Список сообщений достижим только через словарь объекта registry
+    const auto log = find_if(snapshot.largest_retainers.begin(), snapshot.largest_retainers.end(),
+                             [](const auto& retainer) {
+                                 return retainer.class_name == "list"s;
+                             });
+    ASSERT(log != snapshot.largest_retainers.end());
+    ASSERT_EQUAL(log->path, "registry.items['log']"s);
+    ASSERT(log->retained_size > 50 * 40);
+
+    // Снимок ничего не меняет: повторный снимок такой же, а счётчики ссылок прежние
+    ostringstream first;
+    interpreter.WriteHeapSnapshot(first);
+    ostringstream second;
+    interpreter.WriteHeapSnapshot(second);
+    ASSERT_EQUAL(first.str(), second.str());
+    ASSERT_EQUAL(chain->GetReferenceCount(), references);
+    ASSERT(first.str().find(R"({"name":"Node","instances":100,)"s) != string::npos);
+    ASSERT(first.str().find(R"("largest_retainers":[{"path":"chain","class":"Node",)"s) != string::npos);
+    ASSERT_EQUAL(output.str(), "done\n"s);
+}
+
+void TestObjectArena() {
+    ostringstream output;
+    runtime::ObjectHolder result;
+    const size_t collected = runtime::GetGcStats().collected;
+    {
+        runtime::ObjectArena arena;
+        Interpreter interpreter(output);
+        const runtime::ArenaScope scope(arena);
+
+        istringstream program(R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+points = []
+for i in range(1000):
+  points.append(Point(i, i * 2))
+total = 0
+for p in points:
+  total = total + p.x + p.y
+shared = ['sum ' + str(total), 2.5]
+result = {'total': total, 'items': [shared, shared, array(3, 1)]}
+shared.append(result)
+print total
+)");
+        interpreter.Run(program);
+        ASSERT(arena.GetAllocatedBytes() > 1000 * sizeof(runtime::ClassInstance));
+        ASSERT(arena.GetReservedBytes() >= arena.GetAllocatedBytes());
+        // Блоки арены списываются с квоты интерпретатора целиком
+        ASSERT(interpreter.GetHeapUsage() >= arena.GetReservedBytes());
+
+        // Числам не нужен деструктор, а список освобождает свой буфер и ссылки на элементы
+        const runtime::ObjectHolder total = interpreter.GetGlobal("total"s);
+        ASSERT(total->IsArenaAllocated());
+        ASSERT(total->IsDestructorSkipped());
+        const runtime::ObjectHolder points = interpreter.GetGlobal("points"s);
+        ASSERT(points->IsArenaAllocated());
+        ASSERT(!points->IsDestructorSkipped());
+
+        ASSERT_THROWS(static_cast<void>(runtime::PromoteFromArena(points)), runtime_error);
+        result = runtime::PromoteFromArena(interpreter.GetGlobal("result"s));
+        ASSERT(!result->IsArenaAllocated());
+    }
+    // Цикл shared -> result -> items -> shared в арене удалил сборщик
+    ASSERT(runtime::GetGcStats().collected > collected);
+    ASSERT_EQUAL(output.str(), "1498500\n"s);
+
+    // Копия пережила арену, общий список остался общим, а цикл замкнулся на копию
+    runtime::DummyContext context;
+    auto& dict = *result.TryAs<runtime::Dict>();
+    ASSERT_EQUAL(dict.At(runtime::ObjectHolder::Own(runtime::String{"total"s}), context)
+                         .TryAs<runtime::Number>()->GetValue(), 1498500);
+    auto& items = *dict.At(runtime::ObjectHolder::Own(runtime::String{"items"s}), context).TryAs<runtime::List>();
+    ASSERT_EQUAL(items.At(0).Get(), items.At(1).Get());
+    auto& shared = *items.At(0).TryAs<runtime::List>();
+    ASSERT_EQUAL(shared.At(0).TryAs<runtime::String>()->GetValue(), "sum 1498500"sv);
+    ASSERT_EQUAL(shared.At(1).TryAs<runtime::Float>()->GetValue(), 2.5);
+    ASSERT_EQUAL(shared.At(2).Get(), result.Get());
+    ASSERT_EQUAL(items.At(2).TryAs<runtime::Array>()->Ints(), vector<int64_t>(3, 1));
+    // Копия цикла тоже цикл: разрываем его, чтобы не оставить утечку
+    shared.Pop();
+}
+
+}  // namespace
+
+void RunInterpreterTests(TestRunner& tr) {
+    RUN_TEST(tr, TestNativeClass);
+    RUN_TEST(tr, TestHostDataIsNotCopied);
+    RUN_TEST(tr, TestFunctionsAndGlobals);
+    RUN_TEST(tr, TestClassesOutliveRun);
+    RUN_TEST(tr, TestHeapQuota);
+    RUN_TEST(tr, TestStreamingLiteralPool);
+    RUN_TEST(tr, TestHeapSnapshot);
+    RUN_TEST(tr, TestObjectArena);
+}
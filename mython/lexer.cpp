@@ -1,6 +1,12 @@
 #include "lexer.h"
 #include <algorithm>
+#include <atomic>
 #include <charconv>
+#include <condition_variable>
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <string>
 #include <string_view>
@@ -25,7 +31,7 @@ namespace parse {
             return (c >= '1' && c <= '9');
         }
         bool IsSpecialSymbol(char c) {
-            return (c >= '(' && c <= '/') || c == ':';
+            return (c >= '(' && c <= '/') || c == ':' || c == '[' || c == ']' || c == '{' || c == '}' || c == '@';
         }
         bool IsComparisonSymbol(char c) {
             return c == '!' || (c >= '<' && c <= '>');
@@ -47,6 +53,12 @@ namespace parse {
         if (lhs.Is<Number>()) {
             return lhs.As<Number>().value == rhs.As<Number>().value;
         }
+        if (lhs.Is<BigNumber>()) {
+            return lhs.As<BigNumber>().value == rhs.As<BigNumber>().value;
+        }
+        if (lhs.Is<Float>()) {
+            return lhs.As<Float>().value == rhs.As<Float>().value;
+        }
         if (lhs.Is<String>()) {
             return lhs.As<String>().value == rhs.As<String>().value;
         }
@@ -67,6 +79,8 @@ namespace parse {
     if (auto p = rhs.TryAs<type>()) return os << #type << '{' << p->value << '}';
 
         VALUED_OUTPUT(Number);
+        VALUED_OUTPUT(BigNumber);
+        VALUED_OUTPUT(Float);
         VALUED_OUTPUT(Id);
         VALUED_OUTPUT(String);
         VALUED_OUTPUT(Char);
@@ -95,6 +109,10 @@ namespace parse {
         UNVALUED_OUTPUT(None);
         UNVALUED_OUTPUT(True);
         UNVALUED_OUTPUT(False);
+        UNVALUED_OUTPUT(While);
+        UNVALUED_OUTPUT(For);
+        UNVALUED_OUTPUT(In);
+        UNVALUED_OUTPUT(Yield);
         UNVALUED_OUTPUT(Eof);
 
 #undef UNVALUED_OUTPUT
@@ -102,15 +120,228 @@ namespace parse {
         return os << "Unknown token :("sv;
     }
 
-    Lexer::Lexer(std::istream& input) : input_(input) {
+    InputBuffer::InputBuffer(std::istream& input, size_t capacity) : input_(input) {
+        size_t rounded = 2;
+        while (rounded < capacity) rounded <<= 1;
+        buffer_.resize(rounded);
+        mask_ = rounded - 1;
+    }
+
+    void InputBuffer::Putback() {
+        if (begin_ > 0) begin_--;
+    }
+
+    void InputBuffer::Ignore(size_t count) {
+        while (count-- > 0 && Get() != EOF) {}
+    }
+
+    bool InputBuffer::Fill() {
+        using traits = std::char_traits<char>;
+        if (eof_) return false;
+        std::streambuf* source = input_.rdbuf();
+        if (source == nullptr || traits::eq_int_type(source->sgetc(), traits::eof())) {
+            eof_ = true;
+            return false;
+        }
+        // Одна ячейка остаётся занятой последним прочитанным символом, чтобы его можно было вернуть через Putback
+        const size_t free_space = buffer_.size() - 1;
+        const std::streamsize available = std::max<std::streamsize>(source->in_avail(), 1);
+        const size_t to_read = std::min(free_space, static_cast<size_t>(available));
+        const size_t position = end_ & mask_;
+        const size_t first_part = std::min(to_read, buffer_.size() - position);
+
+        auto read = static_cast<size_t>(source->sgetn(&buffer_[position], static_cast<std::streamsize>(first_part)));
+        if (read == first_part && to_read > first_part) {
+            read += static_cast<size_t>(source->sgetn(buffer_.data(), static_cast<std::streamsize>(to_read - first_part)));
+        }
+        end_ += read;
+        return read > 0;
+    }
+
+    namespace detail {
+        // Кольцевая очередь для одного писателя и одного читателя без блокировок.
+        // Каждая сторона кэширует индекс другой стороны и читает атомик, только когда кэш устарел
+        template <typename T>
+        class SpscQueue {
+        public:
+            explicit SpscQueue(size_t capacity) {
+                size_t rounded = 2;
+                while (rounded < capacity) rounded <<= 1;
+                slots_.resize(rounded);
+                mask_ = rounded - 1;
+            }
+
+            bool TryPush(const T& value) {
+                const size_t tail = tail_.load(std::memory_order_relaxed);
+                if (tail - head_cache_ == slots_.size()) {
+                    head_cache_ = head_.load(std::memory_order_acquire);
+                    if (tail - head_cache_ == slots_.size()) return false;
+                }
+                slots_[tail & mask_] = value;
+                tail_.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Проверки без изменения очереди: CanPush вызывает только писатель, CanPop — только читатель
+            bool CanPush() const {
+                return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) < slots_.size();
+            }
+
+            bool CanPop() const {
+                return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire);
+            }
+
+            bool TryPop(T& value) {
+                const size_t head = head_.load(std::memory_order_relaxed);
+                if (head == tail_cache_) {
+                    tail_cache_ = tail_.load(std::memory_order_acquire);
+                    if (head == tail_cache_) return false;
+                }
+                value = std::move(slots_[head & mask_]);
+                head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+        private:
+            static constexpr size_t CACHE_LINE_SIZE = 64;
+
+            std::vector<T> slots_;
+            size_t mask_;
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+            size_t tail_cache_ = 0;
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+            size_t head_cache_ = 0;
+        };
+
+        // Сон одной стороны очереди до сигнала другой. Ждущая сторона выставляет флаг и перепроверяет условие
+        // под мьютексом, а другая будит её, только увидев флаг, поэтому пока никто не ждёт, мьютекс не нужен.
+        // Барьеры с обеих сторон гарантируют, что либо ждущая увидит изменение, либо другая сторона увидит флаг
+        class Waiter {
+        public:
+            template <typename Ready>
+            void Wait(Ready ready) {
+                std::unique_lock lock(mutex_);
+                waiting_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                condition_.wait(lock, ready);
+                waiting_.store(false, std::memory_order_relaxed);
+            }
+
+            void Notify() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (waiting_.load(std::memory_order_relaxed)) {
+                    const std::lock_guard lock(mutex_);
+                    condition_.notify_one();
+                }
+            }
+        private:
+            std::mutex mutex_;
+            std::condition_variable condition_;
+            std::atomic<bool> waiting_{false};
+        };
+    }
+
+    // Запускает обычный лексер в отдельном потоке и передаёт его лексемы через SpscQueue.
+    // Ошибка лексера пробрасывается читателю в тот момент, когда он дойдёт до места ошибки.
+    // Сторона, которой нечего делать, недолго уступает процессор, а затем засыпает до сигнала другой стороны
+    class TokenPipeline {
+    public:
+        explicit TokenPipeline(std::istream& input)
+                : queue_(QUEUE_CAPACITY), producer_([this, &input] { Produce(input); }) {
+        }
+
+        // Ждёт, пока писатель заметит остановку. Писатель, который ждёт ввода, остановится только после
+        // чтения, поэтому для интерактивного ввода фоновый режим не подходит (см. LexerMode)
+        ~TokenPipeline() {
+            stopped_.store(true, std::memory_order_relaxed);
+            producer_waiter_.Notify();
+            producer_.join();
+        }
+
+        Token Pop() {
+            Token token;
+            for (size_t attempt = 0; !queue_.TryPop(token); ++attempt) {
+                if (finished_.load(std::memory_order_acquire)) {
+                    if (queue_.TryPop(token)) break;
+                    if (error_) std::rethrow_exception(error_);
+                    return token_type::Eof{};
+                }
+                if (attempt < SPIN_ATTEMPTS) {
+                    std::this_thread::yield();
+                } else {
+                    consumer_waiter_.Wait([this] {
+                        return queue_.CanPop() || finished_.load(std::memory_order_acquire);
+                    });
+                }
+            }
+            producer_waiter_.Notify();
+            return token;
+        }
+    private:
+        static constexpr size_t QUEUE_CAPACITY = 4096;
+        // Сколько раз сторона уступает процессор, прежде чем заснуть: лексема обычно появляется раньше
+        static constexpr size_t SPIN_ATTEMPTS = 64;
+
+        void Produce(std::istream& input) {
+            try {
+                Lexer lexer(input);
+                while (Push(lexer.CurrentToken()) && !lexer.CurrentToken().Is<token_type::Eof>()) {
+                    lexer.NextToken();
+                }
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+            finished_.store(true, std::memory_order_release);
+            consumer_waiter_.Notify();
+        }
+
+        bool Push(const Token& token) {
+            for (size_t attempt = 0; !queue_.TryPush(token); ++attempt) {
+                if (stopped_.load(std::memory_order_relaxed)) return false;
+                if (attempt < SPIN_ATTEMPTS) {
+                    std::this_thread::yield();
+                } else {
+                    producer_waiter_.Wait([this] {
+                        return queue_.CanPush() || stopped_.load(std::memory_order_relaxed);
+                    });
+                }
+            }
+            consumer_waiter_.Notify();
+            return true;
+        }
+
+        detail::SpscQueue<Token> queue_;
+        detail::Waiter consumer_waiter_;
+        detail::Waiter producer_waiter_;
+        std::atomic<bool> stopped_{false};
+        std::atomic<bool> finished_{false};
+        std::exception_ptr error_;
+        std::thread producer_;
+    };
+
+    Lexer::Lexer(std::istream& input, size_t buffer_capacity) : input_(input, buffer_capacity) {
+        token_ = NextToken();
+    }
+
+    // В фоновом режиме собственный буфер не используется: входной поток читает лексер в потоке TokenPipeline
+    Lexer::Lexer(std::istream& input, LexerMode mode)
+            : input_(input, mode == LexerMode::Inline ? InputBuffer::DEFAULT_CAPACITY : 0) {
+        if (mode == LexerMode::Background) {
+            pipeline_ = std::make_unique<TokenPipeline>(input);
+        }
         token_ = NextToken();
     }
 
+    Lexer::~Lexer() = default;
+
     const Token& Lexer::CurrentToken() const {
         return token_;
     }
 
     Token Lexer::NextToken() {
+        if (pipeline_) {
+            if (!token_.Is<token_type::Eof>()) token_ = pipeline_->Pop();
+            return token_;
+        }
         if (dedents_to_make_ > 0) {
             token_ = token_type::Dedent{};
             current_indents_count_--;
@@ -119,8 +350,9 @@ namespace parse {
         }
         if (token_.Is<token_type::Eof>()) return token_;
 
-        char c = input_.get();
-        if (c == EOF) return ProcessEOF();
+        const int symbol = input_.Get();
+        if (symbol == EOF) return ProcessEOF();
+        const char c = static_cast<char>(symbol);
 
         if (detail::IsQuotationMark(c)) {
             char quotation_mark = c;
@@ -128,13 +360,16 @@ namespace parse {
         } else if (detail::IsAlphabetSymbol(c)) {
             ProcessAlphabetSymbol(c);
         } else if (c == UNDERLINE_SYMBOL) {
-            input_.putback(c);
+            input_.Putback();
             std::string str = ReadIdOrKeyWord();
             token_ = token_type::Id{str};
+        } else if (c == ZERO_SYMBOL && input_.Peek() == '.') {
+            input_.Putback();
+            token_ = ReadNumber();
         } else if (c == ZERO_SYMBOL) {
             token_ = token_type::Number{0};
         } else if (detail::IsPositiveDigitSymbol(c)) {
-            input_.putback(c);
+            input_.Putback();
             token_ = ReadNumber();
         } else if (detail::IsSpecialSymbol(c)) {
             token_ = token_type::Char{c};
@@ -164,36 +399,39 @@ namespace parse {
             {"not"s, token_type::Not{}},
             {"None"s, token_type::None{}},
             {"True"s, token_type::True{}},
-            {"False"s, token_type::False{}}
+            {"False"s, token_type::False{}},
+            {"while"s, token_type::While{}},
+            {"for"s, token_type::For{}},
+            {"in"s, token_type::In{}},
+            {"yield"s, token_type::Yield{}}
     };
 
 
     std::optional<parse::Token> Lexer::ReadKeyWord(const std::string& str) {
-        if (token_types_.count(str) > 0) {
-            return token_types_[str];
+        // Таблица только читается, поэтому лексеры могут работать в нескольких потоках одновременно
+        if (auto it = token_types_.find(str); it != token_types_.end()) {
+            return it->second;
         } else {
             return std::nullopt;
         }
     }
 
     token_type::String Lexer::ReadString(char quotation_mark) {
-        auto it = std::istreambuf_iterator<char>(input_);
-        auto end = std::istreambuf_iterator<char>();
         std::string s;
         while (true) {
-            if (it == end) {
+            const int symbol = input_.Get();
+            if (symbol == EOF) {
                 throw LexerError("String parsing error");
             }
-            const char ch = *it;
+            const char ch = static_cast<char>(symbol);
             if (ch == quotation_mark) {
-                ++it;
                 break;
             } else if (ch == '\\') {
-                ++it;
-                if (it == end) {
+                const int escaped_symbol = input_.Get();
+                if (escaped_symbol == EOF) {
                     throw LexerError("String parsing error");
                 }
-                const char escaped_char = *(it);
+                const char escaped_char = static_cast<char>(escaped_symbol);
                 switch (escaped_char) {
                     case 'n':
                         s.push_back('\n');
@@ -215,52 +453,72 @@ namespace parse {
             } else {
                 s.push_back(ch);
             }
-            ++it;
         }
 
         return token_type::String{s};
     }
 
-    token_type::Number Lexer::ReadNumber() {
+    Token Lexer::ReadNumber() {
+        auto is_digit = [](int c) {
+            return c >= '0' && c <= '9';
+        };
         std::string str_num;
-        char c;
         do {
-            c = input_.get();
-            str_num += c;
-        } while (input_.peek() >= '0' && input_.peek() <= '9');
-        int result = std::stoi(str_num);
-        return token_type::Number{result};
+            str_num += static_cast<char>(input_.Get());
+        } while (is_digit(input_.Peek()));
+        if (input_.Peek() != '.') {
+            int64_t value = 0;
+            const auto [end, error] = std::from_chars(str_num.data(), str_num.data() + str_num.size(), value);
+            if (error == std::errc::result_out_of_range) {
+                return token_type::BigNumber{std::move(str_num)};
+            }
+            return token_type::Number{value};
+        }
+
+        str_num += static_cast<char>(input_.Get());
+        if (!is_digit(input_.Peek())) {
+            throw LexerError("Expected digit after decimal point in "s + str_num);
+        }
+        do {
+            str_num += static_cast<char>(input_.Get());
+        } while (is_digit(input_.Peek()));
+        double result = 0;
+        std::from_chars(str_num.data(), str_num.data() + str_num.size(), result);
+        return token_type::Float{result};
     }
 
     void Lexer::SkipComment() {
-        input_.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        input_.putback('\n');
+        int symbol = input_.Peek();
+        while (symbol != EOF && symbol != LINE_FEED_SYMBOL) {
+            input_.Get();
+            symbol = input_.Peek();
+        }
     }
 
     int Lexer::CountIndents() {
         int spaces = 1;
-        while (input_.peek() == SPACE_SYMBOL) {
-            input_.get();
+        while (input_.Peek() == SPACE_SYMBOL) {
+            input_.Get();
             spaces++;
         }
         return spaces / 2;
     }
 
     void Lexer::SkipSpaces() {
-        while (input_.peek() == SPACE_SYMBOL) {
-            input_.get();
+        while (input_.Peek() == SPACE_SYMBOL) {
+            input_.Get();
         }
     }
 
     std::string Lexer::ReadIdOrKeyWord() {
         std::string str;
-        char c = input_.peek();
+        int c = input_.Peek();
         while (detail::IsAlphabetSymbol(c) ||
                detail::IsPositiveDigitSymbol(c) ||
                c == UNDERLINE_SYMBOL ||
                c == ZERO_SYMBOL) {
-            str += input_.get();
-            c = input_.peek();
+            str += static_cast<char>(input_.Get());
+            c = input_.Peek();
         }
         return str;
     }
@@ -280,8 +538,8 @@ namespace parse {
         }
     }
 
-    void Lexer::ProcessAlphabetSymbol(char c) {
-        input_.putback(c);
+    void Lexer::ProcessAlphabetSymbol([[maybe_unused]] char c) {
+        input_.Putback();
         std::string str = ReadIdOrKeyWord();
         std::optional<parse::Token> key_word = ReadKeyWord(str);
         if (!key_word.has_value()) {
@@ -292,7 +550,7 @@ namespace parse {
     }
 
     void Lexer::ProcessComparisonSymbol(char c) {
-        char second = input_.peek();
+        const int second = input_.Peek();
         if (second == '=') {
             if (c == '!') {
                 token_ = token_type::NotEq{};
@@ -303,22 +561,22 @@ namespace parse {
             } else if (c == '<') {
                 token_ = token_type::LessOrEq{};
             }
-            input_.ignore(1);
+            input_.Ignore(1);
         } else {
             token_ = token_type::Char{c};
         }
     }
 
     void Lexer::ProcessLineFeed() {
-        if (input_.peek() != SPACE_SYMBOL &&
-            input_.peek() != LINE_FEED_SYMBOL &&
+        if (input_.Peek() != SPACE_SYMBOL &&
+            input_.Peek() != LINE_FEED_SYMBOL &&
             current_indents_count_ > 0) dedents_to_make_ = current_indents_count_;
 
         if (token_.Is<token_type::Newline>() || !initialized_) {
             token_ = NextToken();
         } else {
-            if (input_.peek() == '\n') SkipEmptyLines();
-            char c = input_.peek();
+            if (input_.Peek() == '\n') SkipEmptyLines();
+            const int c = input_.Peek();
             if ( (detail::IsAlphabetSymbol(c) || c == UNDERLINE_SYMBOL) && current_indents_count_ > 0) {
                 dedents_to_make_ = current_indents_count_;
             }
@@ -334,6 +592,9 @@ namespace parse {
             } else if (current_indents_count_ > indents_in_line) {
                 token_ = token_type::Dedent{};
                 dedents_to_make_ = current_indents_count_ - indents_in_line - 1;
+                // Оставшиеся Dedent уменьшают счётчик сами, когда NextToken их выдаёт
+                current_indents_count_ = indents_in_line + dedents_to_make_;
+                return;
             } else {
                 token_ = NextToken();
             }
@@ -345,8 +606,8 @@ namespace parse {
     }
 
     void Lexer::SkipEmptyLines() {
-        while (input_.peek() == LINE_FEED_SYMBOL) {
-            input_.ignore(1);
+        while (input_.Peek() == LINE_FEED_SYMBOL) {
+            input_.Ignore(1);
         }
     }
 }
\ No newline at end of file
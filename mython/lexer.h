@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
 #include <iosfwd>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
@@ -13,7 +16,16 @@ namespace parse {
 
     namespace token_type {
         struct Number {
-            int value;
+            int64_t value;
+        };
+
+        // Целый литерал, который не помещается в int64_t: десятичная запись без изменений
+        struct BigNumber {
+            std::string value;
+        };
+
+        struct Float {
+            double value;
         };
 
         struct Id {
@@ -48,6 +60,10 @@ namespace parse {
         struct None {};
         struct True {};
         struct False {};
+        struct While {};
+        struct For {};
+        struct In {};
+        struct Yield {};
     }
 
     using TokenBase
@@ -56,7 +72,8 @@ namespace parse {
             token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
             token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
             token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-            token_type::None, token_type::True, token_type::False, token_type::Eof>;
+            token_type::None, token_type::True, token_type::False, token_type::While,
+            token_type::For, token_type::In, token_type::Yield, token_type::BigNumber, token_type::Float, token_type::Eof>;
 
     struct Token : TokenBase {
         using TokenBase::TokenBase;
@@ -87,9 +104,57 @@ namespace parse {
         using std::runtime_error::runtime_error;
     };
 
+    // Кольцевой буфер фиксированного размера, через который лексер читает входной поток.
+    // Данные подкачиваются порциями, поэтому расход памяти не зависит от длины программы,
+    // а при чтении из конвейера ожидание длится лишь до появления первого доступного символа
+    class InputBuffer {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+        explicit InputBuffer(std::istream& input, size_t capacity = DEFAULT_CAPACITY);
+
+        int Get() {
+            if (begin_ == end_ && !Fill()) return EOF;
+            return static_cast<unsigned char>(buffer_[begin_++ & mask_]);
+        }
+
+        int Peek() {
+            if (begin_ == end_ && !Fill()) return EOF;
+            return static_cast<unsigned char>(buffer_[begin_ & mask_]);
+        }
+
+        // Возвращает в буфер последний считанный символ
+        void Putback();
+        void Ignore(size_t count);
+    private:
+        bool Fill();
+
+        std::istream& input_;
+        std::vector<char> buffer_;
+        size_t mask_;
+        size_t begin_ = 0;
+        size_t end_ = 0;
+        bool eof_ = false;
+    };
+
+    enum class LexerMode {
+        // Лексемы считываются по запросу парсера в его же потоке
+        Inline,
+        // Лексемы считываются заранее в отдельном потоке и передаются парсеру через очередь без блокировок,
+        // так что ввод и лексический анализ идут параллельно с разбором. Лексер, удалённый до конца ввода
+        // (например, после ошибки разбора), ждёт, пока поток дочитает начатую порцию, поэтому для интерактивного
+        // ввода этот режим не подходит: чтение с терминала не закончится, пока пользователь не введёт строку.
+        // Режим экспериментальный: выигрыш на многоядерной машине ещё не измерен
+        Background
+    };
+
+    class TokenPipeline;
+
     class Lexer {
     public:
-        explicit Lexer(std::istream& input);
+        explicit Lexer(std::istream& input, size_t buffer_capacity = InputBuffer::DEFAULT_CAPACITY);
+        Lexer(std::istream& input, LexerMode mode);
+        ~Lexer();
 
         [[nodiscard]] const Token& CurrentToken() const;
         Token NextToken();
@@ -109,7 +174,8 @@ namespace parse {
     private:
         static std::unordered_map<std::string, Token> token_types_;
 
-        std::istream& input_;
+        InputBuffer input_;
+        std::unique_ptr<TokenPipeline> pipeline_;
         Token token_;
         bool initialized_ = false;
         int current_indents_count_ = 0;
@@ -117,7 +183,8 @@ namespace parse {
 
         std::optional<parse::Token> ReadKeyWord(const std::string& str);
         token_type::String ReadString(char quotation_mark);
-        token_type::Number ReadNumber();
+        // Читает целое число или число с десятичной точкой
+        Token ReadNumber();
         std::string ReadIdOrKeyWord();
         void SkipComment();
         void SkipSpaces();
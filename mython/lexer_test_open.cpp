@@ -3,6 +3,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -40,8 +41,19 @@ void TestKeywords() {
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::False{}));
 }
 
+void TestLoopKeywords() {
+    istringstream input("while for in range yield"s);
+    Lexer lexer(input);
+
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::While{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::For{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::In{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"range"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Yield{}));
+}
+
 void TestNumbers() {
-    istringstream input("42 15 -53"s);
+    istringstream input("42 15 -53 9223372036854775807 9223372036854775808"s);
     Lexer lexer(input);
 
     ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Number{42}));
@@ -49,6 +61,22 @@ void TestNumbers() {
     // Отрицательные числа формируются на этапе синтаксического анализа
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'-'}));
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{53}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{9223372036854775807}));
+    // Литерал вне диапазона int64_t остаётся десятичной записью
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::BigNumber{"9223372036854775808"s}));
+}
+
+void TestFloatNumbers() {
+    istringstream input("3.25 0.5 10.0 7 -0.125 1."s);
+    Lexer lexer(input);
+
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Float{3.25}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Float{0.5}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Float{10.0}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{7}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'-'}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Float{0.125}));
+    ASSERT_THROWS(lexer.NextToken(), LexerError);
 }
 
 void TestIds() {
@@ -78,7 +106,7 @@ void TestStrings() {
 }
 
 void TestOperations() {
-    istringstream input("+-*/= > < != == <> <= >="s);
+    istringstream input("+-*/= > < != == <> <= >= @"s);
     Lexer lexer(input);
 
     ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Char{'+'}));
@@ -94,6 +122,7 @@ void TestOperations() {
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'>'}));
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::LessOrEq{}));
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::GreaterOrEq{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'@'}));
 }
 
 void TestIndentsAndNewlines() {
@@ -143,6 +172,31 @@ no_indent
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
 }
 
+void TestDedentByMultipleLevels() {
+    istringstream input("a\n  b\n    c\n      d\n  e\nf\n"s);
+    Lexer lexer(input);
+
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"a"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"b"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"c"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"d"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"e"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"f"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+}
+
 void TestEmptyLinesAreIgnored() {
     istringstream input(R"(
 x = 1
@@ -351,22 +405,104 @@ abc#
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
     }
 }
+
+void TestTokensSpanningBufferChunks() {
+    const string program = R"(
+class VeryLongClassNameThatDoesNotFitIntoTheBuffer:
+  def method_with_a_long_name(argument_number_one):
+    if argument_number_one:
+      if True:
+        if 1234567890 >= 98765:
+          return 'a rather long string literal with \'escapes\' and # inside'
+    return "x"
+# comment that is definitely longer than the buffer
+print VeryLongClassNameThatDoesNotFitIntoTheBuffer().method_with_a_long_name(True)
+)"s;
+
+    auto read_all = [&program](size_t capacity) {
+        istringstream input(program);
+        Lexer lexer(input, capacity);
+        vector<Token> tokens{lexer.CurrentToken()};
+        while (!lexer.CurrentToken().Is<token_type::Eof>()) {
+            tokens.push_back(lexer.NextToken());
+        }
+        return tokens;
+    };
+
+    const vector<Token> expected = read_all(InputBuffer::DEFAULT_CAPACITY);
+    ASSERT(expected.size() > 40U);
+    for (size_t capacity : {2U, 3U, 4U, 8U, 16U}) {
+        ASSERT_EQUAL(read_all(capacity), expected);
+    }
+}
+
+void TestBackgroundLexer() {
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(delta):
+    if delta >= 0:
+      self.value = self.value + delta
+    else:
+      print "negative delta", delta
+c = Counter()
+c.add(5)
+print c.value, 'done'
+)"s;
+    {
+        istringstream inline_input(program);
+        istringstream background_input(program);
+        Lexer inline_lexer(inline_input);
+        Lexer background_lexer(background_input, LexerMode::Background);
+
+        ASSERT_EQUAL(background_lexer.CurrentToken(), inline_lexer.CurrentToken());
+        while (!inline_lexer.CurrentToken().Is<token_type::Eof>()) {
+            ASSERT_EQUAL(background_lexer.NextToken(), inline_lexer.NextToken());
+        }
+        ASSERT_EQUAL(background_lexer.NextToken(), Token(token_type::Eof{}));
+    }
+    {
+        istringstream input("x = 'unterminated\ny = 1\n"s);
+        Lexer lexer(input, LexerMode::Background);
+        ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"x"s}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'='}));
+        ASSERT_THROWS(lexer.NextToken(), LexerError);
+    }
+    {
+        // Лексер, брошенный парсером на середине, должен корректно остановить фоновый поток
+        ostringstream long_program;
+        for (int i = 0; i < 100000; ++i) {
+            long_program << "x = "s << i << '\n';
+        }
+        istringstream input(long_program.str());
+        Lexer lexer(input, LexerMode::Background);
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'='}));
+    }
+}
+
 }  // namespace
 
 void RunOpenLexerTests(TestRunner& tr) {
     RUN_TEST(tr, parse::TestSimpleAssignment);
     RUN_TEST(tr, parse::TestKeywords);
+    RUN_TEST(tr, parse::TestLoopKeywords);
     RUN_TEST(tr, parse::TestNumbers);
+    RUN_TEST(tr, parse::TestFloatNumbers);
     RUN_TEST(tr, parse::TestIds);
     RUN_TEST(tr, parse::TestStrings);
     RUN_TEST(tr, parse::TestOperations);
     RUN_TEST(tr, parse::TestIndentsAndNewlines);
+    RUN_TEST(tr, parse::TestDedentByMultipleLevels);
     RUN_TEST(tr, parse::TestEmptyLinesAreIgnored);
     RUN_TEST(tr, parse::TestExpect);
     RUN_TEST(tr, parse::TestExpectNext);
     RUN_TEST(tr, parse::TestMythonProgram);
     RUN_TEST(tr, parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
     RUN_TEST(tr, parse::TestCommentsAreIgnored);
+    RUN_TEST(tr, parse::TestTokensSpanningBufferChunks);
+    RUN_TEST(tr, parse::TestBackgroundLexer);
 }
 
 }  // namespace parse
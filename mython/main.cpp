@@ -1,10 +1,18 @@
+#include "arena.h"
+#include "gc.h"
+#include "interpreter.h"
 #include "lexer.h"
 #include "parse.h"
 #include "runtime.h"
 #include "statement.h"
 #include "test_runner.h"
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string_view>
 
 using namespace std;
 
@@ -18,9 +26,14 @@ void RunUnitTests(TestRunner& tr);
 namespace runtime {
 void RunObjectHolderTests(TestRunner& tr);
 void RunObjectsTests(TestRunner& tr);
+void RunBuiltinsTests(TestRunner& tr);
+void RunArrayTests(TestRunner& tr);
+void RunBigIntTests(TestRunner& tr);
 }  // namespace runtime
 
 void TestParseProgram(TestRunner& tr);
+void RunInterpreterTests(TestRunner& tr);
+void RunBenchmarks(ostream& out);
 
 namespace {
 
@@ -33,6 +46,26 @@ void RunMythonProgram(istream& input, ostream& output) {
     program->Execute(closure, context);
 }
 
+// Выполняет каждую инструкцию верхнего уровня сразу после её разбора и тут же освобождает её узлы AST
+void RunMythonProgramStreaming(istream& input, ostream& output) {
+    Interpreter interpreter(output);
+    interpreter.Run(input);
+}
+
+// Программа из файла читается в память целиком, поэтому её можно разбирать на нескольких потоках
+void RunMythonFile(const string& path, ostream& output) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("Cannot open file "s + path);
+    }
+    const string program{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+    auto statements = ParseProgramParallel(program);
+
+    runtime::SimpleContext context{output};
+    runtime::Closure closure;
+    statements->Execute(closure, context);
+}
+
 void TestSimplePrints() {
     istringstream input(R"(
 print 57
@@ -111,27 +144,117 @@ print y.value
     ASSERT_EQUAL(output.str(), "2\n3\n");
 }
 
+void TestStreamingExecution() {
+    istringstream input(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add():
+    self.value = self.value + 1
+
+x = 57
+s = 'hello'
+c = Counter()
+c.add()
+print x, s, c.value
+d = Counter()
+print c.value, d.value
+print 'before error'
+print 1 +
+)");
+
+    ostringstream output;
+    ASSERT_THROWS(RunMythonProgramStreaming(input, output), runtime_error);
+
+    ASSERT_EQUAL(output.str(), "57 hello 1\n1 0\nbefore error\n");
+}
+
 void TestAll() {
     TestRunner tr;
     parse::RunOpenLexerTests(tr);
     runtime::RunObjectHolderTests(tr);
     runtime::RunObjectsTests(tr);
+    runtime::RunBuiltinsTests(tr);
+    runtime::RunArrayTests(tr);
+    runtime::RunBigIntTests(tr);
     ast::RunUnitTests(tr);
     TestParseProgram(tr);
+    RunInterpreterTests(tr);
 
     RUN_TEST(tr, TestSimplePrints);
     RUN_TEST(tr, TestAssignments);
     RUN_TEST(tr, TestArithmetics);
     RUN_TEST(tr, TestVariablesArePointers);
+    RUN_TEST(tr, TestStreamingExecution);
+}
+
+// Разбирает программу из файла, не выполняя её, и выводит вызовы, которые выполняются как хвостовые
+void PrintTailCalls(const string& path, ostream& output) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("Cannot open file "s + path);
+    }
+    parse::Lexer lexer(input);
+    vector<TailCallSite> tail_calls;
+    ParseProgram(lexer, tail_calls);
+
+    for (const TailCallSite& site : tail_calls) {
+        output << site.class_name << '.' << site.method << ": return "sv << site.callee << "()"sv
+               << (site.self_recursive ? " [self-recursive]"sv : ""sv) << '\n';
+    }
+}
+
+void PrintGcStats(ostream& output) {
+    const runtime::GcStats stats = runtime::GetGcStats();
+    const auto to_ms = [](chrono::nanoseconds duration) {
+        return chrono::duration<double, milli>(duration).count();
+    };
+    output << "gc: "sv << stats.collections << " collections, "sv << stats.collected << " objects collected, "sv
+           << stats.live_objects << " live, pause total "sv << to_ms(stats.total_pause) << " ms, max "sv
+           << to_ms(stats.max_pause) << " ms\n"sv;
 }
 
 }  // namespace
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Без синхронизации с stdio у cin появляется собственный буфер, и лексер забирает ввод порциями
+    ios::sync_with_stdio(false);
     try {
         TestAll();
 
-        RunMythonProgram(cin, cout);
+        // Флаги перед остальными аргументами: --gc включает сборщик циклов и выводит его счётчики в stderr,
+        // --arena выделяет объекты программы в арене, которая освобождается целиком после выполнения
+        bool gc = false;
+        bool arena = false;
+        for (; argc > 1; --argc, ++argv) {
+            if (argv[1] == "--gc"sv) {
+                gc = true;
+            } else if (argv[1] == "--arena"sv) {
+                arena = true;
+            } else {
+                break;
+            }
+        }
+        runtime::SetGcEnabled(gc);
+        runtime::ObjectArena object_arena;
+        optional<runtime::ArenaScope> arena_scope;
+        if (arena) {
+            arena_scope.emplace(object_arena);
+        }
+
+        if (argc > 1 && argv[1] == "--benchmark"sv) {
+            RunBenchmarks(cout);
+        } else if (argc > 2 && argv[1] == "--tail-calls"sv) {
+            PrintTailCalls(argv[2], cout);
+        } else if (argc > 1) {
+            RunMythonFile(argv[1], cout);
+        } else {
+            RunMythonProgramStreaming(cin, cout);
+        }
+        if (gc) {
+            PrintGcStats(cerr);
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
 		return 1;
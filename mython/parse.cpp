@@ -3,6 +3,13 @@
 #include "lexer.h"
 #include "statement.h"
 
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <streambuf>
+#include <thread>
+
 using namespace std::literals;
 
 namespace TokenType = parse::token_type;
@@ -17,18 +24,199 @@ namespace {
         return !(token == c);
     }
 
+    enum class Operator {
+        Or, And, Not, Less, Greater, Equal, NotEqual, LessOrEqual, GreaterOrEqual, In, Add, Sub, Mult, Div, Negate, OpenParen
+    };
+
+    struct OperatorInfo {
+        int precedence;
+        bool is_unary;
+        bool is_comparison;
+        ast::Comparison::Comparator comparator;
+        std::optional<runtime::ArrayOperation> array_operation;
+    };
+
+    const int OPEN_PAREN_PRECEDENCE = 0;
+    const int NOT_PRECEDENCE = 3;
+    const int COMPARISON_PRECEDENCE = 4;
+
+    // Порядок строк совпадает с порядком элементов Operator
+    const OperatorInfo OPERATORS[] = {
+            {1, false, false, nullptr, std::nullopt},
+            {2, false, false, nullptr, std::nullopt},
+            {NOT_PRECEDENCE, true, false, nullptr, std::nullopt},
+            {COMPARISON_PRECEDENCE, false, true, runtime::Less, runtime::ArrayOperation::Less},
+            {COMPARISON_PRECEDENCE, false, true, runtime::Greater, runtime::ArrayOperation::Greater},
+            {COMPARISON_PRECEDENCE, false, true, runtime::Equal, runtime::ArrayOperation::Equal},
+            {COMPARISON_PRECEDENCE, false, true, runtime::NotEqual, runtime::ArrayOperation::NotEqual},
+            {COMPARISON_PRECEDENCE, false, true, runtime::LessOrEqual, runtime::ArrayOperation::LessOrEqual},
+            {COMPARISON_PRECEDENCE, false, true, runtime::GreaterOrEqual, runtime::ArrayOperation::GreaterOrEqual},
+            {COMPARISON_PRECEDENCE, false, true, runtime::Contains, std::nullopt},
+            {5, false, false, nullptr, std::nullopt},
+            {5, false, false, nullptr, std::nullopt},
+            {6, false, false, nullptr, std::nullopt},
+            {6, false, false, nullptr, std::nullopt},
+            {7, true, false, nullptr, std::nullopt},
+            {OPEN_PAREN_PRECEDENCE, false, false, nullptr, std::nullopt},
+    };
+
+    const OperatorInfo &GetInfo(Operator op) {
+        return OPERATORS[static_cast<size_t>(op)];
+    }
+
+    std::optional<Operator> BinaryOperator(const parse::Token &token) {
+        if (const auto *c = token.TryAs<TokenType::Char>()) {
+            switch (c->value) {
+                case '+': return Operator::Add;
+                case '-': return Operator::Sub;
+                case '*': return Operator::Mult;
+                case '/': return Operator::Div;
+                case '<': return Operator::Less;
+                case '>': return Operator::Greater;
+                default: return std::nullopt;
+            }
+        }
+        if (token.Is<TokenType::Or>()) return Operator::Or;
+        if (token.Is<TokenType::And>()) return Operator::And;
+        if (token.Is<TokenType::Eq>()) return Operator::Equal;
+        if (token.Is<TokenType::NotEq>()) return Operator::NotEqual;
+        if (token.Is<TokenType::LessOrEq>()) return Operator::LessOrEqual;
+        if (token.Is<TokenType::GreaterOrEq>()) return Operator::GreaterOrEqual;
+        if (token.Is<TokenType::In>()) return Operator::In;
+        return std::nullopt;
+    }
+
+    // not допустим только там, где грамматика ожидает логическое выражение:
+    // в начале выражения, после скобки, and, or или другого not
+    bool AcceptsNot(const std::vector<Operator> &operators) {
+        return operators.empty() || GetInfo(operators.back()).precedence <= NOT_PRECEDENCE;
+    }
+
+    bool HasPendingComparison(const std::vector<Operator> &operators) {
+        for (auto it = operators.rbegin(); it != operators.rend() && GetInfo(*it).precedence >= COMPARISON_PRECEDENCE; ++it) {
+            if (GetInfo(*it).is_comparison) return true;
+        }
+        return false;
+    }
+
+    std::unique_ptr<ast::Statement> MakeOperation(Operator op, std::unique_ptr<ast::Statement> lhs,
+                                                  std::unique_ptr<ast::Statement> rhs) {
+        switch (op) {
+            case Operator::Or: return std::make_unique<ast::Or>(std::move(lhs), std::move(rhs));
+            case Operator::And: return std::make_unique<ast::And>(std::move(lhs), std::move(rhs));
+            case Operator::Add: return std::make_unique<ast::Add>(std::move(lhs), std::move(rhs));
+            case Operator::Sub: return std::make_unique<ast::Sub>(std::move(lhs), std::move(rhs));
+            case Operator::Mult: return std::make_unique<ast::Mult>(std::move(lhs), std::move(rhs));
+            case Operator::Div: return std::make_unique<ast::Div>(std::move(lhs), std::move(rhs));
+            default: return std::make_unique<ast::Comparison>(GetInfo(op).comparator, std::move(lhs), std::move(rhs),
+                                                              GetInfo(op).array_operation);
+        }
+    }
+
+    // Сворачивает операции с вершины стека, пока их приоритет не ниже min_precedence
+    void ReduceOperators(std::vector<std::unique_ptr<ast::Statement>> &operands, std::vector<Operator> &operators,
+                         int min_precedence) {
+        while (!operators.empty() && operators.back() != Operator::OpenParen &&
+               GetInfo(operators.back()).precedence >= min_precedence) {
+            const Operator op = operators.back();
+            operators.pop_back();
+            std::unique_ptr<ast::Statement> rhs = std::move(operands.back());
+            operands.pop_back();
+            if (op == Operator::Not) {
+                operands.push_back(std::make_unique<ast::Not>(std::move(rhs)));
+            } else if (GetInfo(op).is_unary) {
+                operands.push_back(std::make_unique<ast::Mult>(std::move(rhs), std::make_unique<ast::NumericConst>(-1)));
+            } else {
+                operands.back() = MakeOperation(op, std::move(operands.back()), std::move(rhs));
+            }
+        }
+    }
+
+    // Классы, объявленные в программе, с номерами инструкций верхнего уровня, в которых они объявлены.
+    // Объекты классов создаются заранее, поэтому части программы, разбираемые параллельно,
+    // могут ссылаться на классы из других частей так же, как это делает последовательный парсер
+    class ClassTable {
+    public:
+        void Add(const std::string &name, size_t unit) {
+            declarations_[name].push_back({unit, runtime::ObjectHolder::Own(runtime::Class(name, {}, nullptr))});
+        }
+
+        // Возвращает класс, объявленный раньше инструкции unit
+        [[nodiscard]] const runtime::ObjectHolder *Find(const std::string &name, size_t unit) const {
+            auto it = declarations_.find(name);
+            if (it == declarations_.end() || it->second.front().unit >= unit) {
+                return nullptr;
+            }
+            return &it->second.front().cls;
+        }
+
+        [[nodiscard]] const runtime::ObjectHolder *FindDeclaredAt(const std::string &name, size_t unit) const {
+            auto it = declarations_.find(name);
+            if (it == declarations_.end()) {
+                return nullptr;
+            }
+            for (const Declaration &declaration : it->second) {
+                if (declaration.unit == unit) {
+                    return &declaration.cls;
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        struct Declaration {
+            size_t unit;
+            runtime::ObjectHolder cls;
+        };
+
+        std::unordered_map<std::string, std::vector<Declaration>> declarations_;
+    };
+
     class Parser {
     public:
         explicit Parser(parse::Lexer &lexer)
                 : lexer_(lexer) {
         }
 
+        Parser(parse::Lexer &lexer, const runtime::BuiltinRegistry &builtins,
+               std::vector<runtime::ObjectHolder> &declared_classes)
+                : lexer_(lexer), builtins_(&builtins), class_owners_(&declared_classes) {
+        }
+
+        Parser(parse::Lexer &lexer, std::vector<TailCallSite> &tail_calls)
+                : lexer_(lexer), tail_calls_(&tail_calls) {
+        }
+
+        Parser(parse::Lexer &lexer, const ClassTable &class_table, size_t first_unit)
+                : lexer_(lexer), class_table_(&class_table), unit_(first_unit) {
+        }
+
         std::unique_ptr<ast::Statement> ParseProgram() {
             auto result = std::make_unique<ast::Compound>();
             while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
                 result->AddStatement(ParseStatement());
+                ++unit_;
+            }
+
+            return result;
+        }
+
+        void ParseProgram(const StatementHandler &handler) {
+            while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
+                handler(ParseStatement());
+                ++unit_;
+                // Литералы выполненной инструкции держат только её узлы. Пул на весь поток ввода рос бы с каждым
+                // новым литералом, поэтому при потоковом разборе литералы разделяются в пределах инструкции
+                string_constants_.clear();
             }
+        }
 
+        std::vector<std::unique_ptr<ast::Statement>> ParseStatements() {
+            std::vector<std::unique_ptr<ast::Statement>> result;
+            while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
+                result.push_back(ParseStatement());
+                ++unit_;
+            }
             return result;
         }
 
@@ -53,8 +241,11 @@ namespace {
         std::vector<runtime::Method> ParseMethods() {
             std::vector<runtime::Method> result;
 
-            while (lexer_.CurrentToken().Is<TokenType::Def>()) {
+            while (lexer_.CurrentToken().Is<TokenType::Def>() || lexer_.CurrentToken() == '@') {
                 runtime::Method m;
+                if (lexer_.CurrentToken() == '@') {
+                    m.memo = ParseDecorator();
+                }
 
                 m.name = lexer_.ExpectNext<TokenType::Id>().value;
                 lexer_.ExpectNext<TokenType::Char>('(');
@@ -70,13 +261,49 @@ namespace {
                 lexer_.ExpectNext<TokenType::Char>(':');
                 lexer_.NextToken();
 
-                m.body = std::make_unique<ast::MethodBody>(ParseSuite());
+                in_method_ = true;
+                method_has_yield_ = false;
+                method_name_ = &m.name;
+                const size_t tail_call_count = tail_calls_ != nullptr ? tail_calls_->size() : 0;
+                auto body = ParseSuite();
+                in_method_ = false;
+                // Метод с yield хотя бы в одной инструкции становится генератором
+                if (method_has_yield_) {
+                    if (m.memo) {
+                        throw ParseError("@memo can't be applied to generator method "s + m.name);
+                    }
+                    // Генератор выполняет хвостовые вызовы как обычные, поэтому в отчёт они не попадают
+                    if (tail_calls_ != nullptr) {
+                        tail_calls_->resize(tail_call_count);
+                    }
+                    m.body = std::make_unique<ast::GeneratorMethodBody>(std::move(body));
+                } else {
+                    ast::MarkTailPosition(*body);
+                    m.body = std::make_unique<ast::MethodBody>(std::move(body));
+                }
 
                 result.push_back(std::move(m));
             }
             return result;
         }
 
+        // Разбирает декоратор перед def. Поддерживается только @memo с необязательной ёмкостью кэша: @memo(100)
+        std::unique_ptr<runtime::MemoCache> ParseDecorator() {
+            const std::string name = lexer_.ExpectNext<TokenType::Id>().value;
+            if (name != "memo"s) {
+                throw ParseError("Unknown decorator @"s + name);
+            }
+            size_t capacity = runtime::MemoCache::DEFAULT_CAPACITY;
+            if (lexer_.NextToken() == '(') {
+                capacity = static_cast<size_t>(lexer_.ExpectNext<TokenType::Number>().value);
+                lexer_.ExpectNext<TokenType::Char>(')');
+                lexer_.NextToken();
+            }
+            lexer_.Expect<TokenType::Newline>();
+            lexer_.ExpectNext<TokenType::Def>();
+            return std::make_unique<runtime::MemoCache>(capacity);
+        }
+
         std::unique_ptr<ast::Statement> ParseClassDefinition() {
             std::string class_name = lexer_.Expect<TokenType::Id>().value;
 
@@ -88,35 +315,60 @@ namespace {
                 lexer_.ExpectNext<TokenType::Char>(')');
                 lexer_.NextToken();
 
-                auto it = declared_classes_.find(name);
-                if (it == declared_classes_.end()) {
+                base_class = FindClass(name);
+                if (base_class == nullptr) {
                     throw ParseError("Base class "s + name + " not found for class "s + class_name);
                 }
-                base_class = static_cast<const runtime::Class *>(it->second.Get());
             }
 
             lexer_.Expect<TokenType::Char>(':');
             lexer_.ExpectNext<TokenType::Newline>();
             lexer_.ExpectNext<TokenType::Indent>();
-            lexer_.ExpectNext<TokenType::Def>();
+            if (lexer_.NextToken() != '@') {
+                lexer_.Expect<TokenType::Def>();
+            }
+            class_name_ = &class_name;
             std::vector<runtime::Method> methods = ParseMethods();
 
             lexer_.Expect<TokenType::Dedent>();
             lexer_.NextToken();
 
-            auto [it, inserted] = declared_classes_.insert({
-                                                                   class_name,
-                                                                   runtime::ObjectHolder::Own(runtime::Class(class_name,
-                                                                                                             std::move(
-                                                                                                                     methods),
-                                                                                                             base_class)),
-                                                           });
+            return std::make_unique<ast::ClassDefinition>(DeclareClass(class_name, std::move(methods), base_class));
+        }
 
-            if (!inserted) {
-                throw ParseError("Class "s + class_name + " already exists"s);
+        [[nodiscard]] const runtime::Class *FindClass(const std::string &name) const {
+            const runtime::ObjectHolder *cls = nullptr;
+            if (class_table_ != nullptr) {
+                cls = class_table_->Find(name, unit_);
+            } else if (auto it = declared_classes_.find(name); it != declared_classes_.end()) {
+                cls = &it->second;
+            }
+            return cls != nullptr ? static_cast<const runtime::Class *>(cls->Get()) : nullptr;
+        }
+
+        runtime::ObjectHolder DeclareClass(const std::string &class_name, std::vector<runtime::Method> methods,
+                                           const runtime::Class *base_class) {
+            if (class_table_ == nullptr) {
+                auto [it, inserted] = declared_classes_.insert({
+                        class_name,
+                        runtime::ObjectHolder::Own(runtime::Class(class_name, std::move(methods), base_class)),
+                });
+                if (!inserted) {
+                    throw ParseError("Class "s + class_name + " already exists"s);
+                }
+                if (class_owners_ != nullptr) {
+                    class_owners_->push_back(it->second);
+                }
+                return it->second;
             }
 
-            return std::make_unique<ast::ClassDefinition>(it->second);
+            const runtime::ObjectHolder *cls = class_table_->FindDeclaredAt(class_name, unit_);
+            if (cls == nullptr || class_table_->Find(class_name, unit_) != nullptr) {
+                throw ParseError("Class "s + class_name + " already exists"s);
+            }
+            // Объект класса принадлежит только этой инструкции, поэтому его можно заполнять без синхронизации
+            static_cast<runtime::Class *>(cls->Get())->Define(std::move(methods), base_class);
+            return *cls;
         }
 
         std::vector<std::string> ParseDottedIds() {
@@ -133,6 +385,9 @@ namespace {
             lexer_.Expect<TokenType::Id>();
 
             std::vector<std::string> id_list = ParseDottedIds();
+            if (lexer_.CurrentToken() == '[') {
+                return ParseSubscriptAssignment(std::move(id_list));
+            }
             std::string last_name = id_list.back();
             id_list.pop_back();
 
@@ -148,10 +403,6 @@ namespace {
             lexer_.Expect<TokenType::Char>('(');
             lexer_.NextToken();
 
-            if (id_list.empty()) {
-                throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
-            }
-
             std::vector<std::unique_ptr<ast::Statement>> args;
             if (lexer_.CurrentToken() != ')') {
                 args = ParseTestList();
@@ -159,61 +410,72 @@ namespace {
             lexer_.Expect<TokenType::Char>(')');
             lexer_.NextToken();
 
+            if (id_list.empty()) {
+                // Встроенную функцию можно вызвать ради её действия, не используя результат
+                if (const runtime::Builtin *builtin = builtins_->Find(last_name)) {
+                    CheckArgumentCount(*builtin, args.size());
+                    return std::make_unique<ast::BuiltinCall>(*builtin, std::move(args));
+                }
+                throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
+            }
+
             return std::make_unique<ast::MethodCall>(std::make_unique<ast::VariableValue>(std::move(id_list)),
                                                      std::move(last_name), std::move(args));
         }
 
-        std::unique_ptr<ast::Statement> ParseExpression() {
-            std::unique_ptr<ast::Statement> result = ParseAdder();
-            while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-') {
-                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-                lexer_.NextToken();
-
-                if (op == '+') {
-                    result = std::make_unique<ast::Add>(std::move(result), ParseAdder());
-                } else {
-                    result = std::make_unique<ast::Sub>(std::move(result), ParseAdder());
-                }
+        std::unique_ptr<ast::Statement> ParseSubscriptAssignment(std::vector<std::string> names) {
+            std::unique_ptr<ast::Statement> object = std::make_unique<ast::VariableValue>(std::move(names));
+            std::unique_ptr<ast::Statement> index = ParseIndex();
+            while (lexer_.CurrentToken() == '[') {
+                object = std::make_unique<ast::Subscript>(std::move(object), std::move(index));
+                index = ParseIndex();
             }
-            return result;
+            lexer_.Expect<TokenType::Char>('=');
+            lexer_.NextToken();
+
+            return std::make_unique<ast::SubscriptAssignment>(std::move(object), std::move(index), ParseTest());
         }
 
-        std::unique_ptr<ast::Statement> ParseAdder() {
-            std::unique_ptr<ast::Statement> result = ParseMult();
-            while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/') {
-                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-                lexer_.NextToken();
+        std::unique_ptr<ast::Statement> ParseIndex() {
+            lexer_.Expect<TokenType::Char>('[');
+            lexer_.NextToken();
+            auto index = ParseTest();
+            lexer_.Expect<TokenType::Char>(']');
+            lexer_.NextToken();
+            return index;
+        }
 
-                if (op == '*') {
-                    result = std::make_unique<ast::Mult>(std::move(result), ParseMult());
-                } else {
-                    result = std::make_unique<ast::Div>(std::move(result), ParseMult());
-                }
+        std::unique_ptr<ast::Statement> ParsePrimary() {
+            std::unique_ptr<ast::Statement> result = ParseAtom();
+            while (lexer_.CurrentToken() == '[') {
+                result = std::make_unique<ast::Subscript>(std::move(result), ParseIndex());
             }
             return result;
         }
 
-        std::unique_ptr<ast::Statement> ParseMult() {
-            if (lexer_.CurrentToken() == '(') {
-                lexer_.NextToken();
-                auto result = ParseTest();
-                lexer_.Expect<TokenType::Char>(')');
+        std::unique_ptr<ast::Statement> ParseAtom() {
+            if (const auto *num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+                int64_t result = num->value;
                 lexer_.NextToken();
-                return result;
+                return std::make_unique<ast::NumericConst>(result);
             }
-            if (lexer_.CurrentToken() == '-') {
+            if (const auto *num = lexer_.CurrentToken().TryAs<TokenType::BigNumber>()) {
+                runtime::BigInt result = *runtime::BigInt::FromString(num->value);
                 lexer_.NextToken();
-                return std::make_unique<ast::Mult>(ParseMult(), std::make_unique<ast::NumericConst>(-1));
+                return std::make_unique<ast::BigIntConst>(std::move(result));
             }
-            if (const auto *num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
-                int result = num->value;
+            if (const auto *num = lexer_.CurrentToken().TryAs<TokenType::Float>()) {
+                double result = num->value;
                 lexer_.NextToken();
-                return std::make_unique<ast::NumericConst>(result);
+                return std::make_unique<ast::FloatConst>(result);
             }
             if (const auto *str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
-                std::string result = str->value;
+                auto [it, inserted] = string_constants_.try_emplace(str->value);
+                if (inserted) {
+                    it->second = runtime::ObjectHolder::Own(runtime::String(str->value));
+                }
                 lexer_.NextToken();
-                return std::make_unique<ast::StringConst>(std::move(result));
+                return std::make_unique<ast::StringConst>(it->second);
             }
             if (lexer_.CurrentToken().Is<TokenType::True>()) {
                 lexer_.NextToken();
@@ -227,10 +489,42 @@ namespace {
                 lexer_.NextToken();
                 return std::make_unique<ast::None>();
             }
+            if (lexer_.CurrentToken() == '[') {
+                std::vector<std::unique_ptr<ast::Statement>> items;
+                if (lexer_.NextToken() != ']') {
+                    items = ParseTestList();
+                }
+                lexer_.Expect<TokenType::Char>(']');
+                lexer_.NextToken();
+                return std::make_unique<ast::ListLiteral>(std::move(items));
+            }
+            if (lexer_.CurrentToken() == '{') {
+                return ParseDictLiteral();
+            }
 
             return ParseDottedIdsInMultExpr();
         }
 
+        std::unique_ptr<ast::Statement> ParseDictLiteral() {
+            std::vector<std::pair<std::unique_ptr<ast::Statement>, std::unique_ptr<ast::Statement>>> items;
+            lexer_.Expect<TokenType::Char>('{');
+            if (lexer_.NextToken() != '}') {
+                while (true) {
+                    auto key = ParseTest();
+                    lexer_.Expect<TokenType::Char>(':');
+                    lexer_.NextToken();
+                    items.emplace_back(std::move(key), ParseTest());
+                    if (lexer_.CurrentToken() != ',') {
+                        break;
+                    }
+                    lexer_.NextToken();
+                }
+            }
+            lexer_.Expect<TokenType::Char>('}');
+            lexer_.NextToken();
+            return std::make_unique<ast::DictLiteral>(std::move(items));
+        }
+
         std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
             std::vector<std::string> names = ParseDottedIds();
 
@@ -250,21 +544,34 @@ namespace {
                             std::make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
                             std::move(args));
                 }
-                if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
-                    return std::make_unique<ast::NewInstance>(
-                            static_cast<const runtime::Class &>(*it->second), std::move(args));  // NOLINT
+                if (const runtime::Class *cls = FindClass(method_name)) {
+                    return std::make_unique<ast::NewInstance>(*cls, std::move(args));
                 }
-                if (method_name == "str"sv) {
-                    if (args.size() != 1) {
-                        throw ParseError("Function str takes exactly one argument"s);
-                    }
-                    return std::make_unique<ast::Stringify>(std::move(args.front()));
+                if (const runtime::Builtin *builtin = builtins_->Find(method_name)) {
+                    CheckArgumentCount(*builtin, args.size());
+                    return std::make_unique<ast::BuiltinCall>(*builtin, std::move(args));
                 }
                 throw ParseError("Unknown call to "s + method_name + "()"s);
             }
             return std::make_unique<ast::VariableValue>(std::move(names));
         }
 
+        static void CheckArgumentCount(const runtime::Builtin &builtin, size_t count) {
+            if (count >= builtin.min_args && count <= builtin.max_args) {
+                return;
+            }
+            if (builtin.min_args == builtin.max_args) {
+                throw ParseError("Function "s + builtin.name + " takes exactly "s + std::to_string(builtin.min_args)
+                                 + (builtin.min_args == 1 ? " argument"s : " arguments"s));
+            }
+            if (builtin.max_args == std::numeric_limits<size_t>::max()) {
+                throw ParseError("Function "s + builtin.name + " takes at least "s + std::to_string(builtin.min_args)
+                                 + (builtin.min_args == 1 ? " argument"s : " arguments"s));
+            }
+            throw ParseError("Function "s + builtin.name + " takes from "s + std::to_string(builtin.min_args) + " to "s
+                             + std::to_string(builtin.max_args) + " arguments"s);
+        }
+
         std::vector <std::unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
         {
             std::vector <std::unique_ptr<ast::Statement>> result;
@@ -300,72 +607,105 @@ namespace {
                                             std::move(else_body));
         }
 
-        std::unique_ptr <ast::Statement> ParseTest()
-        {
-            auto result = ParseAndTest();
-            while (lexer_.CurrentToken().Is<TokenType::Or>()) {
-                lexer_.NextToken();
-                result = std::make_unique<ast::Or>(std::move(result), ParseAndTest());
-            }
-            return result;
+        std::unique_ptr<ast::Statement> ParseWhile() {
+            lexer_.Expect<TokenType::While>();
+            lexer_.NextToken();
+
+            auto condition = ParseTest();
+
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+
+            return std::make_unique<ast::While>(std::move(condition), ParseSuite());
         }
 
-        std::unique_ptr <ast::Statement> ParseAndTest()
-        {
-            auto result = ParseNotTest();
-            while (lexer_.CurrentToken().Is<TokenType::And>()) {
-                lexer_.NextToken();
-                result = std::make_unique<ast::And>(std::move(result), ParseNotTest());
+        // range() разбирается особо и превращается в ForRange, все остальные выражения перебираются как списки
+        std::unique_ptr<ast::Statement> ParseFor() {
+            lexer_.Expect<TokenType::For>();
+            std::string var = lexer_.ExpectNext<TokenType::Id>().value;
+            lexer_.ExpectNext<TokenType::In>();
+
+            if (lexer_.NextToken() == TokenType::Id{"range"s}) {
+                return ParseForRange(std::move(var));
             }
-            return result;
+            auto iterable = ParseTest();
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+
+            return std::make_unique<ast::ForEach>(std::move(var), std::move(iterable), ParseSuite());
         }
 
-        std::unique_ptr <ast::Statement> ParseNotTest()
-        {
-            if (lexer_.CurrentToken().Is<TokenType::Not>()) {
-                lexer_.NextToken();
-                return std::make_unique<ast::Not>(ParseNotTest());
+        std::unique_ptr<ast::Statement> ParseForRange(std::string var) {
+            lexer_.ExpectNext<TokenType::Char>('(');
+            lexer_.NextToken();
+
+            std::vector<std::unique_ptr<ast::Statement>> args = ParseTestList();
+            if (args.size() > 3) {
+                throw ParseError("range() takes from 1 to 3 arguments"s);
             }
-            return ParseComparison();
+            lexer_.Expect<TokenType::Char>(')');
+            lexer_.ExpectNext<TokenType::Char>(':');
+            lexer_.NextToken();
+
+            if (args.size() == 1) {
+                args.insert(args.begin(), std::make_unique<ast::NumericConst>(0));
+            }
+            std::unique_ptr<ast::Statement> step = args.size() == 3 ? std::move(args[2]) : nullptr;
+            return std::make_unique<ast::ForRange>(std::move(var), std::move(args[0]), std::move(args[1]),
+                                                   std::move(step), ParseSuite());
         }
 
-        std::unique_ptr <ast::Statement> ParseComparison()
+        // Разбирает выражение методом предшествования операций без рекурсии: операнды и операции
+        // копятся в стеках и сворачиваются в узлы AST согласно таблице OPERATORS.
+        // Скобки, унарный минус и not тоже кладутся в стек, поэтому глубина вложенности не ограничена стеком вызовов
+        std::unique_ptr <ast::Statement> ParseTest()
         {
-            auto result = ParseExpression();
+            std::vector<std::unique_ptr<ast::Statement>> operands;
+            std::vector<Operator> operators;
+            size_t open_parens = 0;
+
+            while (true) {
+                const auto &operand_token = lexer_.CurrentToken();
+                if (operand_token.Is<TokenType::Not>() && AcceptsNot(operators)) {
+                    operators.push_back(Operator::Not);
+                    lexer_.NextToken();
+                    continue;
+                }
+                if (operand_token == '-') {
+                    operators.push_back(Operator::Negate);
+                    lexer_.NextToken();
+                    continue;
+                }
+                if (operand_token == '(') {
+                    operators.push_back(Operator::OpenParen);
+                    ++open_parens;
+                    lexer_.NextToken();
+                    continue;
+                }
+                operands.push_back(ParsePrimary());
 
-            const auto tok = lexer_.CurrentToken();
+                while (open_parens > 0 && lexer_.CurrentToken() == ')') {
+                    ReduceOperators(operands, operators, OPEN_PAREN_PRECEDENCE);
+                    operators.pop_back();
+                    --open_parens;
+                    lexer_.NextToken();
+                }
 
-            if (tok == '<') {
-                lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::Less, std::move(result),
-                                                    ParseExpression());
-            }
-            if (tok == '>') {
-                lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::Greater, std::move(result),
-                                                    ParseExpression());
-            }
-            if (tok.Is<TokenType::Eq>()) {
-                lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::Equal, std::move(result),
-                                                    ParseExpression());
-            }
-            if (tok.Is<TokenType::NotEq>()) {
-                lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
-                                                    ParseExpression());
-            }
-            if (tok.Is<TokenType::LessOrEq>()) {
+                const std::optional<Operator> op = BinaryOperator(lexer_.CurrentToken());
+                // Сравнения не объединяются в цепочки: a < b < c заканчивает выражение перед вторым сравнением
+                if (!op || (GetInfo(*op).is_comparison && HasPendingComparison(operators))) {
+                    break;
+                }
+                ReduceOperators(operands, operators, GetInfo(*op).precedence);
+                operators.push_back(*op);
                 lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
-                                                    ParseExpression());
             }
-            if (tok.Is<TokenType::GreaterOrEq>()) {
-                lexer_.NextToken();
-                return std::make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
-                                                    ParseExpression());
+
+            if (open_parens > 0) {
+                lexer_.Expect<TokenType::Char>(')');
             }
-            return result;
+            ReduceOperators(operands, operators, OPEN_PAREN_PRECEDENCE);
+            return std::move(operands.back());
         }
 
         std::unique_ptr <ast::Statement> ParseStatement()
@@ -379,6 +719,12 @@ namespace {
             if (tok.Is<TokenType::If>()) {
                 return ParseCondition();
             }
+            if (tok.Is<TokenType::While>()) {
+                return ParseWhile();
+            }
+            if (tok.Is<TokenType::For>()) {
+                return ParseFor();
+            }
             auto result = ParseSimpleStatement();
             lexer_.Expect<TokenType::Newline>();
             lexer_.NextToken();
@@ -390,7 +736,24 @@ namespace {
 
             if (tok.Is<TokenType::Return>()) {
                 lexer_.NextToken();
-                return std::make_unique<ast::Return>(ParseTest());
+                auto value = ParseTest();
+                if (in_method_) {
+                    if (auto call = dynamic_cast<ast::MethodCall *>(value.get())) {
+                        RecordTailCall(*call);
+                        value = std::make_unique<ast::TailCall>(std::move(*call));
+                    }
+                }
+                return std::make_unique<ast::Return>(std::move(value));
+            }
+            if (tok.Is<TokenType::Yield>()) {
+                if (!in_method_) {
+                    throw ParseError("yield outside of a method"s);
+                }
+                method_has_yield_ = true;
+                if (lexer_.NextToken().Is<TokenType::Newline>()) {
+                    return std::make_unique<ast::Yield>(nullptr);
+                }
+                return std::make_unique<ast::Yield>(ParseTest());
             }
             if (tok.Is<TokenType::Print>()) {
                 lexer_.NextToken();
@@ -403,12 +766,167 @@ namespace {
             return ParseAssignmentOrCall();
         }
 
+        void RecordTailCall(const ast::MethodCall &call) {
+            if (tail_calls_ == nullptr) {
+                return;
+            }
+            TailCallSite site{*class_name_, *method_name_, {}, false};
+            if (auto object = dynamic_cast<const ast::VariableValue *>(&call.GetObject())) {
+                const auto &ids = object->GetDottedIds();
+                for (const auto &id: ids) {
+                    site.callee += id;
+                    site.callee += '.';
+                }
+                site.self_recursive = ids.size() == 1 && ids.front() == "self"s && call.GetMethod() == *method_name_;
+            }
+            site.callee += call.GetMethod();
+            tail_calls_->push_back(std::move(site));
+        }
+
         parse::Lexer &lexer_;
         runtime::Closure declared_classes_;
+        // Пул строковых литералов: все вхождения одного литерала разделяют один объект String.
+        // При потоковом разборе пул очищается после каждой инструкции верхнего уровня
+        std::unordered_map<std::string, runtime::ObjectHolder> string_constants_;
+        const ClassTable *class_table_ = nullptr;
+        const runtime::BuiltinRegistry *builtins_ = &runtime::Builtins();
+        // Куда передавать объявленные классы, которые должны пережить парсер
+        std::vector<runtime::ObjectHolder> *class_owners_ = nullptr;
+        bool in_method_ = false;
+        bool method_has_yield_ = false;
+        // Класс и метод, которые разбираются сейчас, и куда записывать хвостовые вызовы
+        const std::string *class_name_ = nullptr;
+        const std::string *method_name_ = nullptr;
+        std::vector<TailCallSite> *tail_calls_ = nullptr;
+        size_t unit_ = 0;
     };
 
+    // Позволяет лексеру читать фрагмент программы прямо из памяти, не копируя его
+    class MemoryBuffer : public std::streambuf {
+    public:
+        explicit MemoryBuffer(std::string_view text) {
+            char *begin = const_cast<char *>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+
+    const size_t MIN_UNITS_PER_CHUNK = 256;
+
+    bool IsIdSymbol(char c) {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    bool StartsWithKeyword(std::string_view line, std::string_view keyword) {
+        return line.substr(0, keyword.size()) == keyword
+               && (line.size() == keyword.size() || !IsIdSymbol(line[keyword.size()]));
+    }
+
+    // Находит начала инструкций верхнего уровня: строки, начинающиеся в нулевой колонке.
+    // Пустые строки, комментарии, строки с отступом и ветка else относятся к предыдущей инструкции.
+    // Строковые литералы в Mython не переносятся на следующую строку, поэтому граница внутри строки невозможна
+    std::vector<size_t> FindTopLevelUnits(std::string_view program, ClassTable &class_table) {
+        std::vector<size_t> units;
+        for (size_t pos = 0; pos < program.size();) {
+            size_t line_end = program.find('\n', pos);
+            if (line_end == std::string_view::npos) {
+                line_end = program.size();
+            }
+            std::string_view line = program.substr(pos, line_end - pos);
+
+            if (!line.empty() && line.front() != ' ' && line.front() != '#' && line.front() != '\r' &&
+                line.front() != '\t' && !StartsWithKeyword(line, "else"sv)) {
+                if (StartsWithKeyword(line, "class"sv)) {
+                    std::string_view rest = line.substr(5);
+                    rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+                    size_t name_length = 0;
+                    while (name_length < rest.size() && IsIdSymbol(rest[name_length])) {
+                        ++name_length;
+                    }
+                    if (name_length > 0 && !(rest.front() >= '0' && rest.front() <= '9')) {
+                        class_table.Add(std::string(rest.substr(0, name_length)), units.size());
+                    }
+                }
+                units.push_back(pos);
+            }
+            pos = line_end + 1;
+        }
+        return units;
+    }
+
 }
 
 std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer) {
     return Parser{lexer}.ParseProgram();
+}
+
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer, std::vector<TailCallSite>& tail_calls) {
+    return Parser{lexer, tail_calls}.ParseProgram();
+}
+
+void ParseProgram(parse::Lexer& lexer, const StatementHandler& handler) {
+    Parser{lexer}.ParseProgram(handler);
+}
+
+void ParseProgram(parse::Lexer& lexer, const runtime::BuiltinRegistry& builtins, const StatementHandler& handler,
+                  std::vector<runtime::ObjectHolder>& declared_classes) {
+    Parser{lexer, builtins, declared_classes}.ParseProgram(handler);
+}
+
+std::unique_ptr<runtime::Executable> ParseProgramParallel(std::string_view program, size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    ClassTable class_table;
+    const std::vector<size_t> units = FindTopLevelUnits(program, class_table);
+    const size_t chunk_count = std::max<size_t>(1, std::min(thread_count, units.size() / MIN_UNITS_PER_CHUNK));
+
+    struct Chunk {
+        size_t first_unit = 0;
+        std::string_view text;
+        std::vector<std::unique_ptr<ast::Statement>> statements;
+        std::exception_ptr error;
+    };
+
+    std::vector<Chunk> chunks(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        chunks[i].first_unit = i * units.size() / chunk_count;
+        const size_t begin = i == 0 ? 0 : units[chunks[i].first_unit];
+        const size_t next_unit = (i + 1) * units.size() / chunk_count;
+        const size_t end = i + 1 == chunk_count ? program.size() : units[next_unit];
+        chunks[i].text = program.substr(begin, end - begin);
+    }
+
+    auto parse_chunk = [&class_table](Chunk &chunk) {
+        try {
+            MemoryBuffer buffer(chunk.text);
+            std::istream input(&buffer);
+            parse::Lexer lexer(input);
+            chunk.statements = Parser{lexer, class_table, chunk.first_unit}.ParseStatements();
+        } catch (...) {
+            chunk.error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunk_count - 1);
+    for (size_t i = 1; i < chunk_count; ++i) {
+        workers.emplace_back(parse_chunk, std::ref(chunks[i]));
+    }
+    parse_chunk(chunks.front());
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Сообщаем о первой по тексту программы ошибке, как это сделал бы последовательный парсер
+    auto result = std::make_unique<ast::Compound>();
+    for (Chunk &chunk : chunks) {
+        if (chunk.error) {
+            std::rethrow_exception(chunk.error);
+        }
+        for (auto &statement : chunk.statements) {
+            result->AddStatement(std::move(statement));
+        }
+    }
+    return result;
 }
\ No newline at end of file
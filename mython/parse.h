@@ -1,7 +1,11 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace parse {
     class Lexer;
@@ -9,10 +13,42 @@ namespace parse {
 
 namespace runtime {
     class Executable;
+    class BuiltinRegistry;
+    class ObjectHolder;
 }
 
 struct ParseError : std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
-std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
\ No newline at end of file
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
+
+// Вызов метода в инструкции return, который парсер сделал хвостовым: он выполняется без роста стека C++
+struct TailCallSite {
+    std::string class_name;
+    std::string method;
+    // Вызываемый метод вместе с объектом, например self.sum
+    std::string callee;
+    // Метод вызывает сам себя у self
+    bool self_recursive = false;
+};
+
+// То же, что ParseProgram, но дописывает в tail_calls хвостовые вызовы в порядке их появления в тексте
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer, std::vector<TailCallSite>& tail_calls);
+
+using StatementHandler = std::function<void(std::unique_ptr<runtime::Executable>)>;
+
+// Разбирает программу по одной инструкции верхнего уровня и передаёт каждую в handler сразу после разбора.
+// Объявленные классы запоминаются между вызовами handler, поэтому сами инструкции можно уничтожать после выполнения
+void ParseProgram(parse::Lexer& lexer, const StatementHandler& handler);
+
+// То же, но вызовы функций ищутся в реестре builtins, а не в стандартном runtime::Builtins(). Объявленные классы
+// дописываются в declared_classes: объекты и узлы AST ссылаются на свой класс, и вызывающий, который хранит
+// значения программы дольше разбора, должен хранить и классы
+void ParseProgram(parse::Lexer& lexer, const runtime::BuiltinRegistry& builtins, const StatementHandler& handler,
+                  std::vector<runtime::ObjectHolder>& declared_classes);
+
+// Разбирает программу, целиком находящуюся в памяти, на нескольких потоках: текст делится по инструкциям
+// верхнего уровня, части разбираются независимо и склеиваются в исходном порядке.
+// Результат и ошибки совпадают с ParseProgram. При thread_count == 0 используется число ядер процессора
+std::unique_ptr<runtime::Executable> ParseProgramParallel(std::string_view program, size_t thread_count = 0);
\ No newline at end of file
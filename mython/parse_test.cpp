@@ -245,6 +245,689 @@ print r, c, t1, t2
                  "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
 }
 
+void TestLoops() {
+    const string program = R"(
+class Box:
+  def __init__(value):
+    self.value = value
+
+boxes_sum = 0
+for i in range(5):
+  b = Box(i)
+  boxes_sum = boxes_sum + b.value
+print boxes_sum, b.value, i
+
+for i in range(10, 0, -4):
+  print i
+
+countdown = 3
+while countdown:
+  print 'tick', countdown
+  countdown = countdown - 1
+
+class Finder:
+  def find(limit):
+    for k in range(limit):
+      if k * k > 20:
+        return k
+    return None
+
+f = Finder()
+print f.find(100), f.find(3)
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "10 4 4\n10\n6\n2\ntick 3\ntick 2\ntick 1\n5 None\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("for i in range():\n  print i\n"s), std::runtime_error);
+    ASSERT_THROWS(ParseProgramFromString("for i in range(1, 2, 3, 4):\n  print i\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("for i in xrange(3):\n  print i\n"s), ParseError);
+}
+
+void TestLists() {
+    const string program = R"(
+class Node:
+  def __init__(value):
+    self.value = value
+
+  def __str__():
+    return 'Node(' + str(self.value) + ')'
+
+values = [3, 1, 2]
+values.append(10)
+values[0] = values[0] + values[-1]
+print values, len(values), len([]), len('abc')
+
+nodes = []
+for v in values:
+  nodes.append(Node(v))
+print nodes[1], len(nodes)
+
+matrix = [[1, 2], [3, 4]]
+matrix[1][0] = 'x'
+print matrix, matrix[1][1]
+
+total = 0
+while values:
+  total = total + values.pop()
+print total, values
+if [] == [] and [1, 'a'] == [1, 'a'] and [1] != [2]:
+  print 'equal'
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "[13, 1, 2, 10] 4 0 3\nNode(1) 4\n[[1, 2], ['x', 4]] 4\n26 []\nequal\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("x = [1, 2\n"s), parse::LexerError);
+    ASSERT_THROWS(ParseProgramFromString("print len(1, 2)\n"s), ParseError);
+}
+
+void TestDicts() {
+    const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __eq__(other):
+    return self.x == other.x and self.y == other.y
+
+  def __hash__():
+    return self.x * 31 + self.y
+
+words = ['b', 'a', 'b', 'c', 'b', 'a']
+counts = {}
+for w in words:
+  if w in counts:
+    counts[w] = counts[w] + 1
+  else:
+    counts[w] = 1
+print counts, len(counts), counts['b']
+
+names = {Point(1, 2): 'first', Point(3, 4): 'second'}
+names[Point(1, 2)] = 'updated'
+print len(names), names[Point(1, 2)], Point(3, 4) in names, Point(5, 6) in names
+
+for k in {1: 'one', 'two': 2, None: True}:
+  print k
+print {}, {'x': [1, {2: 'y'}]}
+if {1: 2, 3: 4} == {3: 4, 1: 2} and not {} and 'ell' in 'hello' and 2 in [1, 2]:
+  print 'ok'
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "{'b': 3, 'a': 2, 'c': 1} 3 3\n2 updated True False\n1\ntwo\nNone\n{} {'x': [1, {2: 'y'}]}\nok\n"s);
+
+    runtime::Closure error_closure;
+    ASSERT_THROWS(ParseProgramFromString("d = {1: 2}\nprint d[2]\n"s)->Execute(error_closure, context),
+                  std::runtime_error);
+    ASSERT_THROWS(ParseProgramFromString("d = {1 2}\n"s), parse::LexerError);
+
+    // __eq__ добавляет ключи в тот же словарь и перестраивает таблицу посреди поиска ячейки
+    const string mutating_eq = R"(
+class K:
+  def __init__(base, d):
+    self.base = base
+    self.d = d
+
+  def __hash__():
+    return 1
+
+  def __eq__(other):
+    d = self.d
+    for i in range(20):
+      d[self.base * 100 + i] = i
+    return False
+
+d = {}
+for b in range(1, 4):
+  d[K(b, d)] = b
+print len(d), d[119], d[219], 319 in d
+)"s;
+    runtime::DummyContext mutating_context;
+    runtime::Closure mutating_closure;
+    ParseProgramFromString(mutating_eq)->Execute(mutating_closure, mutating_context);
+    ASSERT_EQUAL(mutating_context.output.str(), "43 19 19 False\n"s);
+}
+
+void TestFloats() {
+    const string program = R"(
+class Circle:
+  def __init__(radius):
+    self.radius = radius
+
+  def area():
+    return 3.14159 * self.radius * self.radius
+
+c = Circle(2)
+print c.area(), 0.5 + 0.25, -1.5 * 2, 10 / 4, 10 / 4.0
+print 1 < 1.5, 2.0 == 2, 0.1 + 0.2, str(1.0) + '!'
+x = 0.0
+for i in range(10):
+  x = x + 0.5
+print x, {1.0: 'one'}[1], [1.5, 2]
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "12.56636 0.75 -3.0 2 2.5\nTrue True 0.30000000000000004 1.0!\n5.0 one [1.5, 2]\n"s);
+}
+
+void TestStringLiteralsAreShared() {
+    const string program = R"(
+class Greeter:
+  def greet():
+    return 'a literal that is long enough not to fit inline'
+
+g = Greeter()
+first = g.greet()
+second = g.greet()
+third = 'a literal that is long enough not to fit inline'
+other = 'another literal'
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    // Все вхождения одного литерала разделяют объект из пула констант
+    ASSERT_EQUAL(closure.at("first"s).Get(), closure.at("second"s).Get());
+    ASSERT_EQUAL(closure.at("first"s).Get(), closure.at("third"s).Get());
+    ASSERT(closure.at("first"s).Get() != closure.at("other"s).Get());
+}
+
+void TestBuiltins() {
+    const string program = R"(
+class Shape:
+  def area():
+    return 0
+
+class Square(Shape):
+  def __init__(side):
+    self.side = side
+
+print len('abc'), abs(-3), abs(-1.5), min(3, 1, 2), max([4, 8, 1]), int('12') + 1, int(2.9)
+print ord('a'), chr(ord('a') + 1), str(range(4)), range(6, 0, -2)
+s = Square(2)
+print isinstance(s, Square), isinstance(s, Shape), isinstance(Shape(), Square), isinstance(5, Shape)
+codes = []
+for c in ['x', 'y']:
+  codes.append(ord(c))
+print codes, max(min(codes), 100)
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "3 3 1.5 1 8 13 2\n97 b [0, 1, 2, 3] [6, 4, 2]\nTrue True False False\n[120, 121] 120\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("print abs(1, 2)\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("print range()\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("print max()\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("print unknown(1)\n"s), ParseError);
+}
+
+void TestArrays() {
+    const string program = R"(
+a = array([3, 1, 2])
+f = array(3, 0.5)
+b = a * 2 + 1
+print b, a - f, 10 / a, a > 1, a == array([3, 0, 2])
+print len(b), b[0], b[-1], b.sum(), b.min(), b.max(), a.dot(f)
+b[1] = 100
+total = 0
+for x in b:
+  total = total + x
+print total, b < 10
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "array([7, 3, 5]) array([2.5, 0.5, 1.5]) array([3, 10, 5]) array([1, 0, 1]) array([1, 0, 1])\n"
+                 "3 7 5 15 3 7 3.0\n"
+                 "112 array([1, 0, 1])\n"s);
+}
+
+void TestGenerators() {
+    const string program = R"(
+class Numbers:
+  def upto(n):
+    i = 0
+    while i < n:
+      yield i
+      i = i + 1
+
+  def evens(source):
+    for x in source:
+      if x / 2 * 2 == x:
+        yield x
+
+  def squares(source):
+    for x in source:
+      yield x * x
+    return None
+    yield -1
+
+  def pairs(n):
+    for i in range(n):
+      for j in range(i):
+        yield str(i) + str(j)
+    yield
+
+  def empty():
+    if False:
+      yield 1
+
+class Factory:
+  def make():
+    numbers = Numbers()
+    return numbers.upto(3)
+
+nums = Numbers()
+g = nums.squares(nums.evens(nums.upto(10)))
+print list(g), list(g)
+print list(nums.pairs(3))
+e = nums.empty()
+print next(e), next(e, 'end')
+u = nums.upto(2)
+print next(u), next(u), next(u, 'stop'), next(u, 'stop')
+f = Factory()
+print list(f.make())
+total = 0
+for x in nums.upto(1000):
+  total = total + x
+print total
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "[0, 4, 16, 36, 64] []\n"
+                 "['10', '20', '21', None]\n"
+                 "None end\n"
+                 "0 1 stop stop\n"
+                 "[0, 1, 2]\n"
+                 "499500\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("yield 1\n"s), ParseError);
+}
+
+void TestTailCalls() {
+    const string program = R"(
+class Counter:
+  def count(i, n, acc):
+    if i < n:
+      return self.count(i + 1, n, acc + 2)
+    return acc
+
+class Parity:
+  def __init__():
+    self.other = None
+
+  def is_even(n):
+    if n == 0:
+      return True
+    return self.other.is_odd(n - 1)
+
+  def is_odd(n):
+    if n == 0:
+      return False
+    return self.other.is_even(n - 1)
+
+class Stack:
+  def __init__():
+    self.items = [1, 2, 3]
+
+  def top():
+    return self.items.pop()
+
+  def drain():
+    yield 0
+    return self.top()
+
+class Sign:
+  def classify(n):
+    if n < 0:
+      return 'negative'
+    if n == 0:
+      return 'zero'
+    print 'positive'
+    return 'positive'
+
+  def describe(n):
+    if n > 0:
+      x = self.classify(n)
+    print n
+
+c = Counter()
+print c.count(0, 1000000, 0)
+a = Parity()
+b = Parity()
+a.other = b
+b.other = a
+print a.is_even(100001), b.is_odd(100001)
+st = Stack()
+print st.top(), list(st.drain()), st.items
+sign = Sign()
+print sign.classify(-1), sign.classify(0), sign.classify(5)
+print sign.describe(3)
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    vector<TailCallSite> sites;
+    auto tree = ParseProgram(lexer, sites);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "2000000\nFalse True\n3 [0] [1]\n"
+                 "negative zero positive\npositive\n"
+                 "positive\n3\nNone\n"s);
+
+    ASSERT_EQUAL(sites.size(), 4U);
+    ASSERT_EQUAL(sites[0].class_name + "."s + sites[0].method + " "s + sites[0].callee, "Counter.count self.count"s);
+    ASSERT(sites[0].self_recursive);
+    ASSERT_EQUAL(sites[1].callee, "self.other.is_odd"s);
+    ASSERT(!sites[1].self_recursive);
+    ASSERT_EQUAL(sites[3].method + " "s + sites[3].callee, "top self.items.pop"s);
+}
+
+void TestMemo() {
+    const string program = R"(
+class Fib:
+  def __init__():
+    self.calls = 0
+
+  @memo
+  def fib(n):
+    self.calls = self.calls + 1
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+class Scorer:
+  def __init__(bonus):
+    self.bonus = bonus
+
+  @memo(2)
+  def score(word, strict):
+    if strict:
+      return len(word) + self.bonus
+    return self.bonus
+
+f = Fib()
+print f.fib(30), f.calls
+print f.fib(30), f.calls
+stats = memo_stats(Fib, 'fib')
+print stats['hits'], stats['misses'], stats['size'], stats['capacity']
+
+a = Scorer(10)
+b = Scorer(20)
+print a.score('abc', True), b.score('abc', True), a.score('abc', False)
+print a.score('abc', True), a.score([1], True)
+stats = memo_stats(Scorer, 'score')
+print stats['hits'], stats['misses'], stats['evictions'], stats['bypasses'], stats['size']
+memo_clear(Scorer, 'score')
+stats = memo_stats(Scorer, 'score')
+print stats['size']
+
+class Slow:
+  @memo
+  def slow(n):
+    print 'computing', n
+    return n * 2
+
+  def via(n):
+    return self.slow(n)
+
+s = Slow()
+print s.via(3), s.via(3), s.slow(3)
+stats = memo_stats(Slow, 'slow')
+print stats['hits'], stats['misses']
+
+class Countdown:
+  @memo(2)
+  def count(n):
+    if n == 0:
+      return 'done'
+    return self.count(n - 1)
+
+c = Countdown()
+print c.count(300000), c.count(300000), c.count(0)
+stats = memo_stats(Countdown, 'count')
+print stats['hits'], stats['misses'], stats['size']
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "832040 31\n"
+                 "832040 31\n"
+                 "29 31 31 1024\n"
+                 "13 23 10\n"
+                 "13 11\n"
+                 "0 4 2 1 2\n"
+                 "0\n"
+                 "computing 3\n"
+                 "6 6 6\n"
+                 "2 1\n"
+                 "done done done\n"
+                 "2 300001 2\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("class A:\n  @cached\n  def f():\n    return 1\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("class A:\n  @memo\n  def f():\n    yield 1\n"s), ParseError);
+}
+
+void TestBigIntegers() {
+    const string program = R"(
+class Math:
+  def factorial(n):
+    if n < 2:
+      return 1
+    return n * self.factorial(n - 1)
+
+m = Math()
+big = m.factorial(25)
+print big
+print big / m.factorial(23), big - big + 1
+top = 9223372036854775807
+print top + 1, top * top
+print top + 1 - 1 == top, top + 1 > top, top < 10000000000000000000.0
+print 123456789012345678901234567890 / 1000000000000000000000
+print -9223372036854775808, int('-9223372036854775809') + 1
+print abs(-9223372036854775807 - 1), str(top * 10)
+d = {top + 1: 'big'}
+print d[9223372036854775808]
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "15511210043330985984000000\n"
+                 "600 1\n"
+                 "9223372036854775808 85070591730234615847396907784232501249\n"
+                 "True True True\n"
+                 "123456789\n"
+                 "-9223372036854775808 -9223372036854775808\n"
+                 "9223372036854775808 92233720368547758070\n"
+                 "big\n"s);
+}
+
+void TestGarbageCollection() {
+    const string program = R"(
+class Node:
+  def __init__(value):
+    self.value = value
+    self.peer = None
+
+class Linker:
+  def link(a, b):
+    a.peer = b
+    b.peer = a
+
+gc_collect()
+before = gc_stats()['objects']
+linker = Linker()
+i = 0
+while i < 100:
+  a = Node(i)
+  b = Node(i + 1)
+  linker.link(a, b)
+  i = i + 1
+items = [a]
+items.append(items)
+items = None
+print gc_stats()['objects'] - before
+print gc_collect(), gc_stats()['objects'] - before
+print a.peer.value, b.peer.value
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    // Временный словарь gc_stats учтён и в before. После сборки живы linker и последняя пара узлов,
+    // а 99 пар и список, содержащий сам себя, — мусор
+    ASSERT_EQUAL(context.output.str(), "202\n199 3\n100 99\n"s);
+}
+
+void TestOperatorPrecedence() {
+    const string program = R"(
+x = 5
+print 2 + 3 * -4 - (1 - 2) * 3, -x - -3, 36 / 4 / 3, 1 - 2 - 3
+print not 1 < 2 and 3 > 2 or x == 5, not not True, (1 < 2) == True
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "-7 -2 3 -4\nTrue True True\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("print 1 < 2 < 3\n"s), std::runtime_error);
+    ASSERT_THROWS(ParseProgramFromString("print (1 < 2 < 3)\n"s), std::runtime_error);
+    ASSERT_THROWS(ParseProgramFromString("print 1 + not 2\n"s), std::runtime_error);
+    ASSERT_THROWS(ParseProgramFromString("print ((1 + 2)\n"s), std::runtime_error);
+}
+
+void TestDeeplyNestedExpression() {
+    const size_t depth = 100000;
+    const string program = "print "s + string(depth, '(') + "1 + 2"s + string(depth, ')') + " * "s
+                           + string(100, '-') + "3\n"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "9\n"s);
+}
+
+string MakeLargeProgram(size_t class_count) {
+    ostringstream program;
+    program << "class Base:\n  def value():\n    return 1\n\n"s;
+    for (size_t i = 0; i < class_count; ++i) {
+        program << "class C"s << i << "(Base):\n"s
+                << "  def value():\n"s
+                << "    if "s << i << " > 0:\n"s
+                << "      return 'v" << i << "'\n"s
+                << "    base = Base()\n"s
+                << "    return base.value()\n\n"s
+                << "# instance of C"s << i << "\n\n"s
+                << "x"s << i << " = C"s << i << "()\n"s
+                << "print x"s << i << ".value()\n"s;
+    }
+    return program.str();
+}
+
+string ExecuteToString(runtime::Executable& program) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program.Execute(closure, context);
+    return context.output.str();
+}
+
+void TestParallelParsing() {
+    const string program = MakeLargeProgram(1000);
+
+    auto sequential = ParseProgramFromString(program);
+    const string expected = ExecuteToString(*sequential);
+    for (size_t thread_count : {1U, 2U, 3U, 8U}) {
+        auto parallel = ParseProgramParallel(program, thread_count);
+        ASSERT_EQUAL(ExecuteToString(*parallel), expected);
+    }
+}
+
+void TestParallelParsingErrors() {
+    auto error_of = [](auto parse) {
+        try {
+            parse();
+        } catch (const std::exception& e) {
+            return string(e.what());
+        }
+        return "no error"s;
+    };
+
+    const string base = MakeLargeProgram(1000);
+    const vector<string> broken_programs = {
+            // Класс объявлен позже места использования
+            base + "y = Late()\nclass Late:\n  def f():\n    return 0\n"s + MakeLargeProgram(10),
+            // Повторное объявление класса в другой части программы
+            "class C5:\n  def f():\n    return 0\n"s + base,
+            base + "class Derived(Missing):\n  def f():\n    return 0\n"s,
+            MakeLargeProgram(300) + "print 1 +\n"s + MakeLargeProgram(700) + "z = Nowhere()\n"s,
+    };
+    for (const string& program : broken_programs) {
+        const string expected = error_of([&program] { ParseProgramFromString(program); });
+        ASSERT(expected != "no error"s);
+        ASSERT_EQUAL(error_of([&program] { ParseProgramParallel(program, 4); }), expected);
+    }
+}
+
 }  // namespace parse
 
 void TestParseProgram(TestRunner& tr) {
@@ -256,4 +939,20 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestRecursion2);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestLoops);
+    RUN_TEST(tr, parse::TestLists);
+    RUN_TEST(tr, parse::TestDicts);
+    RUN_TEST(tr, parse::TestFloats);
+    RUN_TEST(tr, parse::TestStringLiteralsAreShared);
+    RUN_TEST(tr, parse::TestBuiltins);
+    RUN_TEST(tr, parse::TestArrays);
+    RUN_TEST(tr, parse::TestGenerators);
+    RUN_TEST(tr, parse::TestTailCalls);
+    RUN_TEST(tr, parse::TestMemo);
+    RUN_TEST(tr, parse::TestBigIntegers);
+    RUN_TEST(tr, parse::TestGarbageCollection);
+    RUN_TEST(tr, parse::TestOperatorPrecedence);
+    RUN_TEST(tr, parse::TestDeeplyNestedExpression);
+    RUN_TEST(tr, parse::TestParallelParsing);
+    RUN_TEST(tr, parse::TestParallelParsingErrors);
 }
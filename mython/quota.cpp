@@ -0,0 +1,210 @@
+#include "quota.h"
+
+#include "refcount.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    namespace {
+        struct QuotaState {
+            std::atomic<size_t> limit{HeapQuota::UNLIMITED};
+            std::atomic<size_t> usage{0};
+            std::atomic<size_t> peak{0};
+            // HeapQuota удалён, и учёт освобождается вместе с последним списанным байтом
+            std::atomic<bool> orphaned{false};
+        };
+
+        // Учёт квот лежит в блоках, которые не перемещаются и не освобождаются, поэтому номер квоты,
+        // сохранённый в объекте, можно разыменовать без блокировки. Номера удалённых квот достаются новым
+        constexpr size_t STATES_PER_CHUNK = 256;
+        constexpr size_t MAX_CHUNKS = 4096;
+
+        std::array<std::atomic<QuotaState *>, MAX_CHUNKS> state_chunks;
+        std::mutex registry_mutex;
+        std::vector<QuotaId> free_ids;
+        QuotaId next_id = NO_QUOTA + 1;
+
+        QuotaState &State(QuotaId id) {
+            return state_chunks[id / STATES_PER_CHUNK].load(std::memory_order_acquire)[id % STATES_PER_CHUNK];
+        }
+
+        QuotaId RegisterQuota(size_t limit) {
+            std::lock_guard lock(registry_mutex);
+            QuotaId id;
+            if (!free_ids.empty()) {
+                id = free_ids.back();
+                free_ids.pop_back();
+            } else {
+                if (next_id == STATES_PER_CHUNK * MAX_CHUNKS) {
+                    throw std::runtime_error("Too many heap quotas"s);
+                }
+                id = next_id++;
+                if (state_chunks[id / STATES_PER_CHUNK].load(std::memory_order_relaxed) == nullptr) {
+                    state_chunks[id / STATES_PER_CHUNK].store(new QuotaState[STATES_PER_CHUNK], std::memory_order_release);
+                }
+            }
+            State(id).limit.store(limit, std::memory_order_relaxed);
+            return id;
+        }
+
+        // Вызывается под registry_mutex, когда квота удалена и ничего с неё не списано
+        void RecycleQuota(QuotaId id) {
+            QuotaState &state = State(id);
+            state.orphaned.store(false, std::memory_order_relaxed);
+            state.peak.store(0, std::memory_order_relaxed);
+            free_ids.push_back(id);
+        }
+
+        // С обычным счётчиком ссылок память квоты выделяет и освобождает один поток, и счётчикам достаточно
+        // атомарного чтения и записи, чтобы их можно было читать из другого. С атомарным — нужны атомарные сложения
+        size_t AddUsage(std::atomic<size_t> &usage, size_t bytes) {
+            if constexpr (ObjectReferenceCount::THREAD_SAFE) {
+                return usage.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            } else {
+                const size_t result = usage.load(std::memory_order_relaxed) + bytes;
+                usage.store(result, std::memory_order_relaxed);
+                return result;
+            }
+        }
+
+        size_t SubtractUsage(std::atomic<size_t> &usage, size_t bytes) {
+            if constexpr (ObjectReferenceCount::THREAD_SAFE) {
+                return usage.fetch_sub(bytes, std::memory_order_acq_rel) - bytes;
+            } else {
+                const size_t result = usage.load(std::memory_order_relaxed) - bytes;
+                usage.store(result, std::memory_order_relaxed);
+                return result;
+            }
+        }
+
+        void UpdatePeak(std::atomic<size_t> &peak, size_t usage) {
+            size_t current = peak.load(std::memory_order_relaxed);
+            while (current < usage && !peak.compare_exchange_weak(current, usage, std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    HeapQuota::HeapQuota(size_t limit)
+            : id_(RegisterQuota(limit)) {
+    }
+
+    HeapQuota::~HeapQuota() {
+        std::lock_guard lock(registry_mutex);
+        QuotaState &state = State(id_);
+        state.orphaned.store(true, std::memory_order_relaxed);
+        if (state.usage.load(std::memory_order_acquire) == 0) {
+            RecycleQuota(id_);
+        }
+    }
+
+    void HeapQuota::SetLimit(size_t limit) {
+        State(id_).limit.store(limit, std::memory_order_relaxed);
+    }
+
+    size_t HeapQuota::GetLimit() const {
+        return State(id_).limit.load(std::memory_order_relaxed);
+    }
+
+    size_t HeapQuota::GetUsage() const {
+        return State(id_).usage.load(std::memory_order_relaxed);
+    }
+
+    size_t HeapQuota::GetPeakUsage() const {
+        return State(id_).peak.load(std::memory_order_relaxed);
+    }
+
+    QuotaId HeapQuota::GetId() const {
+        return id_;
+    }
+
+    HeapQuotaScope::HeapQuotaScope(const HeapQuota &quota)
+            : previous_(std::exchange(quota_thread_state.current, quota.GetId())) {
+    }
+
+    HeapQuotaScope::~HeapQuotaScope() {
+        quota_thread_state.current = previous_;
+    }
+
+    void ChargeQuota(QuotaId quota, size_t bytes) {
+        if (quota == NO_QUOTA) {
+            return;
+        }
+        QuotaState &state = State(quota);
+        const size_t usage = AddUsage(state.usage, bytes);
+        const size_t limit = state.limit.load(std::memory_order_relaxed);
+        if (usage > limit) {
+            SubtractUsage(state.usage, bytes);
+            throw HeapQuotaExceeded("Heap limit of "s + std::to_string(limit) + " bytes exceeded"s);
+        }
+        UpdatePeak(state.peak, usage);
+    }
+
+    void ReleaseQuota(QuotaId quota, size_t bytes) noexcept {
+        if (quota == NO_QUOTA) {
+            return;
+        }
+        QuotaState &state = State(quota);
+        if (SubtractUsage(state.usage, bytes) == 0 && state.orphaned.load(std::memory_order_acquire)) {
+            std::lock_guard lock(registry_mutex);
+            if (state.orphaned.load(std::memory_order_relaxed) && state.usage.load(std::memory_order_relaxed) == 0) {
+                RecycleQuota(quota);
+            }
+        }
+    }
+
+    HeapCharge::HeapCharge(size_t bytes)
+            : quota_(CurrentQuota()), bytes_(bytes) {
+        ChargeQuota(quota_, bytes_);
+    }
+
+    HeapCharge::HeapCharge(HeapCharge &&other) noexcept
+            : quota_(std::exchange(other.quota_, NO_QUOTA)), bytes_(std::exchange(other.bytes_, 0)) {
+    }
+
+    HeapCharge &HeapCharge::operator=(HeapCharge &&other) noexcept {
+        if (this != &other) {
+            ReleaseQuota(quota_, bytes_);
+            quota_ = std::exchange(other.quota_, NO_QUOTA);
+            bytes_ = std::exchange(other.bytes_, 0);
+        }
+        return *this;
+    }
+
+    HeapCharge::~HeapCharge() {
+        ReleaseQuota(quota_, bytes_);
+    }
+
+    // Квоту забирает первый созданный подобъект QuotaCharged, лежащий в ожидающем блоке; объекты-поля,
+    // создаваемые после него, и объекты вне блока остаются без квоты
+    void QuotaCharged::ClaimPendingQuota() {
+        QuotaThreadState &state = quota_thread_state;
+        const char *address = reinterpret_cast<const char *>(this);
+        if (address >= state.pending_begin && address < state.pending_begin + state.pending_size) {
+            quota_ = state.pending_quota;
+            state.pending_begin = nullptr;
+        }
+    }
+
+    bool QuotaCharged::ReleaseDestroyedQuota(const void *block, size_t size) {
+        QuotaThreadState &state = quota_thread_state;
+        QuotaId quota = std::exchange(state.destroyed, NO_QUOTA);
+        if (state.pending_begin == block) {
+            quota = state.pending_quota;
+            state.pending_begin = nullptr;
+        }
+        if (quota == ARENA_QUOTA || quota == ARENA_TRIVIAL_QUOTA) {
+            return true;
+        }
+        ReleaseQuota(quota, size);
+        return false;
+    }
+
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace runtime {
+
+    // Квота памяти: сколько байт могут занимать объекты, строки, списки, словари, массивы и узлы AST,
+    // созданные, пока квота активна в потоке (HeapQuotaScope). Каждое списание помнит свою квоту и возвращается
+    // в неё при освобождении памяти, даже если память освобождается после выхода из HeapQuotaScope или другим
+    // интерпретатором. Если списание не помещается в лимит, бросается HeapQuotaExceeded, а память не выделяется.
+    // Квота может пережить свой HeapQuota: её учёт удаляется, когда освобождён последний списанный с неё байт
+    class HeapQuotaExceeded : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    using QuotaId = uint32_t;
+    // Память, выделенная вне HeapQuotaScope, ни с какой квоты не списывается
+    constexpr QuotaId NO_QUOTA = 0;
+    // Особые значения квоты объекта QuotaCharged: память объекта выделена в арене (arena.h), списана с квоты
+    // вместе с блоком арены и вернётся вместе с ним. Объекту с ARENA_TRIVIAL_QUOTA не нужен и деструктор
+    constexpr QuotaId ARENA_QUOTA = std::numeric_limits<QuotaId>::max();
+    constexpr QuotaId ARENA_TRIVIAL_QUOTA = ARENA_QUOTA - 1;
+
+    class ObjectArena;
+
+    class HeapQuota {
+    public:
+        static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+        explicit HeapQuota(size_t limit = UNLIMITED);
+        HeapQuota(const HeapQuota &) = delete;
+        HeapQuota &operator=(const HeapQuota &) = delete;
+        ~HeapQuota();
+
+        // Новый лимит не освобождает уже занятую память, но следующее списание сверх него не пройдёт
+        void SetLimit(size_t limit);
+        [[nodiscard]] size_t GetLimit() const;
+        // Счётчики можно читать из любого потока, пока квота используется
+        [[nodiscard]] size_t GetUsage() const;
+        [[nodiscard]] size_t GetPeakUsage() const;
+        [[nodiscard]] QuotaId GetId() const;
+    private:
+        QuotaId id_;
+    };
+
+    // Делает квоту текущей в потоке до своего удаления. Области вкладываются: удаление восстанавливает прежнюю
+    class HeapQuotaScope {
+    public:
+        explicit HeapQuotaScope(const HeapQuota &quota);
+        HeapQuotaScope(const HeapQuotaScope &) = delete;
+        HeapQuotaScope &operator=(const HeapQuotaScope &) = delete;
+        ~HeapQuotaScope();
+    private:
+        QuotaId previous_;
+    };
+
+    // Квоты потока. Состояние лежит в заголовке, чтобы без активной квоты создание и удаление объектов
+    // QuotaCharged обходились без вызовов функций
+    struct QuotaThreadState {
+        QuotaId current = NO_QUOTA;
+        // Блок, выделенный QuotaCharged::operator new, квоту которого ещё не забрал конструктор
+        const char *pending_begin = nullptr;
+        size_t pending_size = 0;
+        QuotaId pending_quota = NO_QUOTA;
+        // Квота объекта, деструктор которого только что выполнился: её читает operator delete
+        QuotaId destroyed = NO_QUOTA;
+        // Арена, из которой QuotaCharged::operator new берёт память, см. ArenaScope
+        ObjectArena *arena = nullptr;
+    };
+
+    inline thread_local QuotaThreadState quota_thread_state;
+
+    [[nodiscard]] inline QuotaId CurrentQuota() {
+        return quota_thread_state.current;
+    }
+
+    // Списывает bytes с квоты или бросает HeapQuotaExceeded. С NO_QUOTA ничего не делают
+    void ChargeQuota(QuotaId quota, size_t bytes);
+    void ReleaseQuota(QuotaId quota, size_t bytes) noexcept;
+
+    // Списание bytes с текущей квоты, которое возвращается в ту же квоту вместе с владельцем
+    class HeapCharge {
+    public:
+        HeapCharge() = default;
+        explicit HeapCharge(size_t bytes);
+        HeapCharge(HeapCharge &&other) noexcept;
+        HeapCharge &operator=(HeapCharge &&other) noexcept;
+        ~HeapCharge();
+    private:
+        QuotaId quota_ = NO_QUOTA;
+        size_t bytes_ = 0;
+    };
+
+    // Аллокатор контейнеров, который списывает их память с квоты, текущей при создании контейнера.
+    // Перемещённый или обменянный буфер уходит вместе со своим аллокатором и возвращается в ту же квоту
+    template<typename T>
+    class QuotaAllocator {
+    public:
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        QuotaAllocator()
+                : quota_(CurrentQuota()) {
+        }
+
+        template<typename U>
+        QuotaAllocator(const QuotaAllocator<U> &other)
+                : quota_(other.GetQuota()) {
+        }
+
+        // Копия контейнера списывается с квоты, текущей при копировании
+        [[nodiscard]] QuotaAllocator select_on_container_copy_construction() const {
+            return QuotaAllocator();
+        }
+
+        T *allocate(size_t count) {
+            ChargeQuota(quota_, count * sizeof(T));
+            try {
+                return std::allocator<T>().allocate(count);
+            } catch (...) {
+                ReleaseQuota(quota_, count * sizeof(T));
+                throw;
+            }
+        }
+
+        void deallocate(T *block, size_t count) {
+            std::allocator<T>().deallocate(block, count);
+            ReleaseQuota(quota_, count * sizeof(T));
+        }
+
+        [[nodiscard]] QuotaId GetQuota() const {
+            return quota_;
+        }
+    private:
+        QuotaId quota_;
+    };
+
+    template<typename T, typename U>
+    bool operator==(const QuotaAllocator<T> &lhs, const QuotaAllocator<U> &rhs) {
+        return lhs.GetQuota() == rhs.GetQuota();
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const QuotaAllocator<T> &lhs, const QuotaAllocator<U> &rhs) {
+        return !(lhs == rhs);
+    }
+
+    template<typename T>
+    using QuotaVector = std::vector<T, QuotaAllocator<T>>;
+
+    // Базовый класс объектов, память которых списывается с текущей квоты при создании выражением new.
+    // operator new списывает размер блока и оставляет квоту для конструктора, который запоминает её в объекте;
+    // деструктор передаёт её operator delete, которому известен размер блока. Объекты на стеке и внутри других
+    // объектов квоту не запоминают. Наследник со своим operator new выделяет память через AllocateCharged.
+    // Пока в потоке активна арена, память берётся из неё, а operator delete её не освобождает
+    class QuotaCharged {
+    public:
+        static void *operator new(size_t size) {
+            return AllocateCharged(size, static_cast<void *(*)(size_t)>(::operator new));
+        }
+
+        static void operator delete(void *block, size_t size) {
+            DeallocateCharged(block, size, static_cast<void (*)(void *, size_t)>(::operator delete));
+        }
+
+        [[nodiscard]] bool IsArenaAllocated() const {
+            return quota_ == ARENA_QUOTA || quota_ == ARENA_TRIVIAL_QUOTA;
+        }
+
+        // Истинно для объекта арены, которому нечего освобождать в деструкторе: ObjectHolder его не вызывает
+        [[nodiscard]] bool IsDestructorSkipped() const {
+            return quota_ == ARENA_TRIVIAL_QUOTA;
+        }
+    protected:
+        QuotaCharged() {
+            if (quota_thread_state.pending_begin != nullptr) {
+                ClaimPendingQuota();
+            }
+        }
+
+        QuotaCharged([[maybe_unused]] const QuotaCharged &other)
+                : QuotaCharged() {
+        }
+
+        QuotaCharged &operator=([[maybe_unused]] const QuotaCharged &other) {
+            return *this;
+        }
+
+        ~QuotaCharged() {
+            quota_thread_state.destroyed = quota_;
+        }
+
+        template<typename Allocate>
+        [[nodiscard]] static void *AllocateCharged(size_t size, Allocate allocate) {
+            if (quota_thread_state.arena != nullptr) {
+                return AllocateInArena(size);
+            }
+            const QuotaId quota = CurrentQuota();
+            if (quota == NO_QUOTA) {
+                return allocate(size);
+            }
+            ChargeQuota(quota, size);
+            void *block = nullptr;
+            try {
+                block = allocate(size);
+            } catch (...) {
+                ReleaseQuota(quota, size);
+                throw;
+            }
+            QuotaThreadState &state = quota_thread_state;
+            state.pending_begin = static_cast<const char *>(block);
+            state.pending_size = size;
+            state.pending_quota = quota;
+            return block;
+        }
+
+        template<typename Deallocate>
+        static void DeallocateCharged(void *block, size_t size, Deallocate deallocate) {
+            const QuotaThreadState &state = quota_thread_state;
+            if ((state.destroyed != NO_QUOTA || state.pending_begin == block) && ReleaseDestroyedQuota(block, size)) {
+                return;
+            }
+            deallocate(block, size);
+        }
+    private:
+        friend class ObjectHolder;
+
+        void ClaimPendingQuota();
+        // Возвращает в квоту блок удалённого объекта или блок, конструктор которого бросил исключение.
+        // Возвращает true для блока арены: его освобождать не нужно
+        static bool ReleaseDestroyedQuota(const void *block, size_t size);
+        [[nodiscard]] static void *AllocateInArena(size_t size);
+
+        // ObjectHolder::Make вызывает его у объекта, содержимое которого не требует деструктора
+        void MarkTrivialPayload() {
+            if (quota_ == ARENA_QUOTA) {
+                quota_ = ARENA_TRIVIAL_QUOTA;
+            }
+        }
+
+        QuotaId quota_ = NO_QUOTA;
+    };
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace runtime {
+
+    // Политики счётчика ссылок. Обычный счётчик не требует атомарных инструкций, но объектом может пользоваться
+    // только один поток: так работает интерпретатор, у которого программа и все её объекты живут в одном потоке.
+    // Атомарный счётчик позволяет передавать объекты между потоками ценой атомарной операции на каждую копию ссылки
+    struct PlainReferenceCount {
+        using Counter = uint32_t;
+        static constexpr bool THREAD_SAFE = false;
+
+        static void Increment(Counter &counter) {
+            ++counter;
+        }
+
+        // Возвращает true, если ссылка была последней
+        static bool Decrement(Counter &counter) {
+            return --counter == 0;
+        }
+
+        static uint32_t Load(const Counter &counter) {
+            return counter;
+        }
+    };
+
+    struct AtomicReferenceCount {
+        using Counter = std::atomic<uint32_t>;
+        static constexpr bool THREAD_SAFE = true;
+
+        static void Increment(Counter &counter) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Поток, удаливший последнюю ссылку, должен видеть все изменения объекта, сделанные другими потоками
+        static bool Decrement(Counter &counter) {
+            if (counter.fetch_sub(1, std::memory_order_release) == 1) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return true;
+            }
+            return false;
+        }
+
+        static uint32_t Load(const Counter &counter) {
+            return counter.load(std::memory_order_acquire);
+        }
+    };
+
+    // Счётчик ссылок внутри объекта. Его меняет только ObjectHolder, а копия объекта получает собственный
+    // нулевой счётчик: ссылки на оригинал её не касаются
+    template<typename Policy>
+    class ReferenceCounted {
+    public:
+        ReferenceCounted() = default;
+
+        ReferenceCounted([[maybe_unused]] const ReferenceCounted &other) {
+        }
+
+        ReferenceCounted &operator=([[maybe_unused]] const ReferenceCounted &other) {
+            return *this;
+        }
+
+        // Число владеющих ссылок ObjectHolder. У объекта, созданного не через ObjectHolder, оно равно нулю
+        [[nodiscard]] uint32_t GetReferenceCount() const {
+            return Policy::Load(references_);
+        }
+    protected:
+        ~ReferenceCounted() = default;
+    private:
+        friend class ObjectHolder;
+
+        void AddReference() const {
+            Policy::Increment(references_);
+        }
+
+        [[nodiscard]] bool RemoveReference() const {
+            return Policy::Decrement(references_);
+        }
+
+        mutable typename Policy::Counter references_{0};
+    };
+
+    // Политика счётчика выбирается при сборке: с макросом MYTHON_ATOMIC_REFCOUNT объекты можно передавать
+    // между потоками
+#ifdef MYTHON_ATOMIC_REFCOUNT
+    using ObjectReferenceCount = AtomicReferenceCount;
+#else
+    using ObjectReferenceCount = PlainReferenceCount;
+#endif
+
+}
@@ -1,9 +1,19 @@
 #include "runtime.h"
+#include "bigint.h"
+#include "gc.h"
+#include "heap.h"
 #include <cassert>
+#include <charconv>
+#include <cmath>
 #include <optional>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <limits>
+#include <string_view>
+#include <typeinfo>
+#include <utility>
 
 using namespace std::literals;
 
@@ -17,18 +27,36 @@ namespace runtime {
         const std::string TRUE = "True"s;
         const std::string FALSE = "False"s;
         const std::string NONE_LITERAL = "None"s;
+        const std::string APPEND_METHOD = "append"s;
+        const std::string POP_METHOD = "pop"s;
+        const std::string HASH_METHOD = "__hash__"s;
+
+        std::atomic<uint64_t> next_instance_id{0};
     }
 
-    ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
-            : data_(std::move(data)) {
+    ObjectHolder::ObjectHolder(Object *object, bool owning)
+            : object_(object), owning_(owning) {
+        if (owning_) {
+            object_->AddReference();
+        }
     }
 
     void ObjectHolder::AssertIsValid() const {
-        assert(data_ != nullptr);
+        assert(object_ != nullptr);
     }
 
     ObjectHolder ObjectHolder::Share(Object &object) {
-        return ObjectHolder(std::shared_ptr<Object>(&object, []([[maybe_unused]] auto *p) {  /*do nothing*/  }));
+        return ObjectHolder(&object, false);
+    }
+
+    ObjectHolder ObjectHolder::Acquire(Object &object) {
+        // Объект без владельцев (например, на стеке) удалился бы вместе с новой ссылкой
+        assert(object.GetReferenceCount() > 0);
+        return ObjectHolder(&object, true);
+    }
+
+    bool ObjectHolder::IsOwning() const {
+        return owning_;
     }
 
     ObjectHolder ObjectHolder::None() {
@@ -46,7 +74,11 @@ namespace runtime {
     }
 
     Object *ObjectHolder::Get() const {
-        return data_.get();
+        return object_;
+    }
+
+    bool ObjectHolder::IsUnique() const {
+        return owning_ && object_->GetReferenceCount() == 1;
     }
 
     ObjectHolder::operator bool() const {
@@ -58,9 +90,18 @@ namespace runtime {
         if ((ptr = object.TryAs<Bool>())) {
             return static_cast<Bool*>(ptr)->GetValue();
         } else if ((ptr = object.TryAs<Number>())) {
-            return static_cast<Number*>(ptr)->GetValue();
+            return static_cast<Number*>(ptr)->GetValue() != 0;
+        } else if ((ptr = object.TryAs<Float>())) {
+            return static_cast<Float*>(ptr)->GetValue() != 0;
         } else if ((ptr = object.TryAs<String>())) {
-            return !static_cast<String*>(ptr)->GetValue().empty();
+            return static_cast<String*>(ptr)->Size() > 0;
+        } else if ((ptr = object.TryAs<List>())) {
+            return static_cast<List*>(ptr)->Size() > 0;
+        } else if ((ptr = object.TryAs<Dict>())) {
+            return static_cast<Dict*>(ptr)->Size() > 0;
+        } else if (object.TryAs<BigInt>()) {
+            // BigInt лежит вне диапазона int64_t, поэтому никогда не равен нулю
+            return true;
         }
         return false;
     }
@@ -84,6 +125,10 @@ namespace runtime {
         }
     }
 
+    const Class &ClassInstance::GetClass() const {
+        return cls_;
+    }
+
     Closure &ClassInstance::Fields() {
         return fields_;
     }
@@ -93,7 +138,38 @@ namespace runtime {
     }
 
     ClassInstance::ClassInstance(const Class &cls)
-            : cls_(cls) {}
+            : cls_(cls), id_(next_instance_id.fetch_add(1, std::memory_order_relaxed)) {
+        fields_.reserve(cls.GetFieldCountHint());
+    }
+
+    ObjectHolder MakeInstance(const Class &cls) {
+        MaybeCollectGarbage();
+        return ObjectHolder::Make<ClassInstance>(cls);
+    }
+
+    void *ClassInstance::operator new(size_t size) {
+        return AllocateCharged(size, AllocateBlock);
+    }
+
+    void ClassInstance::operator delete(void *block, size_t size) {
+        DeallocateCharged(block, size, DeallocateBlock);
+    }
+
+    uint64_t ClassInstance::GetId() const {
+        return id_;
+    }
+
+    void ClassInstance::VisitReferences(ReferenceVisitor &visitor) const {
+        for (const auto &[name, value] : fields_) {
+            visitor.Visit(value);
+        }
+    }
+
+    void ClassInstance::ClearReferences() {
+        // Поля удаляются после того, как таблица объекта уже пуста: их деструкторы не видят её посередине очистки
+        Closure fields;
+        fields.swap(fields_);
+    }
 
     ObjectHolder ClassInstance::Call(const std::string &method,
                                      const std::vector<ObjectHolder> &actual_args,
@@ -105,12 +181,262 @@ namespace runtime {
         for (size_t i = 0; i < actual_args.size(); ++i) {
             fields[method_ptr->formal_params[i]] = actual_args[i];
         }
-        return method_ptr->body->Execute(fields, context);
+        if (method_ptr->memo == nullptr) {
+            return Execute(method_ptr, fields, context);
+        }
+
+        MemoCache &memo = *method_ptr->memo;
+        std::optional<MemoCache::Key> key = memo.MakeKey(id_, actual_args);
+        if (!key) {
+            return Execute(method_ptr, fields, context);
+        }
+        if (const ObjectHolder *result = memo.Find(*key)) {
+            return *result;
+        }
+        ObjectHolder result = Execute(method_ptr, fields, context);
+        memo.Insert(std::move(*key), result);
+        return result;
+    }
+
+    ObjectHolder ClassInstance::Execute(const Method *method_ptr, Closure &fields, Context &context) {
+        // Хвостовые вызовы выполняются в цикле: замыкание заполняется аргументами следующего метода,
+        // и его тело выполняется в этом же кадре. owner владеет объектом, метод которого выполняется,
+        // потому что переменная, через которую он был доступен, исчезает вместе со старым замыканием.
+        // Пока вызовы адресованы self, владелец не меняется: self в замыкании им не владеет
+        MethodExit &exit = PendingExit();
+        ClassInstance *instance = this;
+        ObjectHolder owner;
+        // Ключи вызовов методов с @memo, выполненных в этом кадре: результат последнего метода цепочки
+        // становится результатом каждого из них и сохраняется в их кэши, когда цепочка завершится
+        std::vector<std::pair<MemoCache *, MemoCache::Key>> memo_keys;
+        const auto finish = [&memo_keys](ObjectHolder result) {
+            for (auto &[memo, key] : memo_keys) {
+                memo->Insert(std::move(key), result);
+            }
+            return result;
+        };
+        while (true) {
+            ObjectHolder result;
+            try {
+                result = method_ptr->body->Execute(fields, context);
+            } catch (TailCall &call) {
+                exit.call = std::move(call);
+            }
+            if (exit.call.method == nullptr) {
+                if (owner) {
+                    if (auto generator = result.TryAs<Generator>()) {
+                        generator->KeepAlive(owner);
+                    }
+                }
+                return finish(std::move(result));
+            }
+
+            TailCall call = std::exchange(exit.call, {});
+            if (call.object.Get() != instance) {
+                owner = std::move(call.object);
+                instance = owner.TryAs<ClassInstance>();
+            }
+            method_ptr = instance->cls_.GetMethod(*call.method);
+            if (method_ptr->memo != nullptr) {
+                // Результат метода с @memo проходит через его кэш так же, как в Call, но тело выполняется
+                // в этом же кадре, поэтому глубина хвостовой рекурсии не ограничена и для таких методов
+                MemoCache &memo = *method_ptr->memo;
+                if (std::optional<MemoCache::Key> key = memo.MakeKey(instance->id_, call.args)) {
+                    if (const ObjectHolder *cached = memo.Find(*key)) {
+                        return finish(*cached);
+                    }
+                    memo_keys.emplace_back(&memo, std::move(*key));
+                }
+            }
+            fields.clear();
+            fields[SELF] = ObjectHolder::Share(*instance);
+            for (size_t i = 0; i < call.args.size(); ++i) {
+                fields[method_ptr->formal_params[i]] = std::move(call.args[i]);
+            }
+        }
+    }
+
+    MethodExit &PendingExit() {
+        thread_local MethodExit exit;
+        return exit;
+    }
+
+    Generator::Generator(GeneratorBody &body, Closure closure)
+            : body_(body), closure_(std::move(closure)) {}
+
+    std::optional<ObjectHolder> Generator::Next(Context &context) {
+        if (finished_) {
+            return std::nullopt;
+        }
+        if (running_) {
+            throw std::runtime_error("generator is already running"s);
+        }
+        running_ = true;
+        bool suspended = false;
+        try {
+            suspended = body_.Resume(state_, closure_, context);
+        } catch (...) {
+            running_ = false;
+            finished_ = true;
+            state_ = {};
+            throw;
+        }
+        running_ = false;
+        if (!suspended) {
+            // Завершённый генератор больше не держит локальные переменные метода
+            finished_ = true;
+            state_ = {};
+            closure_.clear();
+            return std::nullopt;
+        }
+        return std::move(state_.value);
+    }
+
+    void Generator::KeepAlive(ObjectHolder owner) {
+        // Первым владельца назначает ClassInstance::Call, если генератор вернул хвостовой вызов
+        // другого объекта: вызывающий узел знает только исходный объект
+        if (!owner_) {
+            owner_ = std::move(owner);
+        }
+    }
+
+    void Generator::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+        os << "<generator "sv << this << '>';
+    }
+
+    void Generator::VisitReferences(ReferenceVisitor &visitor) const {
+        visitor.Visit(owner_);
+        for (const auto &[name, value] : closure_) {
+            visitor.Visit(value);
+        }
+        for (const SuspendedFrame &frame : state_.frames) {
+            visitor.Visit(frame.iterable);
+        }
+        visitor.Visit(state_.value);
+    }
+
+    void Generator::ClearReferences() {
+        ObjectHolder owner = std::move(owner_);
+        Closure closure;
+        closure.swap(closure_);
+        GeneratorState state = std::move(state_);
+        state_ = {};
+        finished_ = true;
     }
 
     Class::Class(std::string name, std::vector<Method> methods, const Class *parent)
             : name_(std::move(name)), methods_(std::move(methods)), parent_(parent) {}
 
+    void Class::Define(std::vector<Method> methods, const Class *parent) {
+        methods_ = std::move(methods);
+        parent_ = parent;
+    }
+
+    MemoCache::MemoCache(size_t capacity)
+            : capacity_(capacity) {}
+
+    std::optional<MemoCache::Key> MemoCache::MakeKey(uint64_t receiver, const std::vector<ObjectHolder> &args) {
+        size_t hash = std::hash<uint64_t>{}(receiver);
+        for (const ObjectHolder &arg : args) {
+            size_t arg_hash = 0;
+            if (!arg) {
+                arg_hash = 0x9e3779b9;
+            } else if (auto number = arg.TryAs<Number>()) {
+                arg_hash = std::hash<int64_t>{}(number->GetValue());
+            } else if (auto boolean = arg.TryAs<Bool>()) {
+                arg_hash = boolean->GetValue() ? 0x51 : 0x50;
+            } else if (auto str = arg.TryAs<String>()) {
+                arg_hash = str->Hash();
+            } else {
+                ++stats_.bypasses;
+                return std::nullopt;
+            }
+            hash = hash * 31 + arg_hash;
+        }
+        return Key{receiver, args, hash};
+    }
+
+    const ObjectHolder *MemoCache::Find(const Key &key) {
+        auto it = index_.find(&key);
+        if (it == index_.end()) {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    void MemoCache::Insert(Key key, ObjectHolder result) {
+        if (capacity_ == 0) {
+            return;
+        }
+        // Рекурсивный вызов мог сохранить результат для того же ключа раньше
+        if (auto it = index_.find(&key); it != index_.end()) {
+            it->second->second = std::move(result);
+            return;
+        }
+        if (entries_.size() == capacity_) {
+            index_.erase(&entries_.back().first);
+            entries_.pop_back();
+            ++stats_.evictions;
+        }
+        entries_.emplace_front(std::move(key), std::move(result));
+        index_.emplace(&entries_.front().first, entries_.begin());
+    }
+
+    void MemoCache::Clear() {
+        index_.clear();
+        entries_.clear();
+    }
+
+    const MemoCache::Stats &MemoCache::GetStats() const {
+        return stats_;
+    }
+
+    size_t MemoCache::Size() const {
+        return entries_.size();
+    }
+
+    size_t MemoCache::Capacity() const {
+        return capacity_;
+    }
+
+    size_t MemoCache::KeyHash::operator()(const Key *key) const {
+        return key->hash;
+    }
+
+    bool MemoCache::KeyEqual::operator()(const Key *lhs, const Key *rhs) const {
+        if (lhs->receiver != rhs->receiver || lhs->hash != rhs->hash || lhs->args.size() != rhs->args.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < lhs->args.size(); ++i) {
+            const ObjectHolder &a = lhs->args[i];
+            const ObjectHolder &b = rhs->args[i];
+            if (!a || !b) {
+                if (a || b) {
+                    return false;
+                }
+            } else if (auto number = a.TryAs<Number>()) {
+                auto other = b.TryAs<Number>();
+                if (other == nullptr || other->GetValue() != number->GetValue()) {
+                    return false;
+                }
+            } else if (auto boolean = a.TryAs<Bool>()) {
+                auto other = b.TryAs<Bool>();
+                if (other == nullptr || other->GetValue() != boolean->GetValue()) {
+                    return false;
+                }
+            } else {
+                auto other = b.TryAs<String>();
+                if (other == nullptr || other->GetValue() != a.TryAs<String>()->GetValue()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
     const Method *Class::GetMethod(const std::string &name) const {
         auto method_iter = std::find_if(methods_.begin(), methods_.end(), [&name](const Method& method) {
             return method.name == name;
@@ -127,6 +453,23 @@ namespace runtime {
         return name_;
     }
 
+    size_t Class::GetFieldCountHint() const {
+        return field_count_hint_;
+    }
+
+    void Class::UpdateFieldCountHint(size_t field_count) const {
+        // Подсказка не растёт без предела из-за одного объекта, которому добавили много полей
+        constexpr size_t MAX_FIELD_COUNT_HINT = 64;
+        field_count_hint_ = std::max(field_count_hint_, std::min(field_count, MAX_FIELD_COUNT_HINT));
+    }
+
+    bool Class::IsSubclassOf(const Class &cls) const {
+        for (const Class *current = this; current != nullptr; current = current->parent_) {
+            if (current == &cls) return true;
+        }
+        return false;
+    }
+
     void Class::Print(std::ostream &os, [[maybe_unused]] Context &context) {
         os << "Class "s << name_;
     }
@@ -135,15 +478,608 @@ namespace runtime {
         os << (GetValue() ? TRUE : FALSE);
     }
 
+    void Float::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+        char buffer[32];
+        const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), GetValue());
+        const std::string_view text(buffer, end - buffer);
+        os << text;
+        // Как и в Python, целое значение выводится с дробной частью: 2.0, а не 2
+        if (text.find_first_of(".eni"sv) == std::string_view::npos) {
+            os << ".0"sv;
+        }
+    }
+
+    std::optional<Numeric> AsNumeric(const ObjectHolder &object) {
+        const Object *ptr = object.Get();
+        if (ptr == nullptr) {
+            return std::nullopt;
+        }
+        // У Number и Float нет наследников, поэтому вместо dynamic_cast достаточно сравнить typeid
+        const std::type_info &type = typeid(*ptr);
+        if (type == typeid(Number)) {
+            return Numeric{false, static_cast<const Number *>(ptr)->GetValue(), 0};
+        }
+        if (type == typeid(Float)) {
+            return Numeric{true, 0, static_cast<const Float *>(ptr)->GetValue()};
+        }
+        return std::nullopt;
+    }
+
+    namespace {
+        // Сравнивает целое с вещественным точно: целые больше 2^53 при переводе в double округлились бы
+        std::optional<int> CompareIntWithDouble(int64_t lhs, double rhs) {
+            if (std::isnan(rhs)) {
+                return std::nullopt;
+            }
+            if (rhs >= 0x1p63) {
+                return -1;
+            }
+            if (rhs < -0x1p63) {
+                return 1;
+            }
+            // Целая часть rhs помещается в int64_t, и при равенстве целых частей всё решает дробная
+            const double whole = std::trunc(rhs);
+            const auto whole_value = static_cast<int64_t>(whole);
+            if (lhs != whole_value) {
+                return lhs < whole_value ? -1 : 1;
+            }
+            return whole < rhs ? -1 : (whole > rhs ? 1 : 0);
+        }
+    }
+
+    std::optional<int> CompareNumeric(const Numeric &lhs, const Numeric &rhs) {
+        if (!lhs.is_float && !rhs.is_float) {
+            return lhs.int_value < rhs.int_value ? -1 : (lhs.int_value > rhs.int_value ? 1 : 0);
+        }
+        if (!lhs.is_float) {
+            return CompareIntWithDouble(lhs.int_value, rhs.float_value);
+        }
+        if (!rhs.is_float) {
+            const std::optional<int> order = CompareIntWithDouble(rhs.int_value, lhs.float_value);
+            return order ? std::optional<int>(-*order) : std::nullopt;
+        }
+        if (std::isnan(lhs.float_value) || std::isnan(rhs.float_value)) {
+            return std::nullopt;
+        }
+        return lhs.float_value < rhs.float_value ? -1 : (lhs.float_value > rhs.float_value ? 1 : 0);
+    }
+
+    ObjectHolder TemporaryValue::ToObject() && {
+        if (!number_) {
+            return std::move(object_);
+        }
+        if (number_->is_float) {
+            return ObjectHolder::Own(Float(number_->float_value));
+        }
+        return ObjectHolder::Own(Number(number_->int_value));
+    }
+
+    TemporaryValue Executable::Evaluate(Closure &closure, Context &context) {
+        return Execute(closure, context);
+    }
+
+    bool Executable::EvaluateCondition(Closure &closure, Context &context) {
+        return IsTrue(Execute(closure, context));
+    }
+
+    namespace {
+        // Контейнеры, которые этот поток сейчас выводит, и пары контейнеров, которые сейчас сравнивает.
+        // append может положить список в него самого, и без этого учёта вывод и сравнение такого списка
+        // не закончились бы. Вложенность обычно невелика, поэтому хватает линейного поиска
+        std::vector<const Object *> &ContainersInPrint() {
+            thread_local std::vector<const Object *> containers;
+            return containers;
+        }
+
+        std::vector<std::pair<const Object *, const Object *>> &ContainersInComparison() {
+            thread_local std::vector<std::pair<const Object *, const Object *>> containers;
+            return containers;
+        }
+
+        // Держит элемент в стеке на время вывода или сравнения, в том числе при исключении
+        template<typename T>
+        class InProgress {
+        public:
+            InProgress(std::vector<T> &stack, T item)
+                    : stack_(stack) {
+                stack_.push_back(item);
+            }
+
+            InProgress(const InProgress &) = delete;
+            InProgress &operator=(const InProgress &) = delete;
+
+            ~InProgress() {
+                stack_.pop_back();
+            }
+        private:
+            std::vector<T> &stack_;
+        };
+
+        // Истинно, если контейнер уже выводится: повторная встреча выводится как [...] или {...}, как в Python
+        bool IsInPrint(const Object *container) {
+            const auto &containers = ContainersInPrint();
+            return std::find(containers.begin(), containers.end(), container) != containers.end();
+        }
+
+        // Выводит элемент контейнера; строки внутри контейнеров выводятся в кавычках, как это делает Python
+        void PrintElement(std::ostream &os, const ObjectHolder &object, Context &context) {
+            if (!object) {
+                os << NONE_LITERAL;
+            } else if (auto str = object.TryAs<String>()) {
+                os << '\'' << str->GetValue() << '\'';
+            } else {
+                object->Print(os, context);
+            }
+        }
+
+        // Элементы разных встроенных типов просто не равны, а не вызывают ошибку сравнения.
+        // Исключения — целые и вещественные числа, сравниваемые по значению, и объекты классов с методом __eq__
+        bool ElementsEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
+            if (!lhs || !rhs) {
+                return !lhs && !rhs;
+            }
+            if ((AsNumeric(lhs) || lhs.TryAs<BigInt>()) && (AsNumeric(rhs) || rhs.TryAs<BigInt>())) {
+                return Equal(lhs, rhs, context);
+            }
+            if (!(lhs.TryAs<ClassInstance>() && rhs.TryAs<ClassInstance>()) && typeid(*lhs) != typeid(*rhs)) {
+                return false;
+            }
+            return Equal(lhs, rhs, context);
+        }
+
+        // std::hash для чисел в libstdc++ возвращает само число, а таблице нужны перемешанные старшие и младшие биты
+        size_t MixHash(size_t hash) {
+            uint64_t x = hash;
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            return static_cast<size_t>(x);
+        }
+
+        uint8_t HashTag(size_t hash) {
+            return static_cast<uint8_t>(hash & 0x7F);
+        }
+
+        class ReferenceCollector : public ReferenceVisitor {
+        public:
+            explicit ReferenceCollector(std::vector<ObjectHolder> &references)
+                    : references_(references) {
+            }
+
+            void Visit(const ObjectHolder &reference) override {
+                if (reference) {
+                    references_.push_back(reference);
+                }
+            }
+        private:
+            std::vector<ObjectHolder> &references_;
+        };
+
+        // Освобождает элементы контейнера без рекурсии, как String::ReleaseChildren: вложенные списки
+        // и словари, которыми больше никто не владеет, отдают свои элементы в общий стек до того,
+        // как будут удалены, поэтому глубина вложенности не ограничена размером стека
+        void ReleaseElements(Traced &container) {
+            std::vector<ObjectHolder> pending;
+            ReferenceCollector collector(pending);
+            container.VisitReferences(collector);
+            container.ClearReferences();
+            while (!pending.empty()) {
+                ObjectHolder node = std::move(pending.back());
+                pending.pop_back();
+                if (!node.IsUnique()) {
+                    continue;
+                }
+                Traced *nested = node.TryAs<List>();
+                if (nested == nullptr) {
+                    nested = node.TryAs<Dict>();
+                }
+                if (nested != nullptr) {
+                    nested->VisitReferences(collector);
+                    nested->ClearReferences();
+                }
+            }
+        }
+    }
+
+    List::List(std::vector<ObjectHolder> items)
+            : items_(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end())) {}
+
+    void List::Print(std::ostream &os, Context &context) {
+        if (IsInPrint(this)) {
+            os << "[...]"sv;
+            return;
+        }
+        const InProgress<const Object *> in_print(ContainersInPrint(), this);
+        os << '[';
+        for (size_t i = 0; i < items_.size(); ++i) {
+            if (i > 0) os << ", "sv;
+            PrintElement(os, items_[i], context);
+        }
+        os << ']';
+    }
+
+    ObjectHolder List::Call(const std::string &method, const std::vector<ObjectHolder> &actual_args,
+                            [[maybe_unused]] Context &context) {
+        if (method == APPEND_METHOD && actual_args.size() == 1) {
+            Append(actual_args.front());
+            return {};
+        }
+        if (method == POP_METHOD && actual_args.empty()) {
+            return Pop();
+        }
+        throw std::runtime_error("list has no method "s + method + " with "s + std::to_string(actual_args.size())
+                                 + " arguments"s);
+    }
+
+    size_t List::Size() const {
+        return items_.size();
+    }
+
+    size_t List::CheckIndex(int64_t index) const {
+        const auto size = static_cast<int64_t>(items_.size());
+        const int64_t position = index < 0 ? size + index : index;
+        if (position < 0 || position >= size) {
+            throw std::runtime_error("list index out of range"s);
+        }
+        return static_cast<size_t>(position);
+    }
+
+    ObjectHolder &List::At(int64_t index) {
+        return items_[CheckIndex(index)];
+    }
+
+    const ObjectHolder &List::At(int64_t index) const {
+        return items_[CheckIndex(index)];
+    }
+
+    void List::Append(ObjectHolder value) {
+        items_.push_back(std::move(value));
+    }
+
+    ObjectHolder List::Pop() {
+        if (items_.empty()) {
+            throw std::runtime_error("pop from empty list"s);
+        }
+        ObjectHolder result = std::move(items_.back());
+        items_.pop_back();
+        return result;
+    }
+
+    List::~List() {
+        if (!items_.empty()) {
+            ReleaseElements(*this);
+        }
+    }
+
+    void List::VisitReferences(ReferenceVisitor &visitor) const {
+        for (const ObjectHolder &item : items_) {
+            visitor.Visit(item);
+        }
+    }
+
+    void List::ClearReferences() {
+        decltype(items_) items;
+        items.swap(items_);
+    }
+
+    StringBuffer::StringBuffer(std::string value) {
+        if (value.size() <= INLINE_CAPACITY) {
+            std::copy(value.begin(), value.end(), inline_.begin());
+            inline_size_ = static_cast<uint8_t>(value.size());
+        } else {
+            // Символы списываются с квоты один раз на общий буфер, а не на каждую строку, которая его разделяет
+            struct ChargedString {
+                std::string value;
+                HeapCharge charge;
+            };
+            const size_t capacity = value.capacity();
+            auto block = std::make_shared<ChargedString>(ChargedString{std::move(value), HeapCharge(capacity)});
+            shared_ = std::shared_ptr<const std::string>(block, &block->value);
+        }
+    }
+
+    StringBuffer::StringBuffer(std::shared_ptr<const std::string> value)
+            : shared_(std::move(value)) {}
+
+    String::String(std::shared_ptr<const std::string> value)
+            : size_(value->size()) {
+        value_ = StringBuffer(std::move(value));
+    }
+
+    String::String(std::string value)
+            : size_(value.size()) {
+        value_ = StringBuffer(std::move(value));
+    }
+
+    String::String(ObjectHolder lhs, ObjectHolder rhs, size_t size)
+            : left_(std::move(lhs)), right_(std::move(rhs)), size_(size) {}
+
+    String::~String() {
+        ReleaseChildren();
+    }
+
+    ObjectHolder String::Concat(const ObjectHolder &lhs, const ObjectHolder &rhs) {
+        const String &lhs_string = *lhs.TryAs<String>();
+        const String &rhs_string = *rhs.TryAs<String>();
+        const size_t size = lhs_string.size_ + rhs_string.size_;
+        if (size < MIN_ROPE_SIZE) {
+            std::string value;
+            value.reserve(size);
+            value.append(lhs_string.GetValue()).append(rhs_string.GetValue());
+            return ObjectHolder::Own(String(std::move(value)));
+        }
+        return ObjectHolder::Own(String(lhs, rhs, size));
+    }
+
+    void String::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+        os << GetValue();
+    }
+
+    std::string_view String::GetValue() const {
+        if (left_) {
+            Flatten();
+        }
+        return value_.View();
+    }
+
+    size_t String::Size() const {
+        return size_;
+    }
+
+    // Обходит дерево без рекурсии: после цепочки из сотен тысяч сложений его глубина
+    // сравнима с числом слагаемых
+    void String::Flatten() const {
+        std::string result;
+        result.reserve(size_);
+        std::vector<const String *> pending{this};
+        while (!pending.empty()) {
+            const String *node = pending.back();
+            pending.pop_back();
+            if (node->left_) {
+                pending.push_back(node->right_.TryAs<String>());
+                pending.push_back(node->left_.TryAs<String>());
+            } else {
+                result += node->value_.View();
+            }
+        }
+        value_ = StringBuffer(std::move(result));
+        ReleaseChildren();
+    }
+
+    // Освобождает поддерево без рекурсии: слагаемые, которыми больше никто не владеет,
+    // отдают своих потомков в общий стек до того, как будут удалены
+    void String::ReleaseChildren() const {
+        if (!left_) {
+            return;
+        }
+        std::vector<ObjectHolder> pending;
+        pending.push_back(std::move(left_));
+        pending.push_back(std::move(right_));
+        left_ = {};
+        right_ = {};
+        while (!pending.empty()) {
+            ObjectHolder node = std::move(pending.back());
+            pending.pop_back();
+            if (node.IsUnique()) {
+                const String *str = node.TryAs<String>();
+                if (str->left_) {
+                    pending.push_back(std::move(str->left_));
+                    pending.push_back(std::move(str->right_));
+                    str->left_ = {};
+                    str->right_ = {};
+                }
+            }
+        }
+    }
+
+    size_t String::Hash() const {
+        if (!hash_computed_) {
+            hash_ = std::hash<std::string_view>{}(GetValue());
+            hash_computed_ = true;
+        }
+        return hash_;
+    }
+
+    size_t Hash(const ObjectHolder &object, Context &context) {
+        if (!object) {
+            return 0;
+        } else if (auto str = object.TryAs<String>()) {
+            return str->Hash();
+        } else if (auto number = object.TryAs<Number>()) {
+            return std::hash<int64_t>{}(number->GetValue());
+        } else if (auto big = object.TryAs<BigInt>()) {
+            return big->Hash();
+        } else if (auto real = object.TryAs<Float>()) {
+            // Равные целое и вещественное числа должны попадать в один ключ словаря.
+            // Правая граница исключена: 2^63 уже не помещается в int64_t
+            const double value = real->GetValue();
+            if (value >= -0x1p63 && value < 0x1p63 && value == static_cast<double>(static_cast<int64_t>(value))) {
+                return std::hash<int64_t>{}(static_cast<int64_t>(value));
+            }
+            return std::hash<double>{}(value);
+        } else if (auto boolean = object.TryAs<Bool>()) {
+            return std::hash<bool>{}(boolean->GetValue());
+        } else if (auto instance = object.TryAs<ClassInstance>(); instance && instance->HasMethod(HASH_METHOD, 0)) {
+            ObjectHolder result = instance->Call(HASH_METHOD, {}, context);
+            if (auto number = result.TryAs<Number>()) {
+                return std::hash<int64_t>{}(number->GetValue());
+            }
+            throw std::runtime_error("__hash__ must return a number"s);
+        }
+        throw std::runtime_error("unhashable dict key"s);
+    }
+
+    void Dict::Print(std::ostream &os, Context &context) {
+        if (IsInPrint(this)) {
+            os << "{...}"sv;
+            return;
+        }
+        const InProgress<const Object *> in_print(ContainersInPrint(), this);
+        os << '{';
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (i > 0) os << ", "sv;
+            PrintElement(os, entries_[i].key, context);
+            os << ": "sv;
+            PrintElement(os, entries_[i].value, context);
+        }
+        os << '}';
+    }
+
+    Dict::~Dict() {
+        if (!entries_.empty()) {
+            ReleaseElements(*this);
+        }
+    }
+
+    void Dict::VisitReferences(ReferenceVisitor &visitor) const {
+        for (const Entry &entry : entries_) {
+            visitor.Visit(entry.key);
+            visitor.Visit(entry.value);
+        }
+    }
+
+    void Dict::ClearReferences() {
+        decltype(entries_) entries;
+        entries.swap(entries_);
+        control_.clear();
+        indices_.clear();
+        ++version_;
+    }
+
+    size_t Dict::Size() const {
+        return entries_.size();
+    }
+
+    size_t Dict::FindSlot(size_t hash, const ObjectHolder &key, Context &context) const {
+        const uint8_t tag = HashTag(hash);
+        // __eq__ может добавить ключи в этот же словарь и перестроить таблицу. Тогда найденная ячейка
+        // устаревает, и поиск начинается заново по новой таблице
+        for (size_t version = version_;; version = version_) {
+            const size_t mask = control_.size() - 1;
+            for (size_t slot = (hash >> 7) & mask;; slot = (slot + 1) & mask) {
+                const uint8_t control = control_[slot];
+                if (control == EMPTY_SLOT) {
+                    return slot;
+                }
+                // Ключ сравнивается, только если совпали семь бит из управляющего байта и полный хеш
+                if (control != tag || entries_[indices_[slot]].hash != hash) {
+                    continue;
+                }
+                // Копия держит ключ, даже если entries_ переместится во время сравнения
+                const ObjectHolder entry_key = entries_[indices_[slot]].key;
+                const bool equal = ElementsEqual(entry_key, key, context);
+                if (version_ != version) {
+                    break;
+                }
+                if (equal) {
+                    return slot;
+                }
+            }
+        }
+    }
+
+    void Dict::Rehash(size_t capacity) {
+        ++version_;
+        control_.assign(capacity, EMPTY_SLOT);
+        indices_.assign(capacity, 0);
+        const size_t mask = capacity - 1;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            size_t slot = (entries_[i].hash >> 7) & mask;
+            while (control_[slot] != EMPTY_SLOT) {
+                slot = (slot + 1) & mask;
+            }
+            control_[slot] = HashTag(entries_[i].hash);
+            indices_[slot] = static_cast<uint32_t>(i);
+        }
+    }
+
+    ObjectHolder *Dict::Find(const ObjectHolder &key, Context &context) {
+        const size_t hash = MixHash(Hash(key, context));
+        if (entries_.empty()) {
+            return nullptr;
+        }
+        const size_t slot = FindSlot(hash, key, context);
+        return control_[slot] == EMPTY_SLOT ? nullptr : &entries_[indices_[slot]].value;
+    }
+
+    ObjectHolder &Dict::At(const ObjectHolder &key, Context &context) {
+        if (ObjectHolder *value = Find(key, context)) {
+            return *value;
+        }
+        std::ostringstream key_text;
+        PrintElement(key_text, key, context);
+        throw std::runtime_error("key not found in dict: "s + key_text.str());
+    }
+
+    void Dict::Set(const ObjectHolder &key, ObjectHolder value, Context &context) {
+        const size_t hash = MixHash(Hash(key, context));
+        for (;;) {
+            // Таблица заполняется не больше чем на 7/8, чтобы цепочки проб оставались короткими
+            if ((entries_.size() + 1) * 8 > control_.size() * 7) {
+                Rehash(std::max(MIN_CAPACITY, control_.size() * 2));
+            }
+            const size_t version = version_;
+            const size_t slot = FindSlot(hash, key, context);
+            // Если __eq__ добавил ключи, заполненность таблицы проверяется заново
+            if (version_ != version) {
+                continue;
+            }
+            if (control_[slot] != EMPTY_SLOT) {
+                entries_[indices_[slot]].value = std::move(value);
+                return;
+            }
+            ++version_;
+            control_[slot] = HashTag(hash);
+            indices_[slot] = static_cast<uint32_t>(entries_.size());
+            entries_.push_back({hash, key, std::move(value)});
+            return;
+        }
+    }
+
+    const ObjectHolder &Dict::KeyAt(size_t index) const {
+        return entries_.at(index).key;
+    }
+
+    const ObjectHolder &Dict::ValueAt(size_t index) const {
+        return entries_.at(index).value;
+    }
+
+    bool Contains(const ObjectHolder &item, const ObjectHolder &container, Context &context) {
+        if (auto dict = container.TryAs<Dict>()) {
+            return dict->Find(item, context) != nullptr;
+        }
+        if (auto list = container.TryAs<List>()) {
+            for (size_t i = 0; i < list->Size(); ++i) {
+                if (ElementsEqual(list->At(static_cast<int64_t>(i)), item, context)) return true;
+            }
+            return false;
+        }
+        if (container.TryAs<String>() && item.TryAs<String>()) {
+            return container.TryAs<String>()->GetValue().find(item.TryAs<String>()->GetValue()) != std::string::npos;
+        }
+        throw std::runtime_error("argument of 'in' is not a container"s);
+    }
+
     template <typename Comparator>
     bool CompareValues(const ObjectHolder &lhs,
                        const ObjectHolder &rhs,
                        Context &context,
                        Comparator comparator,
                        const std::string& method_name) {
-        if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-            return comparator(lhs.TryAs<Number>()->GetValue(), rhs.TryAs<Number>()->GetValue());
-        } else if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
+        if (const std::optional<Numeric> lhs_number = AsNumeric(lhs)) {
+            if (const std::optional<Numeric> rhs_number = AsNumeric(rhs)) {
+                if (!lhs_number->is_float && !rhs_number->is_float) {
+                    return comparator(lhs_number->int_value, rhs_number->int_value);
+                }
+                // Без порядка (NaN) ложны все сравнения, как и у самих double
+                const std::optional<int> order = CompareNumeric(*lhs_number, *rhs_number);
+                return order ? comparator(*order, 0) : false;
+            }
+        }
+        if (const std::optional<int> order = CompareBigInt(lhs, rhs)) {
+            return comparator(*order, 0);
+        }
+        if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
             return comparator(lhs.TryAs<String>()->GetValue(), rhs.TryAs<String>()->GetValue());
         } else if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
             return comparator(lhs.TryAs<Bool>()->GetValue(), rhs.TryAs<Bool>()->GetValue());
@@ -155,8 +1091,43 @@ namespace runtime {
         throw std::runtime_error("Cannot compare objects for equality"s);
     }
 
+    namespace {
+        bool ListsEqual(const List &lhs, const List &rhs, Context &context) {
+            if (lhs.Size() != rhs.Size()) return false;
+            for (size_t i = 0; i < lhs.Size(); ++i) {
+                const auto index = static_cast<int64_t>(i);
+                if (!ElementsEqual(lhs.At(index), rhs.At(index), context)) return false;
+            }
+            return true;
+        }
+
+        bool DictsEqual(const Dict &lhs, Dict &rhs, Context &context) {
+            if (lhs.Size() != rhs.Size()) return false;
+            for (size_t i = 0; i < lhs.Size(); ++i) {
+                const ObjectHolder *value = rhs.Find(lhs.KeyAt(i), context);
+                if (value == nullptr || !ElementsEqual(lhs.ValueAt(i), *value, context)) return false;
+            }
+            return true;
+        }
+    }
+
     bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
         if (!lhs && !rhs) return true;
+        const auto *lhs_list = lhs.TryAs<List>();
+        const auto *rhs_list = rhs.TryAs<List>();
+        const auto *lhs_dict = lhs.TryAs<Dict>();
+        auto *rhs_dict = rhs.TryAs<Dict>();
+        if ((lhs_list && rhs_list) || (lhs_dict && rhs_dict)) {
+            // Пара, которая уже сравнивается выше по стеку, различий сама по себе не даёт: списки, содержащие
+            // сами себя, равны, если равны остальные их элементы
+            auto &in_comparison = ContainersInComparison();
+            const std::pair<const Object *, const Object *> pair{lhs.Get(), rhs.Get()};
+            if (std::find(in_comparison.begin(), in_comparison.end(), pair) != in_comparison.end()) {
+                return true;
+            }
+            const InProgress<std::pair<const Object *, const Object *>> comparing(in_comparison, pair);
+            return lhs_list ? ListsEqual(*lhs_list, *rhs_list, context) : DictsEqual(*lhs_dict, *rhs_dict, context);
+        }
         return CompareValues(lhs, rhs, context, std::equal_to<>(), EQUAL_METHOD);
     }
 
@@ -169,7 +1140,12 @@ namespace runtime {
     }
 
     bool Greater(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
-        return !Less(lhs, rhs, context) && !Equal(lhs, rhs, context);
+        // У классов есть только __lt__ и __eq__, и > выражается через них. Остальные значения сравниваются
+        // напрямую: для NaN неверны и <, и ==, но > от этого верным не становится
+        if (lhs.TryAs<ClassInstance>() && rhs.TryAs<ClassInstance>()) {
+            return !Less(lhs, rhs, context) && !Equal(lhs, rhs, context);
+        }
+        return CompareValues(lhs, rhs, context, std::greater<>(), LESS_METHOD);
     }
 
     bool LessOrEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
@@ -177,7 +1153,10 @@ namespace runtime {
     }
 
     bool GreaterOrEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
-        return !Less(lhs, rhs, context);
+        if (lhs.TryAs<ClassInstance>() && rhs.TryAs<ClassInstance>()) {
+            return !Less(lhs, rhs, context);
+        }
+        return CompareValues(lhs, rhs, context, std::greater_equal<>(), LESS_METHOD);
     }
 
 }
\ No newline at end of file
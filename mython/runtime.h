@@ -1,9 +1,19 @@
 #pragma once
 
+#include "quota.h"
+#include "refcount.h"
+
+#include <cstdint>
+#include <array>
+#include <list>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace runtime {
@@ -15,23 +25,75 @@ namespace runtime {
         ~Context() = default;
     };
 
-    class Object {
+    class Object : public ReferenceCounted<ObjectReferenceCount>, public QuotaCharged {
     public:
         virtual ~Object() = default;
         virtual void Print(std::ostream &os, Context &context) = 0;
     };
 
+    // Истинно для классов, деструктор которых ничего не освобождает: их объектам в арене (arena.h)
+    // деструктор не вызывается
+    template<typename T>
+    struct HasTrivialPayload : std::false_type {
+    };
+
+    // Ссылка на объект. Владеющие ссылки ведут счётчик ссылок внутри объекта и удаляют объект вместе с последней
+    // из них; невладеющие, созданные ObjectHolder::Share, счётчика не касаются и ничего не стоят
     class ObjectHolder {
     public:
         ObjectHolder() = default;
 
+        ObjectHolder(const ObjectHolder &other)
+                : object_(other.object_), owning_(other.owning_) {
+            if (owning_) {
+                object_->AddReference();
+            }
+        }
+
+        ObjectHolder(ObjectHolder &&other) noexcept
+                : object_(std::exchange(other.object_, nullptr)), owning_(std::exchange(other.owning_, false)) {
+        }
+
+        ObjectHolder &operator=(const ObjectHolder &other) {
+            ObjectHolder copy(other);
+            Swap(copy);
+            return *this;
+        }
+
+        ObjectHolder &operator=(ObjectHolder &&other) noexcept {
+            ObjectHolder moved(std::move(other));
+            Swap(moved);
+            return *this;
+        }
+
+        ~ObjectHolder() {
+            if (owning_ && object_->RemoveReference() && !object_->IsDestructorSkipped()) {
+                delete object_;
+            }
+        }
+
         template<typename T>
         [[nodiscard]] static ObjectHolder Own(T &&object) {
-            return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+            return Make<std::decay_t<T>>(std::forward<T>(object));
+        }
+        // Создаёт объект на месте, без промежуточной копии. Память выделяет operator new класса T
+        template<typename T, typename... Args>
+        [[nodiscard]] static ObjectHolder Make(Args &&...args) {
+            T *object = new T(std::forward<Args>(args)...);
+            if constexpr (HasTrivialPayload<T>::value) {
+                object->MarkTrivialPayload();
+            }
+            return ObjectHolder(object, true);
         }
         [[nodiscard]] static ObjectHolder Share(Object &object);
+        // Ещё одна владеющая ссылка на объект, которым уже владеет другой ObjectHolder
+        [[nodiscard]] static ObjectHolder Acquire(Object &object);
         [[nodiscard]] static ObjectHolder None();
         [[nodiscard]] Object *Get() const;
+        // Истинно, если других владельцев у объекта нет, и его можно менять, не влияя на остальную программу
+        [[nodiscard]] bool IsUnique() const;
+        // Ложно для ссылки, созданной ObjectHolder::Share: она не продлевает жизнь объекта
+        [[nodiscard]] bool IsOwning() const;
 
         Object &operator*() const;
         Object *operator->() const;
@@ -42,10 +104,45 @@ namespace runtime {
             return dynamic_cast<T *>(this->Get());
         }
     private:
-        explicit ObjectHolder(std::shared_ptr<Object> data);
+        ObjectHolder(Object *object, bool owning);
         void AssertIsValid() const;
 
-        std::shared_ptr<Object> data_;
+        void Swap(ObjectHolder &other) noexcept {
+            std::swap(object_, other.object_);
+            std::swap(owning_, other.owning_);
+        }
+
+        Object *object_ = nullptr;
+        bool owning_ = false;
+    };
+
+    // Получатель ссылок объекта на другие объекты, см. Traced::VisitReferences
+    class ReferenceVisitor {
+    public:
+        virtual void Visit(const ObjectHolder &reference) = 0;
+    protected:
+        ~ReferenceVisitor() = default;
+    };
+
+// Объект, который хранит ссылки на другие объекты и поэтому может оказаться в цикле ссылок, недоступном
+// для подсчёта ссылок. Пока такой объект жив, он состоит в общем списке, который обходит сборщик циклов (gc.h).
+// Копия объекта встаёт в список отдельно, а присваивание не меняет положения в нём
+    class Traced : public Object {
+    public:
+        Traced();
+        Traced(const Traced &other);
+        Traced &operator=(const Traced &other);
+        virtual ~Traced();
+
+        // Передаёт visitor каждую ссылку объекта
+        virtual void VisitReferences(ReferenceVisitor &visitor) const = 0;
+        // Удаляет все ссылки объекта. Сборщик вызывает его у недостижимых объектов, чтобы разорвать цикл
+        virtual void ClearReferences() = 0;
+    private:
+        friend class TracedList;
+
+        Traced *prev_ = nullptr;
+        Traced *next_ = nullptr;
     };
 
     template<typename T>
@@ -62,23 +159,156 @@ namespace runtime {
         [[nodiscard]] const T &GetValue() const {
             return value_;
         }
+
+        // Значения в Mython неизменяемы, поэтому менять значение на месте можно только у объекта,
+        // которым никто, кроме вызывающего, не владеет (см. ObjectHolder::IsUnique)
+        void SetValue(T v) {
+            value_ = std::move(v);
+        }
     private:
         T value_;
     };
 
+    template<typename T>
+    struct HasTrivialPayload<ValueObject<T>> : std::is_trivially_destructible<T> {
+    };
+
     using Closure = std::unordered_map<std::string, ObjectHolder>;
 
     bool IsTrue(const ObjectHolder &object);
 
-    class Executable {
+    class TemporaryValue;
+
+    class Executable : public QuotaCharged {
     public:
         virtual ~Executable() = default;
 
         virtual ObjectHolder Execute(Closure &closure, Context &context) = 0;
+        // Вычисляет значение, которое вызывающий узел использует сразу и никуда не сохраняет: операнд
+        // арифметики или сравнения. Арифметика возвращает число, не создавая объект в куче
+        virtual TemporaryValue Evaluate(Closure &closure, Context &context);
+        // Вычисляет условие if или while. Сравнения и логические операции обходятся без объекта Bool
+        virtual bool EvaluateCondition(Closure &closure, Context &context);
     };
 
-    using String = ValueObject<std::string>;
-    using Number = ValueObject<int>;
+    using Number = ValueObject<int64_t>;
+
+// Вещественное число. Выводится в кратчайшей записи, из которой читается то же самое значение
+    class Float : public ValueObject<double> {
+    public:
+        using ValueObject<double>::ValueObject;
+        void Print(std::ostream &os, Context &context) override;
+    };
+
+    template<>
+    struct HasTrivialPayload<Float> : std::true_type {
+    };
+
+// Значение числового объекта после единственной проверки его типа
+    struct Numeric {
+        bool is_float = false;
+        int64_t int_value = 0;
+        double float_value = 0;
+
+        [[nodiscard]] double AsDouble() const {
+            return is_float ? float_value : static_cast<double>(int_value);
+        }
+    };
+
+    // Возвращает значение объекта Number или Float, для остальных объектов — nullopt
+    std::optional<Numeric> AsNumeric(const ObjectHolder &object);
+    // Порядок двух чисел: -1, 0 или 1. Целое и вещественное сравниваются точно, без перевода целого в double.
+    // Если одно из чисел NaN, порядка нет и возвращается nullopt
+    std::optional<int> CompareNumeric(const Numeric &lhs, const Numeric &rhs);
+
+// Результат Executable::Evaluate. Число хранится прямо в значении, остальные значения — ссылкой на объект.
+// Объект для числа создаётся, только если значение всё-таки нужно сохранить (ToObject)
+    class TemporaryValue {
+    public:
+        TemporaryValue(ObjectHolder object)
+                : object_(std::move(object)) {
+        }
+
+        TemporaryValue(Numeric number)
+                : number_(number) {
+        }
+
+        [[nodiscard]] std::optional<Numeric> AsNumeric() const {
+            return number_ ? number_ : runtime::AsNumeric(object_);
+        }
+
+        // Число, ещё не упакованное в объект, или nullopt, если значение — объект
+        [[nodiscard]] const std::optional<Numeric> &GetUnboxed() const {
+            return number_;
+        }
+
+        // Объект значения: число упаковывается в новый Number или Float
+        [[nodiscard]] ObjectHolder ToObject() &&;
+    private:
+        std::optional<Numeric> number_;
+        ObjectHolder object_;
+    };
+
+// Неизменяемый буфер символов. Короткие строки хранятся прямо в объекте, длинные — в общем буфере
+// со счётчиком ссылок, поэтому копирование буфера никогда не дублирует символы длинной строки
+    class StringBuffer {
+    public:
+        StringBuffer() = default;
+        explicit StringBuffer(std::string value);
+        // Разделяет буфер с владельцем value, не копируя символы, даже если строка короткая
+        explicit StringBuffer(std::shared_ptr<const std::string> value);
+
+        [[nodiscard]] std::string_view View() const {
+            return shared_ ? std::string_view(*shared_) : std::string_view(inline_.data(), inline_size_);
+        }
+    private:
+        static constexpr size_t INLINE_CAPACITY = 23;
+
+        std::shared_ptr<const std::string> shared_;
+        std::array<char, INLINE_CAPACITY> inline_{};
+        uint8_t inline_size_ = 0;
+    };
+
+// Строка. Результат сложения длинных строк хранится как узел дерева конкатенации (rope) со ссылками
+// на слагаемые и склеивается в один std::string только при первом обращении к значению:
+// при выводе, сравнении или хешировании. Поэтому цепочка s = s + x стоит O(общей длины), а не O(n^2).
+// Строка неизменяема и хранит символы в StringBuffer, поэтому её копии разделяют один буфер.
+// Строка запоминает свой хеш, поэтому повторный поиск по строковому ключу в словаре не пересчитывает его
+    class String : public Object {
+    public:
+        String(std::string value);
+        // Строка хоста, встроившего интерпретатор: символы не копируются, буфер разделяется с хостом
+        explicit String(std::shared_ptr<const std::string> value);
+        String(const String &other) = default;
+        String(String &&other) = default;
+        String &operator=(const String &other) = default;
+        String &operator=(String &&other) = default;
+        ~String() override;
+
+        // Складывает две строки без копирования символов, если результат достаточно длинный
+        [[nodiscard]] static ObjectHolder Concat(const ObjectHolder &lhs, const ObjectHolder &rhs);
+
+        void Print(std::ostream &os, Context &context) override;
+        [[nodiscard]] std::string_view GetValue() const;
+        // Длина строки; склеивать строку для этого не нужно
+        [[nodiscard]] size_t Size() const;
+        [[nodiscard]] size_t Hash() const;
+    private:
+        // Строки короче этого порога склеиваются сразу: узел дерева для них дороже копирования
+        static constexpr size_t MIN_ROPE_SIZE = 64;
+
+        String(ObjectHolder lhs, ObjectHolder rhs, size_t size);
+        void Flatten() const;
+        void ReleaseChildren() const;
+
+        mutable StringBuffer value_;
+        // Слагаемые узла конкатенации; пусты у склеенной строки
+        mutable ObjectHolder left_;
+        mutable ObjectHolder right_;
+        size_t size_;
+        mutable size_t hash_ = 0;
+        mutable bool hash_computed_ = false;
+    };
 
     class Bool : public ValueObject<bool> {
     public:
@@ -86,39 +316,278 @@ namespace runtime {
         void Print(std::ostream &os, Context &context) override;
     };
 
+    template<>
+    struct HasTrivialPayload<Bool> : std::true_type {
+    };
+
+    // Кэш результатов метода, объявленного с @memo. Ключ — объект, у которого вызван метод, и аргументы
+    // типов Number, String, Bool или None; вызов с аргументами других типов выполняется без кэша.
+    // Кэш хранит не больше capacity результатов и вытесняет те, что дольше всех не запрашивались
+    class MemoCache {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+        struct Key {
+            uint64_t receiver;
+            std::vector<ObjectHolder> args;
+            size_t hash;
+        };
+
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            // Вызовы с аргументами, из которых нельзя составить ключ
+            size_t bypasses = 0;
+        };
+
+        explicit MemoCache(size_t capacity = DEFAULT_CAPACITY);
+
+        // Ключ для вызова или nullopt, если аргументы нельзя использовать в ключе
+        std::optional<Key> MakeKey(uint64_t receiver, const std::vector<ObjectHolder> &args);
+        // Сохранённый результат или nullptr. Найденный результат становится самым свежим
+        const ObjectHolder *Find(const Key &key);
+        void Insert(Key key, ObjectHolder result);
+        void Clear();
+
+        [[nodiscard]] const Stats &GetStats() const;
+        [[nodiscard]] size_t Size() const;
+        [[nodiscard]] size_t Capacity() const;
+    private:
+        struct KeyHash {
+            size_t operator()(const Key *key) const;
+        };
+
+        struct KeyEqual {
+            bool operator()(const Key *lhs, const Key *rhs) const;
+        };
+
+        using Entry = std::pair<Key, ObjectHolder>;
+
+        size_t capacity_;
+        // Записи от самой свежей к самой старой; индекс ссылается на ключи внутри списка
+        std::list<Entry> entries_;
+        std::unordered_map<const Key *, std::list<Entry>::iterator, KeyHash, KeyEqual> index_;
+        Stats stats_;
+    };
+
     struct Method {
         std::string name;
         std::vector<std::string> formal_params;
         std::unique_ptr<Executable> body;
+        // Кэш результатов, если метод объявлен с @memo
+        std::unique_ptr<MemoCache> memo = nullptr;
     };
 
     class Class : public Object {
     public:
         explicit Class(std::string name, std::vector<Method> methods, const Class *parent);
 
+        // Задаёт методы и родителя класса, созданного заранее, до разбора его тела
+        void Define(std::vector<Method> methods, const Class *parent);
         [[nodiscard]] const Method *GetMethod(const std::string &name) const;
         [[nodiscard]] const std::string &GetName() const;
+        // Истинно, если класс совпадает с cls или унаследован от него
+        [[nodiscard]] bool IsSubclassOf(const Class &cls) const;
         void Print(std::ostream &os, Context &context) override;
+
+        // Сколько полей было у объектов класса после __init__. Новый объект сразу резервирует под них
+        // таблицу полей, и присваивания в __init__ не перестраивают её по мере роста
+        [[nodiscard]] size_t GetFieldCountHint() const;
+        void UpdateFieldCountHint(size_t field_count) const;
     private:
         const std::string name_;
         std::vector<Method> methods_;
         const Class *parent_;
+        mutable size_t field_count_hint_ = 0;
     };
 
-    class ClassInstance : public Object {
+    class ClassInstance : public Traced {
     public:
         explicit ClassInstance(const Class &cls);
 
+        // Объекты классов создаются и удаляются чаще прочих, поэтому их память берётся из AllocateBlock (heap.h)
+        static void *operator new(size_t size);
+        static void operator delete(void *block, size_t size);
+
+        void VisitReferences(ReferenceVisitor &visitor) const override;
+        void ClearReferences() override;
+
         void Print(std::ostream &os, Context &context) override;
         ObjectHolder Call(const std::string &method, const std::vector<ObjectHolder> &actual_args, Context &context);
         [[nodiscard]] bool HasMethod(const std::string &method, size_t argument_count) const;
+        [[nodiscard]] const Class &GetClass() const;
         [[nodiscard]] Closure &Fields();
         [[nodiscard]] const Closure &Fields() const;
+        // Номер объекта, уникальный за время работы программы. В отличие от адреса,
+        // не достаётся новому объекту, поэтому кэш @memo не путает его с удалённым
+        [[nodiscard]] uint64_t GetId() const;
     private:
+        // Выполняет тело метода и хвостовые вызовы из него
+        ObjectHolder Execute(const Method *method_ptr, Closure &fields, Context &context);
+
         const Class &cls_;
         Closure fields_;
+        uint64_t id_;
+    };
+
+    // Создаёт объект класса без вызова __init__. Память под объект берётся из AllocateBlock (heap.h),
+    // а таблица полей резервируется по Class::GetFieldCountHint
+    [[nodiscard]] ObjectHolder MakeInstance(const Class &cls);
+
+    // Хвостовой вызов метода. Инструкция return obj.method(args) передаёт его вместо вызова,
+    // а ClassInstance::Call выполняет вызванный метод в своём кадре C++, подменив замыкание.
+    // Поэтому хвостовая рекурсия любой глубины не растит стек C++
+    struct TailCall {
+        ObjectHolder object;
+        const std::string *method = nullptr;
+        std::vector<ObjectHolder> args;
+    };
+
+    // Результат, который оставила инструкция return в хвостовой позиции тела метода: значение или
+    // хвостовой вызов. После такой инструкции до конца тела ничего не выполняется, поэтому MethodBody
+    // и ClassInstance::Call забирают его сразу, и одного места на поток достаточно
+    struct MethodExit {
+        ObjectHolder value;
+        TailCall call;
+    };
+
+    MethodExit &PendingExit();
+
+    // Позиция приостановленного узла AST: номер инструкции или ветки, счётчик цикла, перебираемый объект
+    struct SuspendedFrame {
+        size_t position = 0;
+        int64_t counter = 0;
+        int64_t stop = 0;
+        int64_t step = 0;
+        ObjectHolder iterable;
+    };
+
+    // Состояние метода-генератора между вызовами: позиции узлов от тела метода до инструкции yield,
+    // на которой он остановился. Оно хранится в объекте генератора, а не на стеке C++,
+    // поэтому для приостановки не нужны ни отдельный стек, ни поток
+    struct GeneratorState {
+        std::vector<SuspendedFrame> frames;
+        ObjectHolder value;
     };
 
+    // Тело метода, содержащего yield. Resume продолжает выполнение с позиции state и возвращает true,
+    // если выполнение остановилось на yield (значение в state.value), и false, если метод завершился
+    class GeneratorBody {
+    public:
+        virtual bool Resume(GeneratorState &state, Closure &closure, Context &context) = 0;
+    protected:
+        ~GeneratorBody() = default;
+    };
+
+    // Генератор, который возвращает вызов метода с yield. Значения вычисляются по одному при каждом Next,
+    // поэтому цепочка генераторов обрабатывает последовательность любой длины в постоянной памяти
+    class Generator : public Traced {
+    public:
+        Generator(GeneratorBody &body, Closure closure);
+
+        void VisitReferences(ReferenceVisitor &visitor) const override;
+        void ClearReferences() override;
+
+        // Следующее значение или nullopt, если метод завершился
+        std::optional<ObjectHolder> Next(Context &context);
+        // Продлевает жизнь объекта, метод которого создал генератор: self в замыкании метода им не владеет
+        void KeepAlive(ObjectHolder owner);
+        void Print(std::ostream &os, Context &context) override;
+    private:
+        GeneratorBody &body_;
+        ObjectHolder owner_;
+        Closure closure_;
+        GeneratorState state_;
+        bool finished_ = false;
+        bool running_ = false;
+    };
+
+// Встроенный список. Элементы хранятся подряд в векторе, поэтому обращение по индексу —
+// это проверка границ и чтение из массива, а append в среднем выполняется за O(1)
+    class List : public Traced {
+    public:
+        List() = default;
+        explicit List(std::vector<ObjectHolder> items);
+        List(const List &other) = default;
+        List(List &&other) = default;
+        List &operator=(const List &other) = default;
+        List &operator=(List &&other) = default;
+        // Вложенные списки и словари, которыми больше никто не владеет, удаляются без рекурсии
+        ~List() override;
+
+        void VisitReferences(ReferenceVisitor &visitor) const override;
+        void ClearReferences() override;
+
+        void Print(std::ostream &os, Context &context) override;
+        // Вызывает встроенный метод списка: append(value) или pop()
+        ObjectHolder Call(const std::string &method, const std::vector<ObjectHolder> &actual_args, Context &context);
+
+        [[nodiscard]] size_t Size() const;
+        // Отрицательный индекс отсчитывается от конца списка, как в Python
+        [[nodiscard]] ObjectHolder &At(int64_t index);
+        [[nodiscard]] const ObjectHolder &At(int64_t index) const;
+        void Append(ObjectHolder value);
+        ObjectHolder Pop();
+    private:
+        [[nodiscard]] size_t CheckIndex(int64_t index) const;
+
+        QuotaVector<ObjectHolder> items_;
+    };
+
+// Встроенный словарь на хеш-таблице с открытой адресацией. Пары ключ-значение лежат подряд в векторе
+// в порядке добавления, а сама таблица хранит только управляющие байты с семью битами хеша
+// и номера пар, поэтому поиск просматривает компактный массив и не выделяет память под каждую запись.
+// Ключами могут быть числа, строки, логические значения, None и объекты классов с методом __hash__
+    class Dict : public Traced {
+    public:
+        Dict() = default;
+        Dict(const Dict &other) = default;
+        Dict(Dict &&other) = default;
+        Dict &operator=(const Dict &other) = default;
+        Dict &operator=(Dict &&other) = default;
+        ~Dict() override;
+
+        void VisitReferences(ReferenceVisitor &visitor) const override;
+        void ClearReferences() override;
+
+        void Print(std::ostream &os, Context &context) override;
+
+        [[nodiscard]] size_t Size() const;
+        // Возвращает значение по ключу или nullptr, если ключа нет
+        [[nodiscard]] ObjectHolder *Find(const ObjectHolder &key, Context &context);
+        ObjectHolder &At(const ObjectHolder &key, Context &context);
+        void Set(const ObjectHolder &key, ObjectHolder value, Context &context);
+        // Ключи и значения в порядке добавления
+        [[nodiscard]] const ObjectHolder &KeyAt(size_t index) const;
+        [[nodiscard]] const ObjectHolder &ValueAt(size_t index) const;
+    private:
+        struct Entry {
+            size_t hash;
+            ObjectHolder key;
+            ObjectHolder value;
+        };
+
+        static constexpr uint8_t EMPTY_SLOT = 0x80;
+        static constexpr size_t MIN_CAPACITY = 8;
+
+        // Возвращает ячейку таблицы с этим ключом или первую пустую ячейку на пути поиска
+        [[nodiscard]] size_t FindSlot(size_t hash, const ObjectHolder &key, Context &context) const;
+        void Rehash(size_t capacity);
+
+        QuotaVector<Entry> entries_;
+        QuotaVector<uint8_t> control_;
+        QuotaVector<uint32_t> indices_;
+        // Меняется при каждом добавлении ключа и перестройке таблицы: по нему поиск замечает,
+        // что __eq__ изменил словарь
+        size_t version_ = 0;
+    };
+
+    // Хеш ключа словаря. Для объектов классов вызывается метод __hash__, который должен вернуть число
+    size_t Hash(const ObjectHolder &object, Context &context);
+    // Проверка x in container для словаря (по ключам), списка и строки (по подстроке)
+    bool Contains(const ObjectHolder &item, const ObjectHolder &container, Context &context);
+
     bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context);
     bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context);
     bool NotEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context);
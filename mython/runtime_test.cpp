@@ -1,6 +1,7 @@
 #include "runtime.h"
 
 #include <functional>
+#include <limits>
 #include <test_runner.h>
 
 using namespace std;
@@ -71,6 +72,57 @@ void TestString() {
     ASSERT_EQUAL(word.GetValue(), "hello!"s);
 }
 
+void TestStringBuffer() {
+    const string long_text(100, 'z');
+    String long_string{long_text};
+    String long_copy = long_string;
+    ASSERT_EQUAL(long_copy.GetValue(), long_text);
+    // Копия длинной строки разделяет буфер с оригиналом
+    ASSERT_EQUAL(static_cast<const void*>(long_copy.GetValue().data()),
+                 static_cast<const void*>(long_string.GetValue().data()));
+
+    String short_string{"short"s};
+    String short_copy = short_string;
+    ASSERT_EQUAL(short_copy.GetValue(), "short"s);
+    ASSERT_EQUAL(short_copy.Size(), 5U);
+
+    StringBuffer empty;
+    ASSERT(empty.View().empty());
+    ASSERT_EQUAL(StringBuffer(string(23, 'a')).View(), string(23, 'a'));
+    ASSERT_EQUAL(StringBuffer(string(24, 'b')).View(), string(24, 'b'));
+}
+
+void TestStringConcat() {
+    DummyContext context;
+
+    ObjectHolder short_sum = String::Concat(ObjectHolder::Own(String{"ab"s}), ObjectHolder::Own(String{"c"s}));
+    ASSERT_EQUAL(short_sum.TryAs<String>()->GetValue(), "abc"s);
+
+    const string piece(40, 'x');
+    ObjectHolder text = ObjectHolder::Own(String{""s});
+    string expected;
+    for (int i = 0; i < 1000; ++i) {
+        text = String::Concat(text, ObjectHolder::Own(String{piece + to_string(i)}));
+        expected += piece + to_string(i);
+    }
+    ObjectHolder doubled = String::Concat(text, text);
+    ASSERT_EQUAL(text.TryAs<String>()->Size(), expected.size());
+    ASSERT_EQUAL(doubled.TryAs<String>()->GetValue(), expected + expected);
+    ASSERT_EQUAL(text.TryAs<String>()->GetValue(), expected);
+    ASSERT_EQUAL(text.TryAs<String>()->Hash(), String{expected}.Hash());
+
+    text.TryAs<String>()->Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), expected);
+
+    // Длинная цепочка сложений освобождается без рекурсии, даже если её ни разу не склеивали
+    ObjectHolder chain = ObjectHolder::Own(String{piece});
+    for (int i = 0; i < 1000000; ++i) {
+        chain = String::Concat(chain, ObjectHolder::Own(String{"y"s}));
+    }
+    ASSERT_EQUAL(chain.TryAs<String>()->Size(), piece.size() + 1000000);
+    chain = ObjectHolder::None();
+}
+
 void TestBool() {
     Bool t(true);
     ASSERT_EQUAL(t.GetValue(), true);
@@ -180,6 +232,184 @@ void TestMethodInvocation() {
     ASSERT_THROWS(child_inst.Call("test"s, {ObjectHolder::None()}, context), runtime_error);
 }
 
+void TestFloat() {
+    DummyContext ctx;
+    auto print = [&ctx](double value) {
+        ostringstream out;
+        Float(value).Print(out, ctx);
+        return out.str();
+    };
+    ASSERT_EQUAL(print(2.5), "2.5"s);
+    ASSERT_EQUAL(print(3), "3.0"s);
+    ASSERT_EQUAL(print(-0.1), "-0.1"s);
+    ASSERT_EQUAL(print(1.0 / 3), "0.3333333333333333"s);
+    ASSERT_EQUAL(print(1e20), "1e+20"s);
+
+    const ObjectHolder half = ObjectHolder::Own(Float{0.5});
+    const ObjectHolder one = ObjectHolder::Own(Number{1});
+    ASSERT(Less(half, one, ctx));
+    ASSERT(Greater(one, half, ctx));
+    ASSERT(Equal(one, ObjectHolder::Own(Float{1.0}), ctx));
+    ASSERT(IsTrue(half));
+    ASSERT(!IsTrue(ObjectHolder::Own(Float{0.0})));
+    ASSERT_EQUAL(Hash(one, ctx), Hash(ObjectHolder::Own(Float{1.0}), ctx));
+
+    // NaN не больше, не меньше и не равен ничему, в том числе себе
+    const ObjectHolder nan = ObjectHolder::Own(Float{numeric_limits<double>::quiet_NaN()});
+    for (const ObjectHolder &other : {one, half, nan}) {
+        ASSERT(!Less(nan, other, ctx) && !Greater(nan, other, ctx) && !Equal(nan, other, ctx));
+        ASSERT(!LessOrEqual(nan, other, ctx) && !GreaterOrEqual(nan, other, ctx) && NotEqual(nan, other, ctx));
+        ASSERT(!Greater(other, nan, ctx) && !GreaterOrEqual(other, nan, ctx));
+    }
+
+    // Целые больше 2^53 сравниваются с вещественными точно, без округления до double
+    const ObjectHolder big_int = ObjectHolder::Own(Number{9007199254740993});
+    const ObjectHolder big_float = ObjectHolder::Own(Float{9007199254740992.0});
+    ASSERT(!Equal(big_int, big_float, ctx));
+    ASSERT(Greater(big_int, big_float, ctx) && Less(big_float, big_int, ctx));
+    ASSERT(Equal(ObjectHolder::Own(Number{9007199254740992}), big_float, ctx));
+    ASSERT(Less(ObjectHolder::Own(Number{numeric_limits<int64_t>::max()}), ObjectHolder::Own(Float{0x1p63}), ctx));
+    ASSERT(Less(ObjectHolder::Own(Number{-3}), ObjectHolder::Own(Float{-2.5}), ctx));
+    ASSERT(Greater(ObjectHolder::Own(Number{-2}), ObjectHolder::Own(Float{-2.5}), ctx));
+
+    ASSERT(!AsNumeric(ObjectHolder::Own(String{"1"s})));
+    ASSERT(!AsNumeric(ObjectHolder::Own(Bool{true})));
+    ASSERT(AsNumeric(half)->is_float);
+    ASSERT_EQUAL(AsNumeric(one)->int_value, 1);
+
+    ASSERT(ctx.output.str().empty());
+}
+
+void TestList() {
+    List list{{ObjectHolder::Own(Number{1}), ObjectHolder::Own(String{"two"s}), ObjectHolder::None()}};
+    ASSERT_EQUAL(list.Size(), 3U);
+
+    DummyContext ctx;
+    ostringstream out;
+    list.Print(out, ctx);
+    ASSERT_EQUAL(out.str(), "[1, 'two', None]"s);
+
+    ASSERT_EQUAL(list.At(0).TryAs<Number>()->GetValue(), 1);
+    ASSERT_EQUAL(list.At(-2).TryAs<String>()->GetValue(), "two"s);
+    ASSERT_THROWS((void)list.At(3), runtime_error);
+    ASSERT_THROWS((void)list.At(-4), runtime_error);
+
+    list.Call("append"s, {ObjectHolder::Own(Number{4})}, ctx);
+    ASSERT_EQUAL(list.Size(), 4U);
+    ASSERT_EQUAL(list.Call("pop"s, {}, ctx).TryAs<Number>()->GetValue(), 4);
+    ASSERT(!list.Pop());
+    ASSERT_THROWS(list.Call("push"s, {}, ctx), runtime_error);
+
+    ASSERT(IsTrue(ObjectHolder::Own(List{})) == false);
+    ASSERT(IsTrue(ObjectHolder::Own(List{{ObjectHolder::None()}})));
+
+    List empty;
+    ASSERT_THROWS(empty.Pop(), runtime_error);
+
+    ASSERT(ctx.output.str().empty());
+}
+
+void TestSelfReferentialContainers() {
+    DummyContext ctx;
+    // Списки, которые append положил в них самих
+    ObjectHolder a = ObjectHolder::Own(List{{ObjectHolder::Own(Number{1})}});
+    a.TryAs<List>()->Append(a);
+    ObjectHolder b = ObjectHolder::Own(List{{ObjectHolder::Own(Number{1})}});
+    b.TryAs<List>()->Append(b);
+    ObjectHolder c = ObjectHolder::Own(List{{ObjectHolder::Own(Number{2})}});
+    c.TryAs<List>()->Append(c);
+
+    ostringstream out;
+    a->Print(out, ctx);
+    ASSERT_EQUAL(out.str(), "[1, [...]]"s);
+    ASSERT(Equal(a, b, ctx));
+    ASSERT(Equal(a, a, ctx));
+    ASSERT(!Equal(a, c, ctx));
+
+    ObjectHolder dict = ObjectHolder::Own(Dict{});
+    dict.TryAs<Dict>()->Set(ObjectHolder::Own(String{"self"s}), dict, ctx);
+    dict.TryAs<Dict>()->Set(ObjectHolder::Own(String{"list"s}), a, ctx);
+    ostringstream dict_out;
+    dict->Print(dict_out, ctx);
+    ASSERT_EQUAL(dict_out.str(), "{'self': {...}, 'list': [1, [...]]}"s);
+    ASSERT(Equal(dict, dict, ctx));
+
+    // Разрываем циклы, чтобы подсчёт ссылок освободил контейнеры
+    for (const ObjectHolder &list : {a, b, c}) {
+        list.TryAs<List>()->Pop();
+    }
+    dict.TryAs<Dict>()->ClearReferences();
+}
+
+void TestDeeplyNestedContainers() {
+    DummyContext ctx;
+    // x = [x] и d = {0: d} миллион раз: удаление не должно расходовать стек на каждый уровень
+    ObjectHolder list = ObjectHolder::Own(List{});
+    ObjectHolder dict = ObjectHolder::Own(Dict{});
+    const ObjectHolder key = ObjectHolder::Own(Number{0});
+    for (int i = 0; i < 1000000; ++i) {
+        ObjectHolder outer_list = ObjectHolder::Own(List{});
+        outer_list.TryAs<List>()->Append(std::move(list));
+        list = std::move(outer_list);
+
+        ObjectHolder outer_dict = ObjectHolder::Own(Dict{});
+        outer_dict.TryAs<Dict>()->Set(key, i % 2 == 0 ? std::move(dict) : ObjectHolder::Own(List{{dict}}), ctx);
+        dict = std::move(outer_dict);
+    }
+    list = {};
+    dict = {};
+
+    // Общий элемент переживает удаление одного из владельцев
+    const ObjectHolder shared = ObjectHolder::Own(List{{ObjectHolder::Own(Number{7})}});
+    ObjectHolder owner = ObjectHolder::Own(List{{shared, ObjectHolder::Own(List{{shared}})}});
+    owner = {};
+    ASSERT_EQUAL(shared.TryAs<List>()->Size(), 1U);
+    ASSERT(shared.IsUnique());
+}
+
+void TestDict() {
+    DummyContext ctx;
+    Dict dict;
+    ASSERT_EQUAL(dict.Size(), 0U);
+    ASSERT(dict.Find(ObjectHolder::Own(Number{1}), ctx) == nullptr);
+
+    // Достаточно ключей, чтобы таблица несколько раз перестроилась
+    for (int i = 0; i < 1000; ++i) {
+        dict.Set(ObjectHolder::Own(Number{i}), ObjectHolder::Own(Number{i * i}), ctx);
+        dict.Set(ObjectHolder::Own(String{to_string(i)}), ObjectHolder::Own(Number{-i}), ctx);
+    }
+    ASSERT_EQUAL(dict.Size(), 2000U);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQUAL(dict.At(ObjectHolder::Own(Number{i}), ctx).TryAs<Number>()->GetValue(), i * i);
+        ASSERT_EQUAL(dict.At(ObjectHolder::Own(String{to_string(i)}), ctx).TryAs<Number>()->GetValue(), -i);
+    }
+    ASSERT(dict.Find(ObjectHolder::Own(Number{1000}), ctx) == nullptr);
+    ASSERT(dict.Find(ObjectHolder::Own(Bool{true}), ctx) == nullptr);
+    ASSERT_THROWS(dict.At(ObjectHolder::None(), ctx), runtime_error);
+    ASSERT_THROWS(dict.Set(ObjectHolder::Own(List{}), ObjectHolder::None(), ctx), runtime_error);
+
+    // Повторная запись по ключу заменяет значение и сохраняет порядок ключей
+    dict.Set(ObjectHolder::Own(Number{0}), ObjectHolder::Own(String{"zero"s}), ctx);
+    ASSERT_EQUAL(dict.Size(), 2000U);
+    ASSERT_EQUAL(dict.KeyAt(0).TryAs<Number>()->GetValue(), 0);
+    ASSERT_EQUAL(dict.ValueAt(0).TryAs<String>()->GetValue(), "zero"s);
+    ASSERT_EQUAL(dict.KeyAt(1).TryAs<String>()->GetValue(), "0"s);
+
+    Dict small;
+    small.Set(ObjectHolder::Own(String{"a"s}), ObjectHolder::Own(Number{1}), ctx);
+    small.Set(ObjectHolder::None(), ObjectHolder::Own(List{}), ctx);
+    ostringstream out;
+    small.Print(out, ctx);
+    ASSERT_EQUAL(out.str(), "{'a': 1, None: []}"s);
+
+    ASSERT(Contains(ObjectHolder::Own(String{"a"s}), ObjectHolder::Own(move(small)), ctx));
+    ASSERT(Contains(ObjectHolder::Own(String{"ell"s}), ObjectHolder::Own(String{"hello"s}), ctx));
+    ASSERT(!Contains(ObjectHolder::Own(Number{1}), ObjectHolder::Own(List{{ObjectHolder::Own(String{"1"s})}}), ctx));
+    ASSERT_THROWS(Contains(ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{1}), ctx), runtime_error);
+
+    ASSERT(ctx.output.str().empty());
+}
+
 void TestNonowning() {
     ASSERT_EQUAL(Logger::instance_count, 0);
     Logger logger(784);
@@ -242,6 +472,37 @@ void TestMove() {
     }
 }
 
+void TestReferenceCount() {
+    ASSERT_EQUAL(Logger::instance_count, 0);
+    auto one = ObjectHolder::Own(Logger(5));
+    Object& object = *one;
+    ASSERT_EQUAL(object.GetReferenceCount(), 1u);
+    ASSERT(one.IsUnique());
+    {
+        ObjectHolder two = one;
+        ASSERT_EQUAL(object.GetReferenceCount(), 2u);
+        ASSERT(!one.IsUnique());
+
+        // Невладеющая ссылка не меняет счётчик и не удаляет объект
+        ObjectHolder borrowed = ObjectHolder::Share(object);
+        ASSERT_EQUAL(object.GetReferenceCount(), 2u);
+        ASSERT(!borrowed.IsOwning() && !borrowed.IsUnique());
+
+        two = ObjectHolder::Acquire(object);
+        ASSERT_EQUAL(object.GetReferenceCount(), 2u);
+    }
+    ASSERT_EQUAL(object.GetReferenceCount(), 1u);
+
+    // Копия объекта не наследует ссылки на оригинал
+    auto copy = ObjectHolder::Own(Logger(static_cast<Logger&>(object)));
+    ASSERT_EQUAL(copy->GetReferenceCount(), 1u);
+    ASSERT_EQUAL(Logger::instance_count, 2);
+
+    one = copy;
+    ASSERT_EQUAL(Logger::instance_count, 1);
+    ASSERT_EQUAL(copy->GetReferenceCount(), 2u);
+}
+
 void TestNullptr() {
     ObjectHolder oh;
     ASSERT(!oh);
@@ -529,23 +790,73 @@ void TestClassInstance() {
     ASSERT_THROWS(instance.Call("missing_method"s, {}, ctx), runtime_error);
 }
 
+void TestMemoCache() {
+    MemoCache cache(2);
+    auto key = [&cache](uint64_t receiver, vector<ObjectHolder> args) {
+        optional<MemoCache::Key> result = cache.MakeKey(receiver, args);
+        ASSERT(result.has_value());
+        return move(*result);
+    };
+    const auto one = ObjectHolder::Own(Number{1});
+    const auto word = ObjectHolder::Own(String{"word"s});
+
+    ASSERT(cache.Find(key(1, {one, word})) == nullptr);
+    cache.Insert(key(1, {one, word}), ObjectHolder::Own(Number{10}));
+    // Ключи сравниваются по значениям аргументов, а не по объектам
+    const ObjectHolder* hit = cache.Find(key(1, {ObjectHolder::Own(Number{1}), ObjectHolder::Own(String{"word"s})}));
+    ASSERT(hit != nullptr);
+    ASSERT_EQUAL(hit->TryAs<Number>()->GetValue(), 10);
+    ASSERT(cache.Find(key(2, {one, word})) == nullptr);
+    ASSERT(cache.Find(key(1, {ObjectHolder::Own(Bool{true}), word})) == nullptr);
+
+    // Вытесняется запись, которую дольше всех не запрашивали
+    cache.Insert(key(2, {}), ObjectHolder::None());
+    ASSERT(cache.Find(key(1, {one, word})) != nullptr);
+    cache.Insert(key(3, {ObjectHolder::None()}), ObjectHolder::None());
+    ASSERT_EQUAL(cache.Size(), 2U);
+    ASSERT(cache.Find(key(1, {one, word})) != nullptr);
+    ASSERT(cache.Find(key(2, {})) == nullptr);
+
+    ASSERT(!cache.MakeKey(1, {ObjectHolder::Own(List{})}).has_value());
+    ASSERT(!cache.MakeKey(1, {ObjectHolder::Own(Float{1.5})}).has_value());
+
+    const MemoCache::Stats& stats = cache.GetStats();
+    ASSERT_EQUAL(stats.hits, 3U);
+    ASSERT_EQUAL(stats.misses, 4U);
+    ASSERT_EQUAL(stats.evictions, 1U);
+    ASSERT_EQUAL(stats.bypasses, 2U);
+
+    cache.Clear();
+    ASSERT_EQUAL(cache.Size(), 0U);
+    ASSERT(cache.Find(key(1, {one, word})) == nullptr);
+}
+
 }  // namespace
 
 void RunObjectsTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestNumber);
     RUN_TEST(tr, runtime::TestString);
+    RUN_TEST(tr, runtime::TestStringBuffer);
+    RUN_TEST(tr, runtime::TestStringConcat);
     RUN_TEST(tr, runtime::TestBool);
     RUN_TEST(tr, runtime::TestMethodInvocation);
     RUN_TEST(tr, runtime::TestIsTrue);
     RUN_TEST(tr, runtime::TestComparison);
     RUN_TEST(tr, runtime::TestClass);
     RUN_TEST(tr, runtime::TestClassInstance);
+    RUN_TEST(tr, runtime::TestFloat);
+    RUN_TEST(tr, runtime::TestList);
+    RUN_TEST(tr, runtime::TestDict);
+    RUN_TEST(tr, runtime::TestSelfReferentialContainers);
+    RUN_TEST(tr, runtime::TestDeeplyNestedContainers);
+    RUN_TEST(tr, runtime::TestMemoCache);
 }
 
 void RunObjectHolderTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestNonowning);
     RUN_TEST(tr, runtime::TestOwning);
     RUN_TEST(tr, runtime::TestMove);
+    RUN_TEST(tr, runtime::TestReferenceCount);
     RUN_TEST(tr, runtime::TestNullptr);
 }
 
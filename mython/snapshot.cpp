@@ -0,0 +1,423 @@
+#include "snapshot.h"
+
+#include "array.h"
+#include "bigint.h"
+#include "builtins.h"
+
+#include <algorithm>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+using namespace std::literals;
+
+namespace runtime {
+
+    namespace {
+        constexpr size_t NO_NODE = static_cast<size_t>(-1);
+        // Узел 0 — глобальные переменные: от него начинаются все пути
+        constexpr size_t ROOT = 0;
+
+        // Встроенные типы называются так же, как функции, которые их создают
+        std::string ClassName(const Object &object) {
+            if (auto instance = dynamic_cast<const ClassInstance *>(&object)) {
+                return instance->GetClass().GetName();
+            } else if (auto native = dynamic_cast<const NativeObject *>(&object)) {
+                return native->GetClass().GetName();
+            } else if (dynamic_cast<const Number *>(&object) || dynamic_cast<const BigInt *>(&object)) {
+                return "int"s;
+            } else if (dynamic_cast<const Float *>(&object)) {
+                return "float"s;
+            } else if (dynamic_cast<const Bool *>(&object)) {
+                return "bool"s;
+            } else if (dynamic_cast<const String *>(&object)) {
+                return "str"s;
+            } else if (dynamic_cast<const List *>(&object)) {
+                return "list"s;
+            } else if (dynamic_cast<const Dict *>(&object)) {
+                return "dict"s;
+            } else if (dynamic_cast<const Array *>(&object)) {
+                return "array"s;
+            } else if (dynamic_cast<const Generator *>(&object)) {
+                return "generator"s;
+            } else if (dynamic_cast<const Class *>(&object) || dynamic_cast<const NativeClass *>(&object)) {
+                return "class"s;
+            }
+            return "object"s;
+        }
+
+        // Узел хеш-таблицы: пара, указатель на следующий узел и сохранённый хеш
+        template<typename Map>
+        size_t HashTableSize(const Map &map) {
+            return map.bucket_count() * sizeof(void *)
+                   + map.size() * (sizeof(typename Map::value_type) + sizeof(void *) + sizeof(size_t));
+        }
+
+        size_t ShallowSize(const Object &object) {
+            if (auto instance = dynamic_cast<const ClassInstance *>(&object)) {
+                return sizeof(ClassInstance) + HashTableSize(instance->Fields());
+            } else if (auto list = dynamic_cast<const List *>(&object)) {
+                return sizeof(List) + list->Size() * sizeof(ObjectHolder);
+            } else if (auto dict = dynamic_cast<const Dict *>(&object)) {
+                // Пара с хешем, управляющий байт и номер пары в таблице, заполненной не больше чем на 7/8
+                constexpr size_t ENTRY_SIZE = sizeof(size_t) + 2 * sizeof(ObjectHolder);
+                constexpr size_t SLOT_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+                return sizeof(Dict) + dict->Size() * ENTRY_SIZE + dict->Size() * 8 / 7 * SLOT_SIZE;
+            } else if (auto str = dynamic_cast<const String *>(&object)) {
+                // Строки, не поместившиеся в объект, лежат в отдельном буфере
+                constexpr size_t INLINE_STRING = 23;
+                return sizeof(String) + (str->Size() > INLINE_STRING ? str->Size() : 0);
+            } else if (auto array = dynamic_cast<const Array *>(&object)) {
+                return sizeof(Array) + array->Size() * sizeof(int64_t);
+            } else if (auto big = dynamic_cast<const BigInt *>(&object)) {
+                return sizeof(BigInt) + big->GetDigitCount() * sizeof(uint32_t);
+            } else if (auto generator = dynamic_cast<const Generator *>(&object)) {
+                return sizeof(*generator);
+            } else if (dynamic_cast<const Float *>(&object)) {
+                return sizeof(Float);
+            } else if (dynamic_cast<const Number *>(&object)) {
+                return sizeof(Number);
+            } else if (dynamic_cast<const Bool *>(&object)) {
+                return sizeof(Bool);
+            } else if (dynamic_cast<const Class *>(&object)) {
+                return sizeof(Class);
+            } else if (dynamic_cast<const NativeObject *>(&object)) {
+                return sizeof(NativeObject);
+            }
+            return sizeof(Object);
+        }
+
+        // Граф объектов, достижимых из глобальных переменных. Объекты нумеруются в порядке обхода в ширину,
+        // поэтому первая найденная ссылка на объект лежит на кратчайшем пути к нему
+        class ObjectGraph {
+        public:
+            explicit ObjectGraph(const Closure &globals) {
+                nodes_.emplace_back();
+                for (const auto &[name, value] : globals) {
+                    AddEdge(ROOT, value, [&name = name] { return name; });
+                }
+                for (size_t current = 1; current < nodes_.size(); ++current) {
+                    AddReferences(current);
+                }
+            }
+
+            struct Node {
+                const Object *object = nullptr;
+                std::vector<size_t> references;
+                size_t parent = NO_NODE;
+                std::string label;
+            };
+
+            [[nodiscard]] const std::vector<Node> &Nodes() const {
+                return nodes_;
+            }
+
+            // Путь от глобальной переменной до объекта по меткам ссылок
+            [[nodiscard]] std::string PathTo(size_t node) const {
+                std::vector<const std::string *> labels;
+                for (; node != ROOT; node = nodes_[node].parent) {
+                    labels.push_back(&nodes_[node].label);
+                }
+                std::string path;
+                for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+                    path += **it;
+                }
+                return path;
+            }
+        private:
+            // Обходит ссылки через VisitReferences; метки нужны только ссылкам типов без своего обхода
+            class Collector : public ReferenceVisitor {
+            public:
+                Collector(ObjectGraph &graph, size_t from)
+                        : graph_(graph), from_(from) {
+                }
+
+                void Visit(const ObjectHolder &reference) override {
+                    const size_t index = index_++;
+                    graph_.AddEdge(from_, reference, [index] { return "<"s + std::to_string(index) + ">"s; });
+                }
+            private:
+                ObjectGraph &graph_;
+                size_t from_;
+                size_t index_ = 0;
+            };
+
+            void AddReferences(size_t from) {
+                const Object &object = *nodes_[from].object;
+                if (auto instance = dynamic_cast<const ClassInstance *>(&object)) {
+                    for (const auto &[name, value] : instance->Fields()) {
+                        AddEdge(from, value, [&name = name] { return "."s + name; });
+                    }
+                } else if (auto list = dynamic_cast<const List *>(&object)) {
+                    for (size_t i = 0; i < list->Size(); ++i) {
+                        AddEdge(from, list->At(static_cast<int64_t>(i)), [i] {
+                            return "["s + std::to_string(i) + "]"s;
+                        });
+                    }
+                } else if (auto dict = dynamic_cast<const Dict *>(&object)) {
+                    for (size_t i = 0; i < dict->Size(); ++i) {
+                        AddEdge(from, dict->KeyAt(i), [i] { return "<key "s + std::to_string(i) + ">"s; });
+                        AddEdge(from, dict->ValueAt(i), [dict, i] {
+                            return "["s + KeyLabel(dict->KeyAt(i), i) + "]"s;
+                        });
+                    }
+                } else if (auto traced = dynamic_cast<const Traced *>(&object)) {
+                    Collector collector(*this, from);
+                    traced->VisitReferences(collector);
+                }
+            }
+
+            // Ключ словаря, как его записали бы в программе. Строковый ключ был захеширован при вставке
+            // и уже склеен, поэтому чтение его значения ничего не меняет
+            static std::string KeyLabel(const ObjectHolder &key, size_t index) {
+                if (auto number = key.TryAs<Number>()) {
+                    return std::to_string(number->GetValue());
+                } else if (auto str = key.TryAs<String>()) {
+                    return "'"s + std::string(str->GetValue()) + "'"s;
+                }
+                return "#"s + std::to_string(index);
+            }
+
+            // Невладеющие ссылки (self в методах) объект не удерживают и в граф не входят.
+            // Метка строится, только если ссылка ведёт к ещё не найденному объекту
+            template<typename MakeLabel>
+            void AddEdge(size_t from, const ObjectHolder &reference, MakeLabel make_label) {
+                if (!reference || !reference.IsOwning()) {
+                    return;
+                }
+                const Object *object = reference.Get();
+                auto [it, inserted] = index_.emplace(object, nodes_.size());
+                if (inserted) {
+                    Node &node = nodes_.emplace_back();
+                    node.object = object;
+                    node.parent = from;
+                    node.label = make_label();
+                }
+                nodes_[from].references.push_back(it->second);
+            }
+
+            std::vector<Node> nodes_;
+            std::unordered_map<const Object *, size_t> index_;
+        };
+
+        // Непосредственные доминаторы узлов графа: алгоритм Купера, Харви и Кеннеди. Доминатор объекта —
+        // ближайший объект, через который проходят все пути к нему от глобальных переменных
+        class Dominators {
+        public:
+            explicit Dominators(const std::vector<ObjectGraph::Node> &nodes)
+                    : postorder_number_(nodes.size(), NO_NODE), idom_(nodes.size(), NO_NODE) {
+                ComputePostorder(nodes);
+                std::vector<std::vector<size_t>> predecessors(nodes.size());
+                for (size_t from = 0; from < nodes.size(); ++from) {
+                    for (size_t to : nodes[from].references) {
+                        predecessors[to].push_back(from);
+                    }
+                }
+
+                idom_[ROOT] = ROOT;
+                bool changed = true;
+                while (changed) {
+                    changed = false;
+                    for (auto it = postorder_.rbegin(); it != postorder_.rend(); ++it) {
+                        const size_t node = *it;
+                        if (node == ROOT) {
+                            continue;
+                        }
+                        size_t new_idom = NO_NODE;
+                        for (size_t predecessor : predecessors[node]) {
+                            if (idom_[predecessor] == NO_NODE) {
+                                continue;
+                            }
+                            new_idom = new_idom == NO_NODE ? predecessor : Intersect(predecessor, new_idom);
+                        }
+                        if (idom_[node] != new_idom) {
+                            idom_[node] = new_idom;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            [[nodiscard]] size_t Get(size_t node) const {
+                return idom_[node];
+            }
+
+            // Узлы в порядке выхода из обхода в глубину: каждый узел идёт раньше своего доминатора
+            [[nodiscard]] const std::vector<size_t> &Postorder() const {
+                return postorder_;
+            }
+        private:
+            // Обход в глубину без рекурсии: цепочка объектов может быть длиннее стека
+            void ComputePostorder(const std::vector<ObjectGraph::Node> &nodes) {
+                std::vector<bool> visited(nodes.size());
+                std::vector<std::pair<size_t, size_t>> stack{{ROOT, 0}};
+                visited[ROOT] = true;
+                while (!stack.empty()) {
+                    auto &[node, next] = stack.back();
+                    if (next < nodes[node].references.size()) {
+                        const size_t child = nodes[node].references[next++];
+                        if (!visited[child]) {
+                            visited[child] = true;
+                            stack.emplace_back(child, 0);
+                        }
+                        continue;
+                    }
+                    postorder_number_[node] = postorder_.size();
+                    postorder_.push_back(node);
+                    stack.pop_back();
+                }
+            }
+
+            [[nodiscard]] size_t Intersect(size_t lhs, size_t rhs) const {
+                while (lhs != rhs) {
+                    while (postorder_number_[lhs] < postorder_number_[rhs]) {
+                        lhs = idom_[lhs];
+                    }
+                    while (postorder_number_[rhs] < postorder_number_[lhs]) {
+                        rhs = idom_[rhs];
+                    }
+                }
+                return lhs;
+            }
+
+            std::vector<size_t> postorder_;
+            std::vector<size_t> postorder_number_;
+            std::vector<size_t> idom_;
+        };
+
+        // Удерживаемая память класса — сумма по объектам, над которыми в дереве доминаторов нет объекта
+        // того же класса: иначе память цепочки узлов списка считалась бы столько раз, какова её длина
+        std::vector<bool> OutermostOfClass(const Dominators &dominators, const std::vector<std::string> &class_names) {
+            const size_t count = class_names.size();
+            std::vector<std::vector<size_t>> children(count);
+            for (size_t node = 1; node < count; ++node) {
+                children[dominators.Get(node)].push_back(node);
+            }
+            std::vector<bool> outermost(count);
+            std::unordered_map<std::string_view, size_t> open_classes;
+            // Второй элемент пары — false при входе в узел и true при выходе из него
+            std::vector<std::pair<size_t, bool>> stack{{ROOT, false}};
+            while (!stack.empty()) {
+                const auto [node, leaving] = stack.back();
+                stack.pop_back();
+                if (leaving) {
+                    --open_classes[class_names[node]];
+                    continue;
+                }
+                if (node != ROOT) {
+                    size_t &open = open_classes[class_names[node]];
+                    outermost[node] = open == 0;
+                    ++open;
+                    stack.emplace_back(node, true);
+                }
+                for (size_t child : children[node]) {
+                    stack.emplace_back(child, false);
+                }
+            }
+            return outermost;
+        }
+
+        void WriteJsonString(std::string_view value, std::ostream &output) {
+            static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+            output << '"';
+            for (const char c : value) {
+                if (c == '"' || c == '\\') {
+                    output << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    output << "\\u00"sv << HEX_DIGITS[c >> 4] << HEX_DIGITS[c & 0xf];
+                } else {
+                    output << c;
+                }
+            }
+            output << '"';
+        }
+    }
+
+    HeapSnapshot TakeHeapSnapshot(const Closure &globals, size_t max_retainers) {
+        const ObjectGraph graph(globals);
+        const std::vector<ObjectGraph::Node> &nodes = graph.Nodes();
+        const Dominators dominators(nodes);
+
+        std::vector<size_t> shallow(nodes.size());
+        std::vector<std::string> class_names(nodes.size());
+        for (size_t node = 1; node < nodes.size(); ++node) {
+            shallow[node] = ShallowSize(*nodes[node].object);
+            class_names[node] = ClassName(*nodes[node].object);
+        }
+        std::vector<size_t> retained = shallow;
+        for (size_t node : dominators.Postorder()) {
+            if (node != ROOT) {
+                retained[dominators.Get(node)] += retained[node];
+            }
+        }
+
+        HeapSnapshot snapshot;
+        snapshot.objects = nodes.size() - 1;
+        snapshot.total_size = retained[ROOT];
+
+        const std::vector<bool> outermost = OutermostOfClass(dominators, class_names);
+        std::unordered_map<std::string_view, ClassMemoryStats> classes;
+        for (size_t node = 1; node < nodes.size(); ++node) {
+            ClassMemoryStats &stats = classes[class_names[node]];
+            ++stats.instances;
+            stats.shallow_size += shallow[node];
+            if (outermost[node]) {
+                stats.retained_size += retained[node];
+            }
+            stats.references += nodes[node].references.size();
+            stats.max_references = std::max(stats.max_references, nodes[node].references.size());
+        }
+        for (auto &[name, stats] : classes) {
+            stats.name = name;
+            snapshot.classes.push_back(std::move(stats));
+        }
+        std::sort(snapshot.classes.begin(), snapshot.classes.end(), [](const auto &lhs, const auto &rhs) {
+            return std::tie(rhs.retained_size, lhs.name) < std::tie(lhs.retained_size, rhs.name);
+        });
+
+        std::vector<size_t> largest(nodes.size() - 1);
+        for (size_t i = 0; i < largest.size(); ++i) {
+            largest[i] = i + 1;
+        }
+        const size_t retainers = std::min(max_retainers, largest.size());
+        // При равной удерживаемой памяти первым идёт объект с более коротким путём
+        std::partial_sort(largest.begin(), largest.begin() + static_cast<std::ptrdiff_t>(retainers), largest.end(),
+                          [&retained](size_t lhs, size_t rhs) {
+                              return std::tie(retained[rhs], lhs) < std::tie(retained[lhs], rhs);
+                          });
+        for (size_t i = 0; i < retainers; ++i) {
+            const size_t node = largest[i];
+            snapshot.largest_retainers.push_back({graph.PathTo(node), class_names[node], shallow[node],
+                                                  retained[node]});
+        }
+        return snapshot;
+    }
+
+    void WriteHeapSnapshot(const HeapSnapshot &snapshot, std::ostream &output) {
+        output << "{\"objects\":"sv << snapshot.objects << ",\"total_size\":"sv << snapshot.total_size
+               << ",\"classes\":["sv;
+        bool first = true;
+        for (const ClassMemoryStats &stats : snapshot.classes) {
+            output << (first ? "{"sv : ",{"sv) << "\"name\":"sv;
+            WriteJsonString(stats.name, output);
+            output << ",\"instances\":"sv << stats.instances << ",\"shallow_size\":"sv << stats.shallow_size
+                   << ",\"retained_size\":"sv << stats.retained_size << ",\"references\":"sv << stats.references
+                   << ",\"max_references\":"sv << stats.max_references << '}';
+            first = false;
+        }
+        output << "],\"largest_retainers\":["sv;
+        first = true;
+        for (const RetainerPath &retainer : snapshot.largest_retainers) {
+            output << (first ? "{"sv : ",{"sv) << "\"path\":"sv;
+            WriteJsonString(retainer.path, output);
+            output << ",\"class\":"sv;
+            WriteJsonString(retainer.class_name, output);
+            output << ",\"shallow_size\":"sv << retainer.shallow_size << ",\"retained_size\":"sv
+                   << retainer.retained_size << '}';
+            first = false;
+        }
+        output << "]}"sv;
+    }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace runtime {
+
+    // Память, которую занимают объекты одного класса. Встроенные типы (Number, String, List, Dict...)
+    // считаются классами со своими именами
+    struct ClassMemoryStats {
+        std::string name;
+        size_t instances = 0;
+        // Память самих объектов без тех, на которые они ссылаются
+        size_t shallow_size = 0;
+        // Память, которая освободится, если удалить все объекты класса: объекты, до которых от глобальных
+        // переменных можно добраться только через них. Вложенные объекты того же класса не считаются дважды
+        size_t retained_size = 0;
+        // Владеющие ссылки объектов класса на другие объекты: всего и наибольшее число у одного объекта
+        size_t references = 0;
+        size_t max_references = 0;
+    };
+
+    // Объект, удерживающий много памяти, и кратчайший путь к нему от глобальной переменной,
+    // например cache.items[3].next
+    struct RetainerPath {
+        std::string path;
+        std::string class_name;
+        size_t shallow_size = 0;
+        size_t retained_size = 0;
+    };
+
+    struct HeapSnapshot {
+        size_t objects = 0;
+        size_t total_size = 0;
+        // По убыванию удерживаемой памяти
+        std::vector<ClassMemoryStats> classes;
+        std::vector<RetainerPath> largest_retainers;
+    };
+
+    constexpr size_t DEFAULT_SNAPSHOT_RETAINERS = 20;
+
+    // Снимок объектов, достижимых из globals по владеющим ссылкам. Удерживаемая память считается по дереву
+    // доминаторов графа объектов. Снимок только читает объекты: не меняет счётчики ссылок, не склеивает строки
+    // и не вызывает методов программы, поэтому его можно снимать между вызовами Run в любой момент.
+    // Размеры объектов оцениваются по числу элементов: точный размер буферов знает только аллокатор
+    [[nodiscard]] HeapSnapshot TakeHeapSnapshot(const Closure &globals,
+                                                size_t max_retainers = DEFAULT_SNAPSHOT_RETAINERS);
+
+    // Записывает снимок одной строкой JSON:
+    // {"objects":N,"total_size":N,"classes":[{"name":"...","instances":N,"shallow_size":N,"retained_size":N,
+    // "references":N,"max_references":N},...],"largest_retainers":[{"path":"...","class":"...","shallow_size":N,
+    // "retained_size":N},...]}
+    void WriteHeapSnapshot(const HeapSnapshot &snapshot, std::ostream &output);
+
+}
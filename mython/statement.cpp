@@ -1,4 +1,8 @@
 #include "statement.h"
+#include <array>
+#include <functional>
+#include <limits>
+#include <optional>
 #include <sstream>
 #include <utility>
 
@@ -14,11 +18,61 @@ namespace ast {
         const std::string ADD_METHOD = "__add__"s;
         const std::string INIT_METHOD = "__init__"s;
         const std::string NONE_LITERAL = "None"s;
+
+        // Продолжает выполнение дочернего узла внутри генератора. Узлы без вложенных инструкций
+        // не могут остановиться на yield и выполняются обычным образом
+        bool ResumeChild(Statement &child, runtime::GeneratorState &state, size_t depth, Closure &closure,
+                         Context &context) {
+            if (auto suspendable = dynamic_cast<Suspendable *>(&child)) {
+                return suspendable->Resume(state, depth, closure, context);
+            }
+            child.Execute(closure, context);
+            return false;
+        }
+
+        bool IsAlwaysReturning(const Statement &statement) {
+            auto tail_statement = dynamic_cast<const TailStatement *>(&statement);
+            return tail_statement != nullptr && tail_statement->AlwaysReturns();
+        }
+
+        // Истинно, если узел начинает выполнение, а не продолжает его после yield
+        bool IsStarting(const runtime::GeneratorState &state, size_t depth) {
+            return state.frames.size() == depth;
+        }
+
+        // Записывает число, не упакованное в объект, в объект переменной на месте, если тот того же типа
+        // и больше никому не принадлежит, как это делает со своим счётчиком ForRange
+        bool StoreInPlace(const runtime::TemporaryValue &value, ObjectHolder &variable) {
+            const std::optional<runtime::Numeric> &number = value.GetUnboxed();
+            if (!number || !variable.IsUnique()) {
+                return false;
+            }
+            if (number->is_float) {
+                if (auto float_ptr = variable.TryAs<runtime::Float>()) {
+                    float_ptr->SetValue(number->float_value);
+                    return true;
+                }
+            } else if (auto number_ptr = variable.TryAs<runtime::Number>()) {
+                number_ptr->SetValue(number->int_value);
+                return true;
+            }
+            return false;
+        }
+    }
+
+    void MarkTailPosition(Statement &body) {
+        if (auto tail_statement = dynamic_cast<TailStatement *>(&body)) {
+            tail_statement->MarkTail();
+        }
     }
 
     ObjectHolder Assignment::Execute(Closure &closure, Context &context) {
-        closure[var_] = rv_->Execute(closure, context);
-        return closure.at(var_);
+        runtime::TemporaryValue value = rv_->Evaluate(closure, context);
+        ObjectHolder &variable = closure[var_];
+        if (!StoreInPlace(value, variable)) {
+            variable = std::move(value).ToObject();
+        }
+        return variable;
     }
 
     Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
@@ -45,6 +99,10 @@ namespace ast {
         }
     }
 
+    const std::vector<std::string> &VariableValue::GetDottedIds() const {
+        return names_;
+    }
+
     std::unique_ptr<Print> Print::Variable(const std::string &name) {
         return std::make_unique<Print>(std::make_unique<VariableValue>(name));
     }
@@ -77,31 +135,141 @@ namespace ast {
             : object_(std::move(object)), method_(std::move(method)), arguments_(std::move(args)) {}
 
     ObjectHolder MethodCall::Execute(Closure &closure, Context &context) {
-        auto class_instance_ptr = object_->Execute(closure, context).TryAs<runtime::ClassInstance>();
+        ObjectHolder object = object_->Execute(closure, context);
+        std::vector<runtime::ObjectHolder> args;
+        for (auto &arg: arguments_) {
+            args.push_back(arg->Execute(closure, context));
+        }
+        return Invoke(object, args, context);
+    }
+
+    const Statement &MethodCall::GetObject() const {
+        return *object_;
+    }
+
+    const std::string &MethodCall::GetMethod() const {
+        return method_;
+    }
+
+    ObjectHolder MethodCall::Invoke(const ObjectHolder &object, std::vector<ObjectHolder> &args,
+                                    Context &context) const {
+        if (auto list_ptr = object.TryAs<runtime::List>()) {
+            return list_ptr->Call(method_, args, context);
+        }
+        if (auto array_ptr = object.TryAs<runtime::Array>()) {
+            return array_ptr->Call(method_, runtime::ArgumentSpan(args.data(), args.size()), context);
+        }
+        if (auto native_ptr = object.TryAs<runtime::NativeObject>()) {
+            return native_ptr->Call(method_, runtime::ArgumentSpan(args.data(), args.size()), context);
+        }
+        ObjectHolder result = object.TryAs<runtime::ClassInstance>()->Call(method_, args, context);
+        if (auto generator_ptr = result.TryAs<runtime::Generator>()) {
+            generator_ptr->KeepAlive(object);
+        }
+        return result;
+    }
+
+    TailCall::TailCall(MethodCall &&call)
+            : MethodCall(std::move(call)) {}
+
+    ObjectHolder TailCall::Execute(Closure &closure, Context &context) {
+        ObjectHolder object = object_->Execute(closure, context);
         std::vector<runtime::ObjectHolder> args;
+        args.reserve(arguments_.size());
         for (auto &arg: arguments_) {
             args.push_back(arg->Execute(closure, context));
         }
-        return class_instance_ptr->Call(method_, args, context);
+        auto class_instance_ptr = object.TryAs<runtime::ClassInstance>();
+        if (class_instance_ptr == nullptr || !class_instance_ptr->HasMethod(method_, args.size())) {
+            return Invoke(object, args, context);
+        }
+        runtime::TailCall call{std::move(object), &method_, std::move(args)};
+        if (tail_) {
+            runtime::PendingExit().call = std::move(call);
+            return {};
+        }
+        throw call;
+    }
+
+    void TailCall::MarkTail() {
+        tail_ = true;
     }
 
     ObjectHolder Stringify::Execute(Closure &closure, Context &context) {
-        ObjectHolder obj_holder = argument_->Execute(closure, context);
-        if (!obj_holder) return ObjectHolder::Own(runtime::String(NONE_LITERAL));
-        std::ostringstream output;
-        obj_holder->Print(output, context);
-        return ObjectHolder::Own(runtime::String(output.str()));
+        return runtime::Str(argument_->Execute(closure, context), context);
+    }
+
+    namespace {
+        // Арифметика над числами без создания объектов: два целых операнда дают целое, иначе оба приводятся
+        // к double. nullopt означает, что один из операндов не число или int_operation вернула true, переполнив
+        // int64_t: тогда операнды упаковываются в объекты и вычисление продолжается в runtime::ApplyBigIntOperation
+        template<typename IntOperation, typename FloatOperation>
+        std::optional<runtime::Numeric> NumericOperation(const runtime::TemporaryValue &lhs,
+                                                         const runtime::TemporaryValue &rhs,
+                                                         IntOperation int_operation, FloatOperation float_operation) {
+            const std::optional<runtime::Numeric> lhs_number = lhs.AsNumeric();
+            if (!lhs_number) {
+                return std::nullopt;
+            }
+            const std::optional<runtime::Numeric> rhs_number = rhs.AsNumeric();
+            if (!rhs_number) {
+                return std::nullopt;
+            }
+            runtime::Numeric result;
+            if (!lhs_number->is_float && !rhs_number->is_float) {
+                if (int_operation(lhs_number->int_value, rhs_number->int_value, &result.int_value)) {
+                    return std::nullopt;
+                }
+                return result;
+            }
+            result.is_float = true;
+            result.float_value = float_operation(lhs_number->AsDouble(), rhs_number->AsDouble());
+            return result;
+        }
+
+        bool AddInts(int64_t lhs, int64_t rhs, int64_t *result) {
+            return __builtin_add_overflow(lhs, rhs, result);
+        }
+
+        bool SubtractInts(int64_t lhs, int64_t rhs, int64_t *result) {
+            return __builtin_sub_overflow(lhs, rhs, result);
+        }
+
+        bool MultiplyInts(int64_t lhs, int64_t rhs, int64_t *result) {
+            return __builtin_mul_overflow(lhs, rhs, result);
+        }
+
+        // Целые делятся нацело; единственное переполнение — INT64_MIN / -1
+        bool DivideInts(int64_t dividend, int64_t divisor, int64_t *result) {
+            if (divisor == 0) throw std::runtime_error("Division was failed");
+            if (divisor == -1 && dividend == std::numeric_limits<int64_t>::min()) return true;
+            *result = dividend / divisor;
+            return false;
+        }
     }
 
+    // Операнды арифметики не сохраняются, поэтому вычисляются через Evaluate, а объект для результата создаёт
+    // только Execute, то есть узел, значение которого действительно покидает выражение
     ObjectHolder Add::Execute(Closure &closure, Context &context) {
-        ObjectHolder obj_holder_lhs = lhs_->Execute(closure, context);
-        ObjectHolder obj_holder_rhs = rhs_->Execute(closure, context);
-        if (obj_holder_lhs.TryAs<runtime::Number>() && obj_holder_rhs.TryAs<runtime::Number>()) {
-            return ObjectHolder::Own(runtime::Number(obj_holder_lhs.TryAs<runtime::Number>()->GetValue()
-                                                     + obj_holder_rhs.TryAs<runtime::Number>()->GetValue()));
+        return Add::Evaluate(closure, context).ToObject();
+    }
+
+    runtime::TemporaryValue Add::Evaluate(Closure &closure, Context &context) {
+        runtime::TemporaryValue lhs = lhs_->Evaluate(closure, context);
+        runtime::TemporaryValue rhs = rhs_->Evaluate(closure, context);
+        if (auto result = NumericOperation(lhs, rhs, AddInts, std::plus<double>())) {
+            return *result;
+        }
+        ObjectHolder obj_holder_lhs = std::move(lhs).ToObject();
+        ObjectHolder obj_holder_rhs = std::move(rhs).ToObject();
+        if (auto result = runtime::ApplyBigIntOperation(runtime::IntegerOperation::Add, obj_holder_lhs,
+                                                        obj_holder_rhs)) {
+            return std::move(*result);
         } else if (obj_holder_lhs.TryAs<runtime::String>() && obj_holder_rhs.TryAs<runtime::String>()) {
-            return runtime::ObjectHolder::Own(runtime::String(obj_holder_lhs.TryAs<runtime::String>()->GetValue()
-                                                              + obj_holder_rhs.TryAs<runtime::String>()->GetValue()));
+            return runtime::String::Concat(obj_holder_lhs, obj_holder_rhs);
+        } else if (auto array = runtime::ApplyArrayOperation(runtime::ArrayOperation::Add, obj_holder_lhs,
+                                                             obj_holder_rhs)) {
+            return std::move(*array);
         } else if (obj_holder_lhs.TryAs<runtime::ClassInstance>()) {
             return obj_holder_lhs.TryAs<runtime::ClassInstance>()->Call(ADD_METHOD, {obj_holder_rhs}, context);
         } else {
@@ -110,26 +278,61 @@ namespace ast {
     }
 
     ObjectHolder Sub::Execute(Closure &closure, Context &context) {
-        auto lhs_ptr = lhs_->Execute(closure, context).TryAs<runtime::Number>();
-        auto rhs_ptr = rhs_->Execute(closure, context).TryAs<runtime::Number>();
-        if (lhs_ptr && rhs_ptr)
-            return runtime::ObjectHolder::Own(runtime::Number(lhs_ptr->GetValue() - rhs_ptr->GetValue()));
+        return Sub::Evaluate(closure, context).ToObject();
+    }
+
+    runtime::TemporaryValue Sub::Evaluate(Closure &closure, Context &context) {
+        runtime::TemporaryValue lhs_value = lhs_->Evaluate(closure, context);
+        runtime::TemporaryValue rhs_value = rhs_->Evaluate(closure, context);
+        if (auto result = NumericOperation(lhs_value, rhs_value, SubtractInts, std::minus<double>()))
+            return *result;
+        ObjectHolder lhs = std::move(lhs_value).ToObject();
+        ObjectHolder rhs = std::move(rhs_value).ToObject();
+        if (auto result = runtime::ApplyBigIntOperation(runtime::IntegerOperation::Sub, lhs, rhs))
+            return std::move(*result);
+        if (auto result = runtime::ApplyArrayOperation(runtime::ArrayOperation::Sub, lhs, rhs))
+            return std::move(*result);
         throw std::runtime_error("Subtraction was failed");
     }
 
     ObjectHolder Mult::Execute(Closure &closure, Context &context) {
-        auto lhs_ptr = lhs_->Execute(closure, context).TryAs<runtime::Number>();
-        auto rhs_ptr = rhs_->Execute(closure, context).TryAs<runtime::Number>();
-        if (lhs_ptr && rhs_ptr)
-            return runtime::ObjectHolder::Own(runtime::Number(lhs_ptr->GetValue() * rhs_ptr->GetValue()));
+        return Mult::Evaluate(closure, context).ToObject();
+    }
+
+    runtime::TemporaryValue Mult::Evaluate(Closure &closure, Context &context) {
+        runtime::TemporaryValue lhs_value = lhs_->Evaluate(closure, context);
+        runtime::TemporaryValue rhs_value = rhs_->Evaluate(closure, context);
+        if (auto result = NumericOperation(lhs_value, rhs_value, MultiplyInts, std::multiplies<double>()))
+            return *result;
+        ObjectHolder lhs = std::move(lhs_value).ToObject();
+        ObjectHolder rhs = std::move(rhs_value).ToObject();
+        if (auto result = runtime::ApplyBigIntOperation(runtime::IntegerOperation::Mult, lhs, rhs))
+            return std::move(*result);
+        if (auto result = runtime::ApplyArrayOperation(runtime::ArrayOperation::Mult, lhs, rhs))
+            return std::move(*result);
         throw std::runtime_error("Multiplication was failed");
     }
 
     ObjectHolder Div::Execute(Closure &closure, Context &context) {
-        auto lhs_ptr = lhs_->Execute(closure, context).TryAs<runtime::Number>();
-        auto rhs_ptr = rhs_->Execute(closure, context).TryAs<runtime::Number>();
-        if (lhs_ptr && rhs_ptr && rhs_ptr->GetValue() != 0)
-            return runtime::ObjectHolder::Own(runtime::Number(lhs_ptr->GetValue() / rhs_ptr->GetValue()));
+        return Div::Evaluate(closure, context).ToObject();
+    }
+
+    runtime::TemporaryValue Div::Evaluate(Closure &closure, Context &context) {
+        runtime::TemporaryValue lhs_value = lhs_->Evaluate(closure, context);
+        runtime::TemporaryValue rhs_value = rhs_->Evaluate(closure, context);
+        // Деление на ноль — ошибка для чисел обоих типов
+        auto divide_floats = [](double dividend, double divisor) {
+            if (divisor == 0) throw std::runtime_error("Division was failed");
+            return dividend / divisor;
+        };
+        if (auto result = NumericOperation(lhs_value, rhs_value, DivideInts, divide_floats))
+            return *result;
+        ObjectHolder lhs = std::move(lhs_value).ToObject();
+        ObjectHolder rhs = std::move(rhs_value).ToObject();
+        if (auto result = runtime::ApplyBigIntOperation(runtime::IntegerOperation::Div, lhs, rhs))
+            return std::move(*result);
+        if (auto result = runtime::ApplyArrayOperation(runtime::ArrayOperation::Div, lhs, rhs))
+            return std::move(*result);
         throw std::runtime_error("Division was failed");
     }
 
@@ -145,13 +348,101 @@ namespace ast {
         return {};
     }
 
+    bool Compound::AlwaysReturns() const {
+        return !instructions_.empty() && IsAlwaysReturning(*instructions_.back());
+    }
+
+    void Compound::MarkTail() {
+        for (size_t i = 0; i + 1 < instructions_.size(); ++i) {
+            auto if_else = dynamic_cast<IfElse *>(instructions_[i].get());
+            if (if_else != nullptr && if_else->CanTakeElse()) {
+                auto rest = std::make_unique<Compound>();
+                for (size_t j = i + 1; j < instructions_.size(); ++j) {
+                    rest->AddStatement(std::move(instructions_[j]));
+                }
+                instructions_.resize(i + 1);
+                if_else->SetElse(std::move(rest));
+                break;
+            }
+        }
+        if (!instructions_.empty()) {
+            MarkTailPosition(*instructions_.back());
+        }
+    }
+
+    // Кадры потомков добавляются в тот же вектор, поэтому к своему кадру узел обращается по индексу
+    bool Compound::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            state.frames.emplace_back();
+        }
+        for (; state.frames[depth].position < instructions_.size(); ++state.frames[depth].position) {
+            if (ResumeChild(*instructions_[state.frames[depth].position], state, depth + 1, closure, context)) {
+                return true;
+            }
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
+    GeneratorMethodBody::GeneratorMethodBody(std::unique_ptr<Statement> &&body)
+            : body_(std::move(body)) {}
+
+    ObjectHolder GeneratorMethodBody::Execute(Closure &closure, [[maybe_unused]] Context &context) {
+        return ObjectHolder::Own(runtime::Generator(*this, closure));
+    }
+
+    bool GeneratorMethodBody::Resume(runtime::GeneratorState &state, Closure &closure, Context &context) {
+        try {
+            return ResumeChild(*body_, state, 0, closure, context);
+        } catch (runtime::ObjectHolder &) {
+            // return внутри генератора завершает его
+            return false;
+        } catch (runtime::TailCall &call) {
+            // Значение return генератору не нужно, но сам вызов должен выполниться
+            call.object.TryAs<runtime::ClassInstance>()->Call(*call.method, call.args, context);
+            return false;
+        }
+    }
+
+    Yield::Yield(std::unique_ptr<Statement> value)
+            : value_(std::move(value)) {}
+
+    ObjectHolder Yield::Execute([[maybe_unused]] Closure &closure, [[maybe_unused]] Context &context) {
+        throw std::runtime_error("yield outside of a generator"s);
+    }
+
+    bool Yield::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            state.value = value_ ? value_->Execute(closure, context) : ObjectHolder::None();
+            state.frames.emplace_back();
+            return true;
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
     Return::Return(std::unique_ptr<Statement> statement)
             : statement_(std::move(statement)) {}
 
     ObjectHolder Return::Execute(Closure &closure, Context &context) {
+        if (tail_) {
+            runtime::PendingExit().value = statement_->Execute(closure, context);
+            return {};
+        }
         throw statement_->Execute(closure, context);
     }
 
+    bool Return::AlwaysReturns() const {
+        return true;
+    }
+
+    void Return::MarkTail() {
+        tail_ = true;
+        if (auto call = dynamic_cast<TailCall *>(statement_.get())) {
+            call->MarkTail();
+        }
+    }
+
     ClassDefinition::ClassDefinition(ObjectHolder cls)
             : cls_(std::move(cls)) {}
 
@@ -177,7 +468,7 @@ namespace ast {
             : condition_(std::move(condition)), if_body_(std::move(if_body)), else_body_(std::move(else_body)) {}
 
     ObjectHolder IfElse::Execute(Closure &closure, Context &context) {
-        if (runtime::IsTrue(condition_->Execute(closure, context))) {
+        if (condition_->EvaluateCondition(closure, context)) {
             return if_body_->Execute(closure, context);
         } else if (else_body_) {
             return else_body_->Execute(closure, context);
@@ -185,44 +476,447 @@ namespace ast {
         return {};
     }
 
+    bool IfElse::AlwaysReturns() const {
+        return else_body_ && IsAlwaysReturning(*if_body_) && IsAlwaysReturning(*else_body_);
+    }
+
+    void IfElse::MarkTail() {
+        MarkTailPosition(*if_body_);
+        if (else_body_) {
+            MarkTailPosition(*else_body_);
+        }
+    }
+
+    bool IfElse::CanTakeElse() const {
+        return !else_body_ && IsAlwaysReturning(*if_body_);
+    }
+
+    void IfElse::SetElse(std::unique_ptr<Statement> else_body) {
+        else_body_ = std::move(else_body);
+    }
+
+    bool IfElse::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            const bool condition = condition_->EvaluateCondition(closure, context);
+            if (!condition && !else_body_) {
+                return false;
+            }
+            state.frames.emplace_back().position = condition ? 0 : 1;
+        }
+        Statement &branch = state.frames[depth].position == 0 ? *if_body_ : *else_body_;
+        if (ResumeChild(branch, state, depth + 1, closure, context)) {
+            return true;
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
+    While::While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body)
+            : condition_(std::move(condition)), body_(std::move(body)) {}
+
+    ObjectHolder While::Execute(Closure &closure, Context &context) {
+        while (condition_->EvaluateCondition(closure, context)) {
+            body_->Execute(closure, context);
+        }
+        return {};
+    }
+
+    // position == 1, пока выполняется тело цикла, и 0, когда пора проверять условие
+    bool While::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            state.frames.emplace_back();
+        }
+        while (true) {
+            if (state.frames[depth].position == 0) {
+                if (!condition_->EvaluateCondition(closure, context)) {
+                    break;
+                }
+                state.frames[depth].position = 1;
+            }
+            if (ResumeChild(*body_, state, depth + 1, closure, context)) {
+                return true;
+            }
+            state.frames[depth].position = 0;
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
+    ForRange::ForRange(std::string var, std::unique_ptr<Statement> start, std::unique_ptr<Statement> stop,
+                       std::unique_ptr<Statement> step, std::unique_ptr<Statement> body)
+            : var_(std::move(var)), start_(std::move(start)), stop_(std::move(stop)), step_(std::move(step)),
+              body_(std::move(body)) {}
+
+    namespace {
+        int64_t EvaluateRangeArgument(Statement &argument, Closure &closure, Context &context) {
+            ObjectHolder value = argument.Execute(closure, context);
+            if (auto number_ptr = value.TryAs<runtime::Number>()) {
+                return number_ptr->GetValue();
+            }
+            throw std::runtime_error("range() arguments must be numbers"s);
+        }
+    }
+
+    ObjectHolder ForRange::Execute(Closure &closure, Context &context) {
+        const int64_t start = EvaluateRangeArgument(*start_, closure, context);
+        const int64_t stop = EvaluateRangeArgument(*stop_, closure, context);
+        const int64_t step = step_ ? EvaluateRangeArgument(*step_, closure, context) : 1;
+        if (step == 0) {
+            throw std::runtime_error("range() step must not be zero"s);
+        }
+
+        ObjectHolder *variable = nullptr;
+        // Переполнение счётчика означает, что следующее значение всё равно лежит за границей stop
+        for (int64_t i = start; step > 0 ? i < stop : i > stop;) {
+            if (variable == nullptr) {
+                variable = &closure[var_];
+            }
+            runtime::Number *counter = variable->IsUnique() ? variable->TryAs<runtime::Number>() : nullptr;
+            if (counter != nullptr) {
+                counter->SetValue(i);
+            } else {
+                *variable = ObjectHolder::Own(runtime::Number(i));
+            }
+            body_->Execute(closure, context);
+            if (__builtin_add_overflow(i, step, &i)) {
+                break;
+            }
+        }
+        return {};
+    }
+
+    bool ForRange::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            runtime::SuspendedFrame frame;
+            frame.counter = EvaluateRangeArgument(*start_, closure, context);
+            frame.stop = EvaluateRangeArgument(*stop_, closure, context);
+            frame.step = step_ ? EvaluateRangeArgument(*step_, closure, context) : 1;
+            if (frame.step == 0) {
+                throw std::runtime_error("range() step must not be zero"s);
+            }
+            state.frames.push_back(std::move(frame));
+        }
+        while (true) {
+            runtime::SuspendedFrame &frame = state.frames[depth];
+            if (frame.position == 0) {
+                if (frame.step > 0 ? frame.counter >= frame.stop : frame.counter <= frame.stop) {
+                    break;
+                }
+                closure[var_] = ObjectHolder::Own(runtime::Number(frame.counter));
+                frame.position = 1;
+            }
+            if (ResumeChild(*body_, state, depth + 1, closure, context)) {
+                return true;
+            }
+            state.frames[depth].position = 0;
+            if (__builtin_add_overflow(state.frames[depth].counter, state.frames[depth].step,
+                                       &state.frames[depth].counter)) {
+                break;
+            }
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
+    ForEach::ForEach(std::string var, std::unique_ptr<Statement> iterable, std::unique_ptr<Statement> body)
+            : var_(std::move(var)), iterable_(std::move(iterable)), body_(std::move(body)) {}
+
+    ObjectHolder ForEach::Execute(Closure &closure, Context &context) {
+        ObjectHolder iterable = iterable_->Execute(closure, context);
+        if (auto generator_ptr = iterable.TryAs<runtime::Generator>()) {
+            while (std::optional<ObjectHolder> value = generator_ptr->Next(context)) {
+                closure[var_] = std::move(*value);
+                body_->Execute(closure, context);
+            }
+            return {};
+        }
+        // Словарь перебирается по ключам в порядке их добавления
+        if (auto dict_ptr = iterable.TryAs<runtime::Dict>()) {
+            for (size_t i = 0; i < dict_ptr->Size(); ++i) {
+                closure[var_] = dict_ptr->KeyAt(i);
+                body_->Execute(closure, context);
+            }
+            return {};
+        }
+        if (auto array_ptr = iterable.TryAs<runtime::Array>()) {
+            for (size_t i = 0; i < array_ptr->Size(); ++i) {
+                closure[var_] = array_ptr->At(static_cast<int64_t>(i));
+                body_->Execute(closure, context);
+            }
+            return {};
+        }
+        auto list_ptr = iterable.TryAs<runtime::List>();
+        if (list_ptr == nullptr) {
+            throw std::runtime_error("for loop can only iterate over a list, a dict, an array, a generator or range()"s);
+        }
+        for (size_t i = 0; i < list_ptr->Size(); ++i) {
+            closure[var_] = list_ptr->At(static_cast<int64_t>(i));
+            body_->Execute(closure, context);
+        }
+        return {};
+    }
+
+    namespace {
+        // Следующий элемент перебираемого объекта из кадра; position — номер следующего элемента
+        std::optional<ObjectHolder> NextElement(runtime::SuspendedFrame &frame, Context &context) {
+            const ObjectHolder &iterable = frame.iterable;
+            if (auto generator_ptr = iterable.TryAs<runtime::Generator>()) {
+                return generator_ptr->Next(context);
+            }
+            const size_t index = frame.position++;
+            if (auto dict_ptr = iterable.TryAs<runtime::Dict>()) {
+                return index < dict_ptr->Size() ? std::optional(dict_ptr->KeyAt(index)) : std::nullopt;
+            }
+            if (auto array_ptr = iterable.TryAs<runtime::Array>()) {
+                return index < array_ptr->Size() ? std::optional(array_ptr->At(static_cast<int>(index))) : std::nullopt;
+            }
+            auto list_ptr = iterable.TryAs<runtime::List>();
+            if (list_ptr == nullptr) {
+                throw std::runtime_error("for loop can only iterate over a list, a dict, an array, a generator or range()"s);
+            }
+            return index < list_ptr->Size() ? std::optional(list_ptr->At(static_cast<int>(index))) : std::nullopt;
+        }
+    }
+
+    // counter == 1, пока выполняется тело цикла, и 0, когда пора брать следующий элемент
+    bool ForEach::Resume(runtime::GeneratorState &state, size_t depth, Closure &closure, Context &context) {
+        if (IsStarting(state, depth)) {
+            state.frames.emplace_back().iterable = iterable_->Execute(closure, context);
+        }
+        while (true) {
+            if (state.frames[depth].counter == 0) {
+                std::optional<ObjectHolder> value = NextElement(state.frames[depth], context);
+                if (!value) {
+                    break;
+                }
+                closure[var_] = std::move(*value);
+                state.frames[depth].counter = 1;
+            }
+            if (ResumeChild(*body_, state, depth + 1, closure, context)) {
+                return true;
+            }
+            state.frames[depth].counter = 0;
+        }
+        state.frames.resize(depth);
+        return false;
+    }
+
+    ListLiteral::ListLiteral(std::vector<std::unique_ptr<Statement>> items)
+            : items_(std::move(items)) {}
+
+    ObjectHolder ListLiteral::Execute(Closure &closure, Context &context) {
+        std::vector<ObjectHolder> items;
+        items.reserve(items_.size());
+        for (auto &item: items_) {
+            items.push_back(item->Execute(closure, context));
+        }
+        return ObjectHolder::Own(runtime::List(std::move(items)));
+    }
+
+    DictLiteral::DictLiteral(std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items)
+            : items_(std::move(items)) {}
+
+    ObjectHolder DictLiteral::Execute(Closure &closure, Context &context) {
+        ObjectHolder result = ObjectHolder::Own(runtime::Dict());
+        auto dict_ptr = result.TryAs<runtime::Dict>();
+        for (auto &[key, value]: items_) {
+            ObjectHolder key_holder = key->Execute(closure, context);
+            dict_ptr->Set(key_holder, value->Execute(closure, context), context);
+        }
+        return result;
+    }
+
+    namespace {
+        // Возвращает ячейку элемента: значение словаря по ключу или элемент списка по индексу
+        ObjectHolder &GetElement(const ObjectHolder &object, const ObjectHolder &index, Context &context) {
+            if (auto dict_ptr = object.TryAs<runtime::Dict>()) {
+                return dict_ptr->At(index, context);
+            }
+            auto list_ptr = object.TryAs<runtime::List>();
+            if (list_ptr == nullptr) {
+                throw std::runtime_error("object is not subscriptable"s);
+            }
+            auto index_ptr = index.TryAs<runtime::Number>();
+            if (index_ptr == nullptr) {
+                throw std::runtime_error("list indices must be numbers"s);
+            }
+            return list_ptr->At(index_ptr->GetValue());
+        }
+
+        int64_t ArrayIndex(const ObjectHolder &index) {
+            auto index_ptr = index.TryAs<runtime::Number>();
+            if (index_ptr == nullptr) {
+                throw std::runtime_error("array indices must be numbers"s);
+            }
+            return index_ptr->GetValue();
+        }
+    }
+
+    Subscript::Subscript(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index)
+            : object_(std::move(object)), index_(std::move(index)) {}
+
+    ObjectHolder Subscript::Execute(Closure &closure, Context &context) {
+        ObjectHolder object = object_->Execute(closure, context);
+        ObjectHolder index = index_->Execute(closure, context);
+        // Элементы массива хранятся без упаковки, поэтому объект для элемента создаётся при чтении
+        if (auto array_ptr = object.TryAs<runtime::Array>()) {
+            return array_ptr->At(ArrayIndex(index));
+        }
+        return GetElement(object, index, context);
+    }
+
+    SubscriptAssignment::SubscriptAssignment(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index,
+                                             std::unique_ptr<Statement> rv)
+            : object_(std::move(object)), index_(std::move(index)), rv_(std::move(rv)) {}
+
+    ObjectHolder SubscriptAssignment::Execute(Closure &closure, Context &context) {
+        // Как и в Python, правая часть вычисляется первой: она может изменить сам контейнер
+        ObjectHolder value = rv_->Execute(closure, context);
+        ObjectHolder object = object_->Execute(closure, context);
+        ObjectHolder index = index_->Execute(closure, context);
+        if (auto dict_ptr = object.TryAs<runtime::Dict>()) {
+            dict_ptr->Set(index, value, context);
+        } else if (auto array_ptr = object.TryAs<runtime::Array>()) {
+            array_ptr->Set(ArrayIndex(index), value);
+        } else {
+            GetElement(object, index, context) = value;
+        }
+        return value;
+    }
+
+    BuiltinCall::BuiltinCall(const runtime::Builtin &builtin, std::vector<std::unique_ptr<Statement>> args)
+            : builtin_(builtin), arguments_(std::move(args)) {}
+
+    ObjectHolder BuiltinCall::Execute(Closure &closure, Context &context) {
+        // Аргументы вычисляются в массив на стеке; std::vector нужен, только если их больше INLINE_ARGUMENTS
+        if (arguments_.size() <= INLINE_ARGUMENTS) {
+            std::array<ObjectHolder, INLINE_ARGUMENTS> values;
+            for (size_t i = 0; i < arguments_.size(); ++i) {
+                values[i] = arguments_[i]->Execute(closure, context);
+            }
+            return builtin_.function(runtime::ArgumentSpan(values.data(), arguments_.size()), context);
+        }
+        std::vector<ObjectHolder> values;
+        values.reserve(arguments_.size());
+        for (auto &argument: arguments_) {
+            values.push_back(argument->Execute(closure, context));
+        }
+        return builtin_.function(runtime::ArgumentSpan(values.data(), values.size()), context);
+    }
+
     ObjectHolder Or::Execute(Closure &closure, Context &context) {
-        if (IsTrue(lhs_->Execute(closure, context))) return ObjectHolder::Own(runtime::Bool(true));
-        return ObjectHolder::Own(runtime::Bool(IsTrue(rhs_->Execute(closure, context))));
+        return ObjectHolder::Own(runtime::Bool(Or::EvaluateCondition(closure, context)));
+    }
+
+    bool Or::EvaluateCondition(Closure &closure, Context &context) {
+        return lhs_->EvaluateCondition(closure, context) || rhs_->EvaluateCondition(closure, context);
     }
 
     ObjectHolder And::Execute(Closure &closure, Context &context) {
-        if (IsTrue(lhs_->Execute(closure, context)))
-            return ObjectHolder::Own(runtime::Bool(IsTrue(rhs_->Execute(closure, context))));;
-        return ObjectHolder::Own(runtime::Bool(false));
+        return ObjectHolder::Own(runtime::Bool(And::EvaluateCondition(closure, context)));
+    }
+
+    bool And::EvaluateCondition(Closure &closure, Context &context) {
+        return lhs_->EvaluateCondition(closure, context) && rhs_->EvaluateCondition(closure, context);
     }
 
     ObjectHolder Not::Execute(Closure &closure, Context &context) {
-        return ObjectHolder::Own(runtime::Bool(!IsTrue(argument_->Execute(closure, context))));
+        return ObjectHolder::Own(runtime::Bool(Not::EvaluateCondition(closure, context)));
     }
 
-    Comparison::Comparison(Comparator comparator, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
-            : BinaryOperation(std::move(lhs), std::move(rhs)), comparator_(std::move(comparator)) {}
+    bool Not::EvaluateCondition(Closure &closure, Context &context) {
+        return !argument_->EvaluateCondition(closure, context);
+    }
+
+    Comparison::Comparison(Comparator comparator, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs,
+                           std::optional<runtime::ArrayOperation> array_operation)
+            : BinaryOperation(std::move(lhs), std::move(rhs)), comparator_(std::move(comparator)),
+              array_operation_(array_operation) {}
+
+    namespace {
+        // Сравнение чисел по тем же правилам, что у runtime::Less, runtime::Greater и остальных сравнений:
+        // целое с вещественным сравнивается точно, а с NaN верно только !=
+        bool CompareNumbers(runtime::ArrayOperation operation, const runtime::Numeric &lhs,
+                            const runtime::Numeric &rhs) {
+            // Два целых — самый частый случай, он обходится без вызова
+            const std::optional<int> order = !lhs.is_float && !rhs.is_float
+                    ? std::optional<int>((lhs.int_value > rhs.int_value) - (lhs.int_value < rhs.int_value))
+                    : runtime::CompareNumeric(lhs, rhs);
+            if (!order) {
+                return operation == runtime::ArrayOperation::NotEqual;
+            }
+            switch (operation) {
+                case runtime::ArrayOperation::Less:
+                    return *order < 0;
+                case runtime::ArrayOperation::Greater:
+                    return *order > 0;
+                case runtime::ArrayOperation::Equal:
+                    return *order == 0;
+                case runtime::ArrayOperation::NotEqual:
+                    return *order != 0;
+                case runtime::ArrayOperation::LessOrEqual:
+                    return *order <= 0;
+                case runtime::ArrayOperation::GreaterOrEqual:
+                    return *order >= 0;
+                default:
+                    throw std::runtime_error("Unknown comparison"s);
+            }
+        }
+    }
 
     ObjectHolder Comparison::Execute(Closure &closure, Context &context) {
-        return ObjectHolder::Own(
-                runtime::Bool(comparator_(lhs_->Execute(closure, context), rhs_->Execute(closure, context), context)));
+        ObjectHolder mask;
+        const bool result = Compare(closure, context, &mask);
+        return mask ? mask : ObjectHolder::Own(runtime::Bool(result));
+    }
+
+    bool Comparison::EvaluateCondition(Closure &closure, Context &context) {
+        ObjectHolder mask;
+        const bool result = Compare(closure, context, &mask);
+        return mask ? IsTrue(mask) : result;
+    }
+
+    bool Comparison::Compare(Closure &closure, Context &context, ObjectHolder *mask) {
+        runtime::TemporaryValue lhs_value = lhs_->Evaluate(closure, context);
+        runtime::TemporaryValue rhs_value = rhs_->Evaluate(closure, context);
+        if (array_operation_) {
+            if (const std::optional<runtime::Numeric> lhs_number = lhs_value.AsNumeric()) {
+                if (const std::optional<runtime::Numeric> rhs_number = rhs_value.AsNumeric()) {
+                    return CompareNumbers(*array_operation_, *lhs_number, *rhs_number);
+                }
+            }
+        }
+        ObjectHolder lhs = std::move(lhs_value).ToObject();
+        ObjectHolder rhs = std::move(rhs_value).ToObject();
+        if (array_operation_) {
+            if (auto array_mask = runtime::ApplyArrayOperation(*array_operation_, lhs, rhs)) {
+                *mask = std::move(*array_mask);
+                return false;
+            }
+        }
+        return comparator_(lhs, rhs, context);
     }
 
     NewInstance::NewInstance(const runtime::Class &class_, std::vector<std::unique_ptr<Statement>> args)
-            : class_instance_(class_), arguments_(std::move(args)) {}
+            : cls_(class_), arguments_(std::move(args)) {}
 
     NewInstance::NewInstance(const runtime::Class &class_)
-            : class_instance_(class_) {}
+            : cls_(class_) {}
 
     ObjectHolder NewInstance::Execute(Closure &closure, Context &context) {
-        if (class_instance_.HasMethod(INIT_METHOD, arguments_.size())) {
+        // Каждое выполнение создаёт новый объект, которым владеет только возвращённый ObjectHolder
+        ObjectHolder instance = runtime::MakeInstance(cls_);
+        auto class_instance_ptr = static_cast<runtime::ClassInstance *>(instance.Get());
+        if (class_instance_ptr->HasMethod(INIT_METHOD, arguments_.size())) {
             std::vector<runtime::ObjectHolder> args;
+            args.reserve(arguments_.size());
             for (auto &arg: arguments_) {
                 args.push_back(arg->Execute(closure, context));
             }
-            class_instance_.Call(INIT_METHOD, args, context);
+            class_instance_ptr->Call(INIT_METHOD, args, context);
         }
-        return ObjectHolder::Share(class_instance_);
+        cls_.UpdateFieldCountHint(class_instance_ptr->Fields().size());
+        return instance;
     }
 
     MethodBody::MethodBody(std::unique_ptr<Statement> &&body)
@@ -231,7 +925,7 @@ namespace ast {
     ObjectHolder MethodBody::Execute(Closure &closure, Context &context) {
         try {
             body_->Execute(closure, context);
-            return {};
+            return std::exchange(runtime::PendingExit().value, {});
         } catch (runtime::ObjectHolder &obj_holder) {
             return obj_holder;
         }
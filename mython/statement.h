@@ -1,7 +1,11 @@
 #pragma once
 
+#include "array.h"
+#include "bigint.h"
+#include "builtins.h"
 #include "runtime.h"
 #include <functional>
+#include <optional>
 
 namespace ast {
 
@@ -11,17 +15,25 @@ namespace ast {
     class ValueStatement : public Statement {
     public:
         explicit ValueStatement(T v)
-                : value_(std::move(v)) {
+                : value_(runtime::ObjectHolder::Own(std::move(v))) {
         }
 
+        // Константа из пула программы: одинаковые литералы разделяют один объект
+        explicit ValueStatement(runtime::ObjectHolder value)
+                : value_(std::move(value)) {
+        }
+
+        // Значение константы разделяется с вызывающим кодом и переживает сам узел AST
         runtime::ObjectHolder Execute(runtime::Closure&, runtime::Context &) override {
-            return runtime::ObjectHolder::Share(value_);
+            return value_;
         }
     private:
-        T value_;
+        runtime::ObjectHolder value_;
     };
 
     using NumericConst = ValueStatement<runtime::Number>;
+    using BigIntConst = ValueStatement<runtime::BigInt>;
+    using FloatConst = ValueStatement<runtime::Float>;
     using StringConst = ValueStatement<runtime::String>;
     using BoolConst = ValueStatement<runtime::Bool>;
 
@@ -31,6 +43,7 @@ namespace ast {
         explicit VariableValue(std::vector<std::string> dotted_ids);
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        [[nodiscard]] const std::vector<std::string> &GetDottedIds() const;
     private:
         std::vector<std::string> names_;
     };
@@ -82,12 +95,32 @@ namespace ast {
                    std::vector<std::unique_ptr<Statement>> args);
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
-    private:
+        [[nodiscard]] const Statement &GetObject() const;
+        [[nodiscard]] const std::string &GetMethod() const;
+    protected:
+        // Вызывает метод у уже вычисленного объекта с уже вычисленными аргументами
+        runtime::ObjectHolder Invoke(const runtime::ObjectHolder &object, std::vector<runtime::ObjectHolder> &args,
+                                     runtime::Context &context) const;
+
         std::unique_ptr<Statement> object_;
         std::string method_;
         std::vector<std::unique_ptr<Statement>> arguments_;
     };
 
+    // Вызов метода, результат которого сразу возвращает return. Метод класса Mython узел не вызывает,
+    // а передаёт runtime::TailCall в ClassInstance::Call, и тот выполняет метод в своём кадре: через
+    // runtime::PendingExit, если return в хвостовой позиции, иначе исключением.
+    // Методы списков, массивов и нативных объектов вызываются как обычно
+    class TailCall : public MethodCall {
+    public:
+        explicit TailCall(MethodCall &&call);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        void MarkTail();
+    private:
+        bool tail_ = false;
+    };
+
     class NewInstance : public Statement {
     public:
         explicit NewInstance(const runtime::Class &class_);
@@ -95,7 +128,7 @@ namespace ast {
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
     private:
-        runtime::ClassInstance class_instance_;
+        const runtime::Class &cls_;
         std::vector<std::unique_ptr<Statement>> arguments_;
     };
 
@@ -128,6 +161,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        runtime::TemporaryValue Evaluate(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class Sub : public BinaryOperation {
@@ -135,6 +169,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        runtime::TemporaryValue Evaluate(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class Mult : public BinaryOperation {
@@ -142,6 +177,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        runtime::TemporaryValue Evaluate(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class Div : public BinaryOperation {
@@ -149,6 +185,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        runtime::TemporaryValue Evaluate(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class Or : public BinaryOperation {
@@ -156,6 +193,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool EvaluateCondition(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class And : public BinaryOperation {
@@ -163,6 +201,7 @@ namespace ast {
         using BinaryOperation::BinaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool EvaluateCondition(runtime::Closure &closure, runtime::Context &context) override;
     };
 
     class Not : public UnaryOperation {
@@ -170,9 +209,39 @@ namespace ast {
         using UnaryOperation::UnaryOperation;
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool EvaluateCondition(runtime::Closure &closure, runtime::Context &context) override;
     };
 
-    class Compound : public Statement {
+    // Узел, выполнение которого можно приостановить на yield внутри метода-генератора.
+    // Resume начинает выполнение, если кадра state.frames[depth] ещё нет, иначе продолжает его с сохранённой
+    // позиции. Возвращает true, если выполнение остановилось на yield: тогда кадры узла и его потомков
+    // остаются в state. При завершении узел удаляет свой кадр
+    class Suspendable {
+    public:
+        virtual bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                            runtime::Context &context) = 0;
+    protected:
+        ~Suspendable() = default;
+    };
+
+    // Узел, который может оказаться последним выполняемым в теле метода. Инструкция return в таком месте
+    // передаёт результат через runtime::PendingExit, а не исключением: после неё метод завершается сам
+    class TailStatement {
+    public:
+        // Истинно, если выполнение узла всегда заканчивается инструкцией return
+        [[nodiscard]] virtual bool AlwaysReturns() const = 0;
+        // Сообщает узлу, что после него тело метода завершается
+        virtual void MarkTail() = 0;
+    protected:
+        ~TailStatement() = default;
+    };
+
+    // Отмечает инструкции return в хвостовой позиции тела метода. Если ветка if без else всегда
+    // заканчивается return, следующие за ней инструкции становятся веткой else, и return в обеих
+    // ветках оказываются последними
+    void MarkTailPosition(Statement &body);
+
+    class Compound : public Statement, public Suspendable, public TailStatement {
     public:
         template<typename... Args>
         explicit Compound(Args &&... args) {
@@ -181,6 +250,10 @@ namespace ast {
 
         void AddStatement(std::unique_ptr<Statement> stmt);
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+        [[nodiscard]] bool AlwaysReturns() const override;
+        void MarkTail() override;
     private:
         std::vector<std::unique_ptr<Statement>> instructions_;
     };
@@ -194,13 +267,40 @@ namespace ast {
         std::unique_ptr<Statement> body_;
     };
 
-    class Return : public Statement {
+    // Тело метода, содержащего yield. Вызов такого метода не выполняет тело, а возвращает генератор,
+    // который выполняет его по частям: от одного yield до следующего
+    class GeneratorMethodBody : public Statement, public runtime::GeneratorBody {
+    public:
+        explicit GeneratorMethodBody(std::unique_ptr<Statement> &&body);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        std::unique_ptr<Statement> body_;
+    };
+
+    // Инструкция yield value: отдаёт значение генератора и приостанавливает метод до следующего запроса
+    class Yield : public Statement, public Suspendable {
+    public:
+        explicit Yield(std::unique_ptr<Statement> value);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+    private:
+        std::unique_ptr<Statement> value_;
+    };
+
+    class Return : public Statement, public TailStatement {
     public:
         explicit Return(std::unique_ptr<Statement> statement);
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        [[nodiscard]] bool AlwaysReturns() const override;
+        void MarkTail() override;
     private:
         std::unique_ptr<Statement> statement_;
+        bool tail_ = false;
     };
 
 // Объявляет класс
@@ -213,27 +313,145 @@ namespace ast {
         runtime::ObjectHolder cls_;
     };
 
-    class IfElse : public Statement {
+    class IfElse : public Statement, public Suspendable, public TailStatement {
     public:
         IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
                std::unique_ptr<Statement> else_body);
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+        [[nodiscard]] bool AlwaysReturns() const override;
+        void MarkTail() override;
+        // Истинно, если у if нет ветки else, а ветка if всегда заканчивается return: тогда инструкции
+        // после него можно перенести в else, не меняя смысла программы
+        [[nodiscard]] bool CanTakeElse() const;
+        void SetElse(std::unique_ptr<Statement> else_body);
     private:
         std::unique_ptr<Statement> condition_;
         std::unique_ptr<Statement> if_body_;
         std::unique_ptr<Statement> else_body_;
     };
 
+    class While : public Statement, public Suspendable {
+    public:
+        While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+    private:
+        std::unique_ptr<Statement> condition_;
+        std::unique_ptr<Statement> body_;
+    };
+
+// Цикл for var in range(start, stop, step). Счётчик хранится в int, а объект Number переменной цикла
+// переиспользуется между итерациями, пока им не завладел кто-то кроме таблицы символов
+    class ForRange : public Statement, public Suspendable {
+    public:
+        ForRange(std::string var, std::unique_ptr<Statement> start, std::unique_ptr<Statement> stop,
+                 std::unique_ptr<Statement> step, std::unique_ptr<Statement> body);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+    private:
+        std::string var_;
+        std::unique_ptr<Statement> start_;
+        std::unique_ptr<Statement> stop_;
+        std::unique_ptr<Statement> step_;
+        std::unique_ptr<Statement> body_;
+    };
+
+// Цикл for var in <выражение> по элементам списка, массива, генератора или ключам словаря.
+// Список перечитывается по индексу на каждой итерации, поэтому его можно менять внутри тела цикла
+    class ForEach : public Statement, public Suspendable {
+    public:
+        ForEach(std::string var, std::unique_ptr<Statement> iterable, std::unique_ptr<Statement> body);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool Resume(runtime::GeneratorState &state, size_t depth, runtime::Closure &closure,
+                    runtime::Context &context) override;
+    private:
+        std::string var_;
+        std::unique_ptr<Statement> iterable_;
+        std::unique_ptr<Statement> body_;
+    };
+
+// Создаёт новый список из значений выражений [a, b, c]
+    class ListLiteral : public Statement {
+    public:
+        explicit ListLiteral(std::vector<std::unique_ptr<Statement>> items);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        std::vector<std::unique_ptr<Statement>> items_;
+    };
+
+// Создаёт новый словарь из пар выражений {k1: v1, k2: v2}
+    class DictLiteral : public Statement {
+    public:
+        explicit DictLiteral(std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        std::vector<std::pair<std::unique_ptr<Statement>, std::unique_ptr<Statement>>> items_;
+    };
+
+// Обращение к элементу списка или словаря object[index]
+    class Subscript : public Statement {
+    public:
+        Subscript(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        std::unique_ptr<Statement> object_;
+        std::unique_ptr<Statement> index_;
+    };
+
+// Присваивает значение элементу списка или словаря: object[index] = rv
+    class SubscriptAssignment : public Statement {
+    public:
+        SubscriptAssignment(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index,
+                            std::unique_ptr<Statement> rv);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        std::unique_ptr<Statement> object_;
+        std::unique_ptr<Statement> index_;
+        std::unique_ptr<Statement> rv_;
+    };
+
+// Вызов встроенной функции, привязанный при разборе к записи реестра runtime::Builtins
+    class BuiltinCall : public Statement {
+    public:
+        BuiltinCall(const runtime::Builtin &builtin, std::vector<std::unique_ptr<Statement>> args);
+
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    private:
+        static constexpr size_t INLINE_ARGUMENTS = 4;
+
+        const runtime::Builtin &builtin_;
+        std::vector<std::unique_ptr<Statement>> arguments_;
+    };
+
     class Comparison : public BinaryOperation {
     public:
         using Comparator = std::function<bool(const runtime::ObjectHolder &, const runtime::ObjectHolder &, runtime::Context &)>;
 
-        Comparison(Comparator comparator, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+        // array_operation задаёт поэлементное сравнение, если один из операндов — массив: результатом будет маска
+        Comparison(Comparator comparator, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs,
+                   std::optional<runtime::ArrayOperation> array_operation = std::nullopt);
 
         runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+        bool EvaluateCondition(runtime::Closure &closure, runtime::Context &context) override;
     private:
+        // Возвращает результат сравнения или записывает в mask поэлементное сравнение массивов.
+        // Числа сравниваются без упаковки в объекты: вид сравнения известен из array_operation
+        bool Compare(runtime::Closure &closure, runtime::Context &context, runtime::ObjectHolder *mask);
+
         Comparator comparator_;
+        std::optional<runtime::ArrayOperation> array_operation_;
     };
 
 }
\ No newline at end of file
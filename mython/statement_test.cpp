@@ -187,6 +187,9 @@ void TestStringify() {
         auto result = Stringify(make_unique<StringConst>("Wazzup!"s)).Execute(empty, context);
         ASSERT_OBJECT_VALUE_EQUAL(result, "Wazzup!"s);
         ASSERT(result.TryAs<runtime::String>());
+        // str от строки не создаёт новый объект
+        ObjectHolder value = ObjectHolder::Own(runtime::String("Wazzup!"s));
+        ASSERT_EQUAL(Stringify(make_unique<StringConst>(value)).Execute(empty, context).Get(), value.Get());
     }
     {
         vector<runtime::Method> methods;
@@ -227,6 +230,34 @@ void TestNumbersAddition() {
     ASSERT(context.output.str().empty());
 }
 
+void TestMixedArithmetic() {
+    runtime::DummyContext context;
+    Closure empty;
+
+    ASSERT_OBJECT_VALUE_EQUAL(Add(make_unique<NumericConst>(1), make_unique<FloatConst>(1.5)).Execute(empty, context),
+                              "2.5"s);
+    ASSERT_OBJECT_VALUE_EQUAL(Sub(make_unique<FloatConst>(1.5), make_unique<FloatConst>(0.5)).Execute(empty, context),
+                              "1.0"s);
+    ASSERT_OBJECT_VALUE_EQUAL(Mult(make_unique<FloatConst>(0.1), make_unique<NumericConst>(3)).Execute(empty, context),
+                              "0.30000000000000004"s);
+    // Целые по-прежнему делятся нацело, а с вещественным операндом деление точное
+    ASSERT_OBJECT_VALUE_EQUAL(Div(make_unique<NumericConst>(7), make_unique<NumericConst>(2)).Execute(empty, context),
+                              "3"s);
+    ASSERT_OBJECT_VALUE_EQUAL(Div(make_unique<NumericConst>(7), make_unique<FloatConst>(2)).Execute(empty, context),
+                              "3.5"s);
+
+    ObjectHolder product = Mult(make_unique<NumericConst>(6), make_unique<NumericConst>(7)).Execute(empty, context);
+    ASSERT(product.TryAs<runtime::Number>() != nullptr);
+    ObjectHolder quotient = Div(make_unique<FloatConst>(1e300), make_unique<FloatConst>(1e-300)).Execute(empty, context);
+    ASSERT_OBJECT_VALUE_EQUAL(quotient, "inf"s);
+
+    ASSERT_THROWS(Div(make_unique<FloatConst>(1), make_unique<FloatConst>(0)).Execute(empty, context), runtime_error);
+    ASSERT_THROWS(Add(make_unique<FloatConst>(1), make_unique<StringConst>("1"s)).Execute(empty, context),
+                  runtime_error);
+
+    ASSERT(context.output.str().empty());
+}
+
 void TestStringsAddition() {
     runtime::DummyContext context;
 
@@ -345,6 +376,33 @@ void TestFields() {
     ASSERT(context.output.str().empty());
 }
 
+void TestNewInstance() {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+
+    vector<runtime::Method> methods;
+    methods.push_back({"__init__"s,
+                       {"x"s},
+                       {make_unique<FieldAssignment>(VariableValue{"self"s}, "x"s, make_unique<VariableValue>("x"s))}});
+    runtime::Class cls("Point"s, std::move(methods), nullptr);
+    ASSERT_EQUAL(cls.GetFieldCountHint(), 0U);
+
+    vector<unique_ptr<Statement>> args;
+    args.push_back(make_unique<NumericConst>(1));
+    NewInstance new_instance(cls, std::move(args));
+
+    // Каждое выполнение узла создаёт отдельный объект, который переживает сам узел
+    ObjectHolder first = new_instance.Execute(closure, context);
+    ObjectHolder second = new_instance.Execute(closure, context);
+    ASSERT(first.Get() != second.Get());
+    ASSERT(first.IsUnique() && second.IsUnique());
+    first.TryAs<runtime::ClassInstance>()->Fields()["x"s] = ObjectHolder::Own(runtime::Number(5));
+    ASSERT_EQUAL(second.TryAs<runtime::ClassInstance>()->Fields().at("x"s).TryAs<runtime::Number>()->GetValue(), 1);
+
+    // Следующие объекты резервируют таблицу под поле, заполненное в __init__
+    ASSERT_EQUAL(cls.GetFieldCountHint(), 1U);
+}
+
 void TestBaseClass() {
     vector<runtime::Method> methods;
     methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
@@ -454,6 +512,163 @@ void TestNot() {
     test_not(false);
 }
 
+void TestForRange() {
+    runtime::DummyContext context;
+
+    // for i in range(1, 10, 2): total = total + i; last = i
+    ForRange loop("i"s, make_unique<NumericConst>(1), make_unique<NumericConst>(10), make_unique<NumericConst>(2),
+                  make_unique<Compound>(
+                      make_unique<Assignment>("total"s, make_unique<Add>(make_unique<VariableValue>("total"s),
+                                                                         make_unique<VariableValue>("i"s))),
+                      make_unique<Assignment>("last"s, make_unique<VariableValue>("i"s))));
+
+    Closure closure = {{"total"s, ObjectHolder::Own(runtime::Number(0))}};
+    ASSERT(!loop.Execute(closure, context));
+
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("total"s), 25);
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("i"s), 9);
+    // Переменная, сохранившая значение счётчика, не должна меняться вместе с ним
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("last"s), 9);
+
+    ForRange zero_step("i"s, make_unique<NumericConst>(0), make_unique<NumericConst>(10),
+                       make_unique<NumericConst>(0), make_unique<Compound>());
+    ASSERT_THROWS(zero_step.Execute(closure, context), std::runtime_error);
+    ForRange bad_bound("i"s, make_unique<NumericConst>(0), make_unique<StringConst>("10"s), nullptr,
+                       make_unique<Compound>());
+    ASSERT_THROWS(bad_bound.Execute(closure, context), std::runtime_error);
+
+    ASSERT(context.output.str().empty());
+}
+
+void TestLists() {
+    runtime::DummyContext context;
+    Closure closure;
+
+    // items = [1, 'x', None]
+    vector<unique_ptr<Statement>> items;
+    items.push_back(make_unique<NumericConst>(1));
+    items.push_back(make_unique<StringConst>("x"s));
+    items.push_back(make_unique<None>());
+    Assignment("items"s, make_unique<ListLiteral>(move(items))).Execute(closure, context);
+
+    // items[1] = items[0] + 1
+    SubscriptAssignment assignment(make_unique<VariableValue>("items"s), make_unique<NumericConst>(1),
+                                   make_unique<Add>(make_unique<Subscript>(make_unique<VariableValue>("items"s),
+                                                                           make_unique<NumericConst>(0)),
+                                                    make_unique<NumericConst>(1)));
+    ASSERT_OBJECT_VALUE_EQUAL(assignment.Execute(closure, context), 2);
+
+    // for item in items: print item
+    ForEach loop("item"s, make_unique<VariableValue>("items"s), Print::Variable("item"s));
+    ASSERT(!loop.Execute(closure, context));
+    ASSERT_EQUAL(context.output.str(), "1\n2\nNone\n"s);
+
+    Subscript out_of_range(make_unique<VariableValue>("items"s), make_unique<NumericConst>(3));
+    ASSERT_THROWS(out_of_range.Execute(closure, context), std::runtime_error);
+    Subscript not_a_list(make_unique<NumericConst>(3), make_unique<NumericConst>(0));
+    ASSERT_THROWS(not_a_list.Execute(closure, context), std::runtime_error);
+    ForEach not_iterable("item"s, make_unique<NumericConst>(3), make_unique<Compound>());
+    ASSERT_THROWS(not_iterable.Execute(closure, context), std::runtime_error);
+}
+
+void TestWhile() {
+    runtime::DummyContext context;
+
+    // while n > 0: n = n - 1; print n
+    While loop(make_unique<Comparison>(runtime::Greater, make_unique<VariableValue>("n"s),
+                                       make_unique<NumericConst>(0)),
+               make_unique<Compound>(
+                   make_unique<Assignment>("n"s, make_unique<Sub>(make_unique<VariableValue>("n"s),
+                                                                  make_unique<NumericConst>(1))),
+                   Print::Variable("n"s)));
+
+    Closure closure = {{"n"s, ObjectHolder::Own(runtime::Number(3))}};
+    ASSERT(!loop.Execute(closure, context));
+
+    ASSERT_EQUAL(context.output.str(), "2\n1\n0\n"s);
+}
+
+void TestTemporariesStayOffHeap() {
+    runtime::DummyContext context;
+    Closure closure = {{"a"s, ObjectHolder::Own(runtime::Number(3))},
+                       {"b"s, ObjectHolder::Own(runtime::Number(4))},
+                       {"x"s, ObjectHolder::Own(runtime::Float(0.5))}};
+    auto var = [](const string& name) {
+        return make_unique<VariableValue>(name);
+    };
+
+    // a * b + (b - a) * x < 100 and not a == b
+    auto condition = make_unique<And>(
+        make_unique<Comparison>(runtime::Less,
+                                make_unique<Add>(make_unique<Mult>(var("a"s), var("b"s)),
+                                                 make_unique<Mult>(make_unique<Sub>(var("b"s), var("a"s)), var("x"s))),
+                                make_unique<NumericConst>(100), runtime::ArrayOperation::Less),
+        make_unique<Not>(make_unique<Comparison>(runtime::Equal, var("a"s), var("b"s),
+                                                 runtime::ArrayOperation::Equal)));
+    // r = a * b + b / a
+    IfElse if_else(std::move(condition),
+                   make_unique<Assignment>("r"s, make_unique<Add>(make_unique<Mult>(var("a"s), var("b"s)),
+                                                                  make_unique<Div>(var("b"s), var("a"s)))),
+                   nullptr);
+
+    // Условие и промежуточные суммы не создают объектов, а присваивание создаёт ровно один
+    runtime::HeapQuota quota(sizeof(runtime::Number));
+    {
+        const runtime::HeapQuotaScope scope(quota);
+        if_else.Execute(closure, context);
+    }
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("r"s), 13);
+    ASSERT_EQUAL(quota.GetPeakUsage(), sizeof(runtime::Number));
+
+    // Повторное присваивание записывает результат в объект переменной на месте
+    const ObjectHolder& result = closure.at("r"s);
+    const runtime::Object* result_object = result.Get();
+    quota.SetLimit(0);
+    {
+        const runtime::HeapQuotaScope scope(quota);
+        if_else.Execute(closure, context);
+    }
+    ASSERT_EQUAL(closure.at("r"s).Get(), result_object);
+    ASSERT_OBJECT_VALUE_EQUAL(result, 13);
+
+    // Переполнение внутри выражения по-прежнему продолжается в BigInt, а сравнение с Float — в double
+    closure["a"s] = ObjectHolder::Own(runtime::Number(numeric_limits<int64_t>::max()));
+    ObjectHolder big = Sub(make_unique<Add>(var("a"s), var("a"s)), var("a"s)).Execute(closure, context);
+    ASSERT_OBJECT_VALUE_EQUAL(big, numeric_limits<int64_t>::max());
+    ASSERT(Comparison(runtime::GreaterOrEqual, var("b"s), make_unique<Add>(var("x"s), make_unique<NumericConst>(3)),
+                      runtime::ArrayOperation::GreaterOrEqual).EvaluateCondition(closure, context));
+    ASSERT(!Comparison(runtime::Greater, var("b"s), make_unique<FloatConst>(4.0),
+                       runtime::ArrayOperation::Greater).EvaluateCondition(closure, context));
+
+    // С NaN верно только !=, и быстрое сравнение чисел согласовано с runtime::Greater и остальными
+    closure["n"s] = ObjectHolder::Own(runtime::Float(numeric_limits<double>::quiet_NaN()));
+    const pair<Comparison::Comparator, runtime::ArrayOperation> comparisons[] = {
+            {runtime::Less, runtime::ArrayOperation::Less},
+            {runtime::Greater, runtime::ArrayOperation::Greater},
+            {runtime::Equal, runtime::ArrayOperation::Equal},
+            {runtime::NotEqual, runtime::ArrayOperation::NotEqual},
+            {runtime::LessOrEqual, runtime::ArrayOperation::LessOrEqual},
+            {runtime::GreaterOrEqual, runtime::ArrayOperation::GreaterOrEqual},
+    };
+    for (const auto& [comparator, operation] : comparisons) {
+        const bool expected = operation == runtime::ArrayOperation::NotEqual;
+        ASSERT_EQUAL(Comparison(comparator, var("n"s), make_unique<NumericConst>(1), operation)
+                             .EvaluateCondition(closure, context), expected);
+        ASSERT_EQUAL(Comparison(comparator, make_unique<FloatConst>(1.5), var("n"s), operation)
+                             .EvaluateCondition(closure, context), expected);
+        ASSERT_EQUAL(comparator(closure.at("n"s), ObjectHolder::Own(runtime::Number(1)), context), expected);
+    }
+
+    // Целое больше 2^53 сравнивается с вещественным точно
+    closure["big"s] = ObjectHolder::Own(runtime::Number(9007199254740993));
+    ASSERT(!Comparison(runtime::Equal, var("big"s), make_unique<FloatConst>(9007199254740992.0),
+                       runtime::ArrayOperation::Equal).EvaluateCondition(closure, context));
+    ASSERT(Comparison(runtime::Greater, var("big"s), make_unique<FloatConst>(9007199254740992.0),
+                      runtime::ArrayOperation::Greater).EvaluateCondition(closure, context));
+
+    ASSERT(context.output.str().empty());
+}
+
 }  // namespace
 
 void RunUnitTests(TestRunner& tr) {
@@ -466,17 +681,23 @@ void RunUnitTests(TestRunner& tr) {
     RUN_TEST(tr, ast::TestPrintMultipleStatements);
     RUN_TEST(tr, ast::TestStringify);
     RUN_TEST(tr, ast::TestNumbersAddition);
+    RUN_TEST(tr, ast::TestMixedArithmetic);
     RUN_TEST(tr, ast::TestStringsAddition);
     RUN_TEST(tr, ast::TestBadAddition);
     RUN_TEST(tr, ast::TestSuccessfulClassInstanceAdd);
     RUN_TEST(tr, ast::TestClassInstanceAddWithoutMethod);
     RUN_TEST(tr, ast::TestCompound);
     RUN_TEST(tr, ast::TestFields);
+    RUN_TEST(tr, ast::TestNewInstance);
     RUN_TEST(tr, ast::TestBaseClass);
     RUN_TEST(tr, ast::TestInheritance);
     RUN_TEST(tr, ast::TestOr);
     RUN_TEST(tr, ast::TestAnd);
     RUN_TEST(tr, ast::TestNot);
+    RUN_TEST(tr, ast::TestForRange);
+    RUN_TEST(tr, ast::TestWhile);
+    RUN_TEST(tr, ast::TestTemporariesStayOffHeap);
+    RUN_TEST(tr, ast::TestLists);
 }
 
 }  // namespace ast